@@ -0,0 +1,45 @@
+#include <stdio.h>
+#include <string.h>
+#include <generics/aho_corasick.h>
+
+int print_match(size_t end, size_t length, void* value, void* arg)
+{
+	char* text = arg;
+	printf("%.*s (%d) at %lu\n",
+			(int)length,
+			text + end - length,
+			*(int*)value,
+			(unsigned long)(end - length));
+	return 0;
+}
+
+int main()
+{
+	trie_t t;
+	trie_create(&t, sizeof(int));
+
+	char* patterns[] = { "he", "she", "his", "hers" };
+	size_t n = sizeof(patterns)/sizeof(char*);
+
+	size_t i;
+	for(i=0; i<n; i++){
+		int v = i;
+		trie_add_element(&t, patterns[i], strlen(patterns[i]), &v);
+	}
+
+	ac_t ac;
+	ac_build(&ac, &t);
+	trie_destroy(&t);
+
+	/*
+	 * the text is scanned in two pieces; the state is
+	 * kept, so "hers" is found across the boundary
+	 */
+	char* text = "ushers and his sheep";
+	ac_scan(&ac, text, 4, print_match, text);
+	ac_scan(&ac, text + 4, strlen(text) - 4, print_match, text);
+
+	ac_destroy(&ac);
+
+	return 0;
+}
@@ -0,0 +1,147 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <generics/map.h>
+#include <generics/queue.h>
+#include <generics/cache.h>
+
+/*
+ * benchmark of a read-through cache under a Zipfian workload:
+ * each request gets the key and, on a miss, puts it. The cache
+ * built from a map_t and a queue_t, which moves the key to the
+ * back of the queue on each hit, is compared with cache_t with
+ * the LRU and the CLOCK policies
+ */
+
+#define KEYS 100000
+#define REQUESTS 4000000
+#define CAPACITY 10000
+
+typedef struct entry_t {
+	qnode_t* node;
+	long value;
+} entry_t;
+
+double seconds(clock_t start)
+{
+	return (double)(clock() - start)/CLOCKS_PER_SEC;
+}
+
+/*
+ * requests of keys with the probability of the key k
+ * proportional to 1/(k + 1), by inverting the
+ * cumulative distribution
+ */
+long* zipf_requests(void)
+{
+	double* cdf = (double*) malloc(KEYS*sizeof(double));
+	long* requests = (long*) malloc(REQUESTS*sizeof(long));
+	double sum = 0;
+	long i;
+
+	for(i = 0; i<KEYS; i++){
+		sum += 1.0/(i + 1);
+		cdf[i] = sum;
+	}
+
+	for(i = 0; i<REQUESTS; i++){
+		double u = sum*rand()/((double) RAND_MAX + 1);
+		long lo = 0, hi = KEYS - 1;
+
+		while(lo < hi){
+			long mid = (lo + hi)/2;
+			if(cdf[mid] < u)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+
+		/*
+		 * the popular keys are scattered in the key space
+		 */
+		requests[i] = lo*2654435761UL % KEYS;
+	}
+
+	free(cdf);
+	return requests;
+}
+
+void bench_map_queue(long* requests)
+{
+	map_t m;
+	queue_t q;
+	entry_t e;
+	entry_t* p;
+	clock_t c;
+	long i, hits = 0, oldest;
+
+	map_create(&m, sizeof(long), sizeof(entry_t));
+	queue_create(&q, sizeof(long));
+
+	c = clock();
+	for(i = 0; i<REQUESTS; i++){
+		long key = requests[i];
+
+		if(map_find_ptr(&m, &key, (void**) &p) == GERROR_OK){
+			hits++;
+			queue_remove(&q, p->node, NULL);
+			queue_enqueue(&q, &key);
+			p->node = q.tail;
+			continue;
+		}
+
+		if(q.size == CAPACITY){
+			queue_dequeue(&q, &oldest);
+			map_remove(&m, &oldest, NULL);
+		}
+
+		queue_enqueue(&q, &key);
+		e.node = q.tail;
+		e.value = key;
+		map_insert(&m, &key, &e);
+	}
+	printf("map + queue %7.3f s   hit ratio %.3f\n", seconds(c), (double) hits/REQUESTS);
+
+	map_destroy(&m);
+	queue_destroy(&q);
+}
+
+void bench_cache(char* name, cache_policy_t policy, long* requests)
+{
+	cache_t cache;
+	clock_t c;
+	long i, value;
+
+	cache_create(&cache, sizeof(long), sizeof(long), CAPACITY, policy);
+
+	c = clock();
+	for(i = 0; i<REQUESTS; i++){
+		long key = requests[i];
+
+		if(cache_get(&cache, &key, &value) != GERROR_OK)
+			cache_put(&cache, &key, &key);
+	}
+	printf("%-11s %7.3f s   hit ratio %.3f   (%lu evictions)\n",
+			name,
+			seconds(c),
+			(double) cache.hits/(cache.hits + cache.misses),
+			(unsigned long) cache.evictions);
+
+	cache_destroy(&cache);
+}
+
+int main()
+{
+	long* requests;
+
+	srand(42);
+	requests = zipf_requests();
+
+	bench_map_queue(requests);
+	bench_cache("cache LRU", G_CACHE_LRU, requests);
+	bench_cache("cache CLOCK", G_CACHE_CLOCK, requests);
+
+	free(requests);
+
+	return 0;
+}
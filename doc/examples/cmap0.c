@@ -0,0 +1,138 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+#include <generics/concurrent_map.h>
+#include <generics/map.h>
+
+/*
+ * throughput of the concurrent map and of a map_t behind a
+ * single read-write lock, for several read/write mixes and
+ * numbers of threads
+ */
+
+#define NKEYS		100000
+#define MAX_THREADS	8
+#define DURATION	0.2
+
+cmap_t cm;
+map_t m;
+pthread_rwlock_t lock;
+volatile int running;
+int write_percent;
+int use_cmap;
+
+double now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+void* worker(void* arg)
+{
+	unsigned long* ops = arg;
+	unsigned int seed = (unsigned long) arg;
+	size_t thread = 0;
+
+	if(use_cmap)
+		cmap_register(&cm, &thread);
+
+	while(running){
+		long key = rand_r(&seed) % (2*NKEYS);
+		long elem = key;
+		int write = (int)(rand_r(&seed) % 100) < write_percent;
+
+		if(use_cmap){
+			if(!write)
+				cmap_at(&cm, thread, &key, &elem);
+			else if(rand_r(&seed) % 2)
+				cmap_insert(&cm, thread, &key, &elem);
+			else
+				cmap_remove(&cm, thread, &key, &elem);
+		}else{
+			if(!write){
+				pthread_rwlock_rdlock(&lock);
+				map_at(&m, &key, &elem);
+			}else{
+				pthread_rwlock_wrlock(&lock);
+				if(rand_r(&seed) % 2)
+					map_insert(&m, &key, &elem);
+				else
+					map_remove(&m, &key, &elem);
+			}
+			pthread_rwlock_unlock(&lock);
+		}
+
+		(*ops)++;
+	}
+
+	if(use_cmap)
+		cmap_unregister(&cm, thread);
+
+	return NULL;
+}
+
+double run(int nthreads)
+{
+	pthread_t threads[MAX_THREADS];
+	unsigned long counters[MAX_THREADS] = { 0 };
+	unsigned long ops = 0;
+	int i;
+
+	running = 1;
+	for(i = 0; i<nthreads; i++)
+		pthread_create(&threads[i], NULL, worker, &counters[i]);
+
+	double start = now();
+	while(now() - start < DURATION)
+		;
+	running = 0;
+
+	for(i = 0; i<nthreads; i++){
+		pthread_join(threads[i], NULL);
+		ops += counters[i];
+	}
+
+	return ops/(now() - start);
+}
+
+int main()
+{
+	int mixes[] = { 0, 10, 50 };
+	int i, nthreads;
+	long key;
+
+	cmap_create(&cm, sizeof(long), sizeof(long), MAX_THREADS + 1);
+	map_create(&m, sizeof(long), sizeof(long));
+	pthread_rwlock_init(&lock, NULL);
+
+	size_t thread;
+	cmap_register(&cm, &thread);
+	for(key = 0; key<2*NKEYS; key += 2){
+		cmap_insert(&cm, thread, &key, &key);
+		map_insert(&m, &key, &key);
+	}
+	cmap_unregister(&cm, thread);
+
+	for(i = 0; i<3; i++){
+		write_percent = mixes[i];
+		printf("%d%% writes\n", write_percent);
+
+		for(nthreads = 1; nthreads<=MAX_THREADS; nthreads *= 2){
+			use_cmap = 1;
+			double c = run(nthreads);
+			use_cmap = 0;
+			double r = run(nthreads);
+
+			printf("  %d thread(s): cmap %10.0f ops/s   map+rwlock %10.0f ops/s\n",
+				nthreads, c, r);
+		}
+	}
+
+	pthread_rwlock_destroy(&lock);
+	map_destroy(&m);
+	cmap_destroy(&cm);
+
+	return 0;
+}
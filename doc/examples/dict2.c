@@ -0,0 +1,70 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <generics/dict.h>
+
+/*
+ * symbol table benchmark: identifiers with a common prefix are
+ * inserted and then looked up many times, with the keys in a
+ * red-black tree and in a hash table (G_DICT_HASH), case
+ * sensitive and case insensitive
+ */
+
+#define SYMBOLS 100000
+#define LOOKUPS 2000000
+
+double seconds(clock_t start)
+{
+	return (double)(clock() - start)/CLOCKS_PER_SEC;
+}
+
+void bench(const char* name, int flags, char** symbols, long* lookups)
+{
+	dict_t d;
+	long i, sum = 0, v;
+	clock_t start;
+
+	dict_create(&d, sizeof(long), flags);
+
+	for(i = 0; i < SYMBOLS; i++)
+		dict_insert(&d, symbols[i], &i);
+
+	start = clock();
+	for(i = 0; i < LOOKUPS; i++){
+		dict_at(&d, symbols[lookups[i]], &v);
+		sum += v;
+	}
+
+	printf("%-28s %.3f s (sum %ld)\n", name, seconds(start), sum);
+
+	dict_destroy(&d);
+}
+
+int main()
+{
+	char** symbols = (char**) malloc(SYMBOLS*sizeof(char*));
+	long* lookups = (long*) malloc(LOOKUPS*sizeof(long));
+	long i;
+
+	srand(42);
+	for(i = 0; i < SYMBOLS; i++){
+		symbols[i] = (char*) malloc(32);
+		sprintf(symbols[i], "module_function_%ld", (long) rand());
+	}
+
+	for(i = 0; i < LOOKUPS; i++)
+		lookups[i] = rand()%SYMBOLS;
+
+	bench("tree", G_DICT_CASE_SENSITIVE, symbols, lookups);
+	bench("hash", G_DICT_CASE_SENSITIVE | G_DICT_HASH, symbols, lookups);
+	bench("tree, case insensitive", G_DICT_CASE_INSENSITIVE, symbols, lookups);
+	bench("hash, case insensitive", G_DICT_CASE_INSENSITIVE | G_DICT_HASH, symbols, lookups);
+
+	for(i = 0; i < SYMBOLS; i++)
+		free(symbols[i]);
+
+	free(symbols);
+	free(lookups);
+
+	return 0;
+}
@@ -0,0 +1,101 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <generics/map.h>
+#include <generics/dict.h>
+
+/*
+ * insert and destroy of many short keys: a map of keys each
+ * allocated with malloc, as dict_t did before its string arena,
+ * against dict_t, and the bytes taken by the keys in the arena
+ */
+
+#define KEYS 1000000
+
+double seconds(clock_t start)
+{
+	return (double)(clock() - start)/CLOCKS_PER_SEC;
+}
+
+int compare_str(void* a, void* b, void* arg)
+{
+	char* sa;
+	char* sb;
+	(void) arg;
+
+	memcpy(&sa, a, sizeof(char*));
+	memcpy(&sb, b, sizeof(char*));
+
+	int r = strcmp(sa, sb);
+	return r < 0 ? G_RB_FIRST_IS_SMALLER : (r > 0 ? G_RB_FIRST_IS_GREATER : G_RB_EQUAL);
+}
+
+size_t hash_str(void* key, size_t size, void* arg)
+{
+	char* s;
+	(void) size;
+	(void) arg;
+
+	memcpy(&s, key, sizeof(char*));
+
+	return hashmap_default_hash_function(s, strlen(s), NULL);
+}
+
+int free_key(void* key, void* elem, void* arg)
+{
+	char* s;
+	(void) elem;
+	(void) arg;
+
+	memcpy(&s, key, sizeof(char*));
+	free(s);
+
+	return 0;
+}
+
+int main()
+{
+	char buf[32];
+	long i;
+	clock_t start;
+
+	map_t m;
+	map_create_backend(&m, sizeof(char*), sizeof(long), G_MAP_HASH);
+	map_set_compare_function(&m, compare_str, NULL);
+	map_set_hash_function(&m, hash_str, NULL);
+
+	start = clock();
+	for(i = 0; i < KEYS; i++){
+		sprintf(buf, "k%ld", i);
+
+		char* key = (char*) malloc(strlen(buf) + 1);
+		strcpy(key, buf);
+		map_insert(&m, &key, &i);
+	}
+	map_foreach(&m, free_key, NULL);
+	map_destroy(&m);
+	printf("malloc per key   %.3f s\n", seconds(start));
+
+	dict_t d;
+	dict_create(&d, sizeof(long), G_DICT_HASH);
+
+	start = clock();
+	for(i = 0; i < KEYS; i++){
+		sprintf(buf, "k%ld", i);
+		dict_insert(&d, buf, &i);
+	}
+
+	size_t bytes = 0, chunks = 0;
+	dict_chunk_t* c;
+	for(c = d.chunks; c; c = c->next){
+		bytes += c->used;
+		chunks++;
+	}
+
+	dict_destroy(&d);
+	printf("dict arena       %.3f s, %.2f bytes per key in %lu chunks\n",
+			seconds(start), (double) bytes/KEYS, (unsigned long) chunks);
+
+	return 0;
+}
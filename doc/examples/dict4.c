@@ -0,0 +1,124 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <generics/map.h>
+#include <generics/dict.h>
+
+/*
+ * lookups of short keys in a tree: a map of pointers to the
+ * keys, as dict_t stored them before, against dict_t, which
+ * keeps the keys shorter than DICT_INLINE_KEY in the nodes
+ */
+
+#define KEYS 200000
+#define LOOKUPS 2000000
+
+double seconds(clock_t start)
+{
+	return (double)(clock() - start)/CLOCKS_PER_SEC;
+}
+
+int compare_str(void* a, void* b, void* arg)
+{
+	char* sa;
+	char* sb;
+	(void) arg;
+
+	memcpy(&sa, a, sizeof(char*));
+	memcpy(&sb, b, sizeof(char*));
+
+	int r = strcmp(sa, sb);
+	return r < 0 ? G_RB_FIRST_IS_SMALLER : (r > 0 ? G_RB_FIRST_IS_GREATER : G_RB_EQUAL);
+}
+
+int free_key(void* key, void* elem, void* arg)
+{
+	char* s;
+	(void) elem;
+	(void) arg;
+
+	memcpy(&s, key, sizeof(char*));
+	free(s);
+
+	return 0;
+}
+
+int main()
+{
+	char** keys = (char**) malloc(KEYS*sizeof(char*));
+	long* lookups = (long*) malloc(LOOKUPS*sizeof(long));
+	long i, v, sum;
+	clock_t start;
+
+	srand(7);
+	for(i = 0; i < KEYS; i++){
+		keys[i] = (char*) malloc(16);
+		sprintf(keys[i], "sym%ld", (long) rand()%100000000);
+	}
+	for(i = 0; i < LOOKUPS; i++)
+		lookups[i] = rand()%KEYS;
+
+	map_t m;
+	map_create(&m, sizeof(char*), sizeof(long));
+	map_set_compare_function(&m, compare_str, NULL);
+
+	/*
+	 * the keys are allocated in random order, as they
+	 * would be by a program that reads them
+	 */
+	for(i = 0; i < KEYS; i++){
+		char* key = (char*) malloc(strlen(keys[i]) + 1);
+		long* p;
+		int inserted;
+
+		strcpy(key, keys[i]);
+		if(map_emplace(&m, &key, (void**) &p, &inserted) != GERROR_OK){
+			free(key);
+			continue;
+		}
+
+		/*
+		 * a repeated key keeps the copy already in the map
+		 */
+		if(!inserted)
+			free(key);
+		*p = i;
+	}
+
+	sum = 0;
+	start = clock();
+	for(i = 0; i < LOOKUPS; i++){
+		char* key = keys[lookups[i]];
+		map_at(&m, &key, &v);
+		sum += v;
+	}
+	printf("pointers to keys  %.3f s (sum %ld)\n", seconds(start), sum);
+
+	map_foreach(&m, free_key, NULL);
+	map_destroy(&m);
+
+	dict_t d;
+	dict_create(&d, sizeof(long), G_DICT_CASE_SENSITIVE);
+
+	for(i = 0; i < KEYS; i++)
+		dict_insert(&d, keys[i], &i);
+
+	sum = 0;
+	start = clock();
+	for(i = 0; i < LOOKUPS; i++){
+		dict_at(&d, keys[lookups[i]], &v);
+		sum += v;
+	}
+	printf("inline keys       %.3f s (sum %ld)\n", seconds(start), sum);
+
+	dict_destroy(&d);
+
+	for(i = 0; i < KEYS; i++)
+		free(keys[i]);
+
+	free(keys);
+	free(lookups);
+
+	return 0;
+}
@@ -0,0 +1,100 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <generics/dict.h>
+
+/*
+ * autocomplete over configuration keys "namespace.section.key":
+ * the keys with a prefix are found scanning all the keys of the
+ * dict and with dict_foreach_prefix; dict_range lists the keys
+ * between two namespaces
+ */
+
+#define NAMESPACES 200
+#define KEYS 200000
+#define QUERIES 1000
+
+/* queries made by scanning, which are much slower */
+#define SCANS 20
+
+typedef struct query_t {
+	const char* prefix;
+	size_t len;
+	long count;
+} query_t;
+
+double seconds(clock_t start)
+{
+	return (double)(clock() - start)/CLOCKS_PER_SEC;
+}
+
+int scan_key(const char* key, void* elem, void* arg)
+{
+	query_t* q = (query_t*) arg;
+	(void) elem;
+
+	if(strncasecmp(key, q->prefix, q->len) == 0)
+		q->count++;
+
+	return 0;
+}
+
+int count_key(const char* key, void* elem, void* arg)
+{
+	(void) key;
+	(void) elem;
+
+	(*(long*) arg)++;
+
+	return 0;
+}
+
+int main()
+{
+	char buf[64];
+	char prefixes[QUERIES][32];
+	long i, count;
+	clock_t start;
+	query_t q;
+
+	dict_t d;
+	dict_create(&d, sizeof(long), G_DICT_CASE_INSENSITIVE);
+
+	srand(3);
+	for(i = 0; i < KEYS; i++){
+		sprintf(buf, "ns%d.Section%d.key%ld", rand()%NAMESPACES, rand()%10, i);
+		dict_insert(&d, buf, &i);
+	}
+
+	for(i = 0; i < QUERIES; i++)
+		sprintf(prefixes[i], "NS%d.section%d.", rand()%NAMESPACES, rand()%10);
+
+	count = 0;
+	start = clock();
+	for(i = 0; i < SCANS; i++){
+		q.prefix = prefixes[i];
+		q.len = strlen(prefixes[i]);
+		q.count = 0;
+
+		dict_range(&d, NULL, NULL, scan_key, &q);
+		count += q.count;
+	}
+	printf("scan of all keys     %.3f ms per query (%ld keys in %d queries)\n",
+			seconds(start)*1000/SCANS, count, SCANS);
+
+	count = 0;
+	start = clock();
+	for(i = 0; i < QUERIES; i++)
+		dict_foreach_prefix(&d, prefixes[i], count_key, &count);
+	printf("dict_foreach_prefix  %.3f ms per query (%ld keys in %d queries)\n",
+			seconds(start)*1000/QUERIES, count, QUERIES);
+
+	count = 0;
+	dict_range(&d, "ns10.", "ns11.", count_key, &count);
+	printf("%ld keys in [ns10., ns11.)\n", count);
+
+	dict_destroy(&d);
+
+	return 0;
+}
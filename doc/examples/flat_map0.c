@@ -0,0 +1,82 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <generics/map.h>
+#include <generics/flat_map.h>
+
+/*
+ * lookups in a map_t, in a sorted flat_map_t and in a frozen
+ * flat_map_t (Eytzinger layout), for a small map and for a
+ * large one built once with flat_map_push and flat_map_sort;
+ * the keys are long and use the default compare functions
+ */
+
+#define LOOKUPS 4000000
+
+double seconds(clock_t start)
+{
+	return (double)(clock() - start)/CLOCKS_PER_SEC;
+}
+
+void bench(long n)
+{
+	map_t m;
+	flat_map_t fm;
+	clock_t c;
+	long i, key, elem, found;
+	long* keys = (long*) malloc(n*sizeof(long));
+
+	for(i = 0; i<n; i++)
+		keys[i] = ((long)rand() << 16) ^ rand();
+
+	map_create(&m, sizeof(long), sizeof(long));
+	flat_map_create(&fm, sizeof(long), sizeof(long));
+
+	c = clock();
+	for(i = 0; i<n; i++)
+		map_insert(&m, &keys[i], &i);
+	printf("%8ld pairs: build map_t %7.3f s", n, seconds(c));
+
+	c = clock();
+	for(i = 0; i<n; i++)
+		flat_map_push(&fm, &keys[i], &i);
+	flat_map_sort(&fm);
+	printf(", flat_map_t %7.3f s\n", seconds(c));
+
+	c = clock();
+	for(i = 0, found = 0; i<LOOKUPS; i++){
+		key = keys[(i*7919)%n];
+		found += map_at(&m, &key, &elem) == GERROR_OK;
+	}
+	printf("\tmap_t            %7.3f s (%ld found)\n", seconds(c), found);
+
+	c = clock();
+	for(i = 0, found = 0; i<LOOKUPS; i++){
+		key = keys[(i*7919)%n];
+		found += flat_map_at(&fm, &key, &elem) == GERROR_OK;
+	}
+	printf("\tflat_map_t       %7.3f s (%ld found)\n", seconds(c), found);
+
+	flat_map_freeze(&fm);
+
+	c = clock();
+	for(i = 0, found = 0; i<LOOKUPS; i++){
+		key = keys[(i*7919)%n];
+		found += flat_map_at(&fm, &key, &elem) == GERROR_OK;
+	}
+	printf("\tfrozen flat_map  %7.3f s (%ld found)\n", seconds(c), found);
+
+	map_destroy(&m);
+	flat_map_destroy(&fm);
+	free(keys);
+}
+
+int main()
+{
+	srand(42);
+
+	bench(32);
+	bench(1000000);
+
+	return 0;
+}
@@ -0,0 +1,34 @@
+#include <stdio.h>
+#include <generics/interval_tree.h>
+
+int print_booking(long lo, long hi, void* elem, void* arg)
+{
+	(void) arg;
+	printf("\t[%02ld:00, %02ld:00) %s\n", lo, hi, *(char**)elem);
+	return 0;
+}
+
+int main()
+{
+	interval_tree_t it;
+	interval_tree_create(&it, sizeof(char*));
+
+	char* names[] = { "standup", "review", "lunch", "planning", "on call", "retro" };
+	long lo[] = { 9, 11, 12, 14, 8, 16 };
+	long hi[] = { 10, 13, 13, 16, 18, 17 };
+
+	int i;
+	for(i = 0; i<6; i++)
+		interval_tree_add(&it, lo[i], hi[i], &names[i]);
+
+	printf("bookings overlapping [12:00, 15:00):\n");
+	interval_tree_overlaps(&it, 12, 15, print_booking, NULL);
+
+	interval_tree_remove(&it, 8, 18, NULL);
+
+	printf("bookings overlapping [09:00, 10:00) without the on call:\n");
+	interval_tree_overlaps(&it, 9, 10, print_booking, NULL);
+
+	interval_tree_destroy(&it);
+	return 0;
+}
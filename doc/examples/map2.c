@@ -0,0 +1,43 @@
+#include <stdio.h>
+#include <generics/map.h>
+
+#define N 100
+
+int print_pair(void* key, void* elem, void* arg)
+{
+	int* count = (int*) arg;
+
+	printf("%ld -> %ld\n", *(long*)key, *(long*)elem);
+
+	/*
+	 * stop after 5 pairs
+	 */
+	return ++(*count) == 5;
+}
+
+int main()
+{
+	map_t m;
+	map_create(&m, sizeof(long), sizeof(long));
+
+	long i;
+	for(i = 0; i<N; i++){
+		long key = (i*37)%N;
+		long square = key*key;
+		map_insert(&m, &key, &square);
+	}
+
+	long lo = 10, hi = 13;
+	int count = 0;
+
+	printf("keys in [%ld, %ld):\n", lo, hi);
+	map_range(&m, &lo, &hi, print_pair, &count);
+
+	lo = 90;
+	count = 0;
+	printf("first 5 keys from %ld:\n", lo);
+	map_range(&m, &lo, NULL, print_pair, &count);
+
+	map_destroy(&m);
+	return 0;
+}
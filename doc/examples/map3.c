@@ -0,0 +1,87 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <generics/map.h>
+
+/*
+ * benchmark of the map backends: random inserts, random
+ * finds and a full scan, ordered for the trees; the number
+ * of keys may be given in the command line
+ */
+
+#define N 1000000
+
+double seconds(clock_t start)
+{
+	return (double)(clock() - start)/CLOCKS_PER_SEC;
+}
+
+int sum_pair(void* key, void* elem, void* arg)
+{
+	(void) key;
+	*(long*)arg += *(long*)elem;
+	return 0;
+}
+
+/*
+ * the default compare function of map uses the key size to
+ * choose the type; a direct one is used in the tree backends.
+ * The hash backend compares the bytes of the keys.
+ */
+int compare_long(void* a, void* b, void* arg)
+{
+	(void) arg;
+	long x = *(long*)a;
+	long y = *(long*)b;
+
+	return (x > y) - (x < y);
+}
+
+void bench(char* name, map_backend_t backend, long* keys, long n)
+{
+	map_t m;
+	clock_t c;
+	long i, sum = 0, found = 0;
+
+	map_create_backend(&m, sizeof(long), sizeof(long), backend);
+	if(backend != G_MAP_HASH)
+		map_set_compare_function(&m, compare_long, NULL);
+
+	c = clock();
+	for(i = 0; i<n; i++)
+		map_insert(&m, &keys[i], &i);
+	printf("%-10s insert %8.3f s", name, seconds(c));
+
+	c = clock();
+	for(i = 0; i<n; i++){
+		long elem;
+		if(map_at(&m, &keys[(i*7919)%n], &elem) == GERROR_OK)
+			found++;
+	}
+	printf("   find %8.3f s", seconds(c));
+
+	c = clock();
+	map_foreach(&m, sum_pair, &sum);
+	printf("   scan %8.3f s   (%ld found, sum %ld)\n", seconds(c), found, sum);
+
+	map_destroy(&m);
+}
+
+int main(int argc, char* argv[])
+{
+	long n = argc > 1 ? atol(argv[1]) : N;
+	long* keys = (long*) malloc(n*sizeof(long));
+	long i;
+
+	srand(42);
+	for(i = 0; i<n; i++)
+		keys[i] = ((long)rand() << 16) ^ rand();
+
+	bench("rbtree", G_MAP_RBTREE, keys, n);
+	bench("btree", G_MAP_BTREE, keys, n);
+	bench("hash", G_MAP_HASH, keys, n);
+	bench("persistent", G_MAP_PERSISTENT, keys, n);
+
+	free(keys);
+	return 0;
+}
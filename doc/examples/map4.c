@@ -0,0 +1,75 @@
+#include <stdio.h>
+#include <pthread.h>
+#include <generics/map.h>
+
+#define ACCOUNTS 1000
+#define TRANSFERS 100000
+#define SNAPSHOTS 4
+
+int sum_balance(void* key, void* elem, void* arg)
+{
+	(void) key;
+	*(long*)arg += *(long*)elem;
+	return 0;
+}
+
+/*
+ * the reader sees the balances of the moment of the snapshot,
+ * so the total is always the same, while the writer keeps
+ * moving money between the accounts
+ */
+void* reader(void* arg)
+{
+	map_t* snapshot = (map_t*) arg;
+	long total = 0;
+
+	map_foreach(snapshot, sum_balance, &total);
+	printf("total in snapshot: %ld\n", total);
+
+	map_destroy(snapshot);
+	return NULL;
+}
+
+int main()
+{
+	map_t accounts;
+	map_t snapshots[SNAPSHOTS];
+	pthread_t readers[SNAPSHOTS];
+	long i;
+	int s = 0;
+
+	map_create_backend(&accounts, sizeof(long), sizeof(long), G_MAP_PERSISTENT);
+
+	for(i = 0; i<ACCOUNTS; i++){
+		long balance = 100;
+		map_insert(&accounts, &i, &balance);
+	}
+
+	for(i = 0; i<TRANSFERS; i++){
+		long from = (i*7919)%ACCOUNTS;
+		long to = (i*104729 + 1)%ACCOUNTS;
+		long a, b;
+
+		map_at(&accounts, &from, &a);
+		map_at(&accounts, &to, &b);
+		a -= 10;
+		b += 10;
+		map_insert(&accounts, &from, &a);
+		map_insert(&accounts, &to, &b);
+
+		/*
+		 * the snapshot is O(1) and is taken by the writer
+		 */
+		if(i % (TRANSFERS/SNAPSHOTS) == 0){
+			map_snapshot(&accounts, &snapshots[s]);
+			pthread_create(&readers[s], NULL, reader, &snapshots[s]);
+			s++;
+		}
+	}
+
+	for(s = 0; s<SNAPSHOTS; s++)
+		pthread_join(readers[s], NULL);
+
+	map_destroy(&accounts);
+	return 0;
+}
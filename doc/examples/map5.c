@@ -0,0 +1,89 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <generics/map.h>
+
+/*
+ * counting the occurrences of skewed keys: with map_at and
+ * map_insert the tree is descended twice per key and the pair
+ * is copied through a temporary, while map_emplace finds or
+ * inserts the pair in one descent and the count is updated in
+ * place; the number of keys may be given in the command line
+ */
+
+#define N 1000000
+#define DISTINCT 50000
+
+double seconds(clock_t start)
+{
+	return (double)(clock() - start)/CLOCKS_PER_SEC;
+}
+
+int compare_long(void* a, void* b, void* arg)
+{
+	long x = *(long*)a;
+	long y = *(long*)b;
+	(void) arg;
+
+	return (x > y) - (x < y);
+}
+
+void bench(char* name, map_backend_t backend, long* keys, long n)
+{
+	map_t m;
+	clock_t c;
+	long i, count, distinct;
+	long* p;
+	int inserted;
+
+	map_create_backend(&m, sizeof(long), sizeof(long), backend);
+	if(backend != G_MAP_HASH)
+		map_set_compare_function(&m, compare_long, NULL);
+
+	c = clock();
+	for(i = 0; i<n; i++){
+		count = 0;
+		map_at(&m, &keys[i], &count);
+		count++;
+		map_insert(&m, &keys[i], &count);
+	}
+	printf("%-10s at+insert %8.3f s", name, seconds(c));
+	map_destroy(&m);
+
+	map_create_backend(&m, sizeof(long), sizeof(long), backend);
+	if(backend != G_MAP_HASH)
+		map_set_compare_function(&m, compare_long, NULL);
+
+	c = clock();
+	for(i = 0, distinct = 0; i<n; i++){
+		map_emplace(&m, &keys[i], (void**) &p, &inserted);
+		(*p)++;
+		distinct += inserted;
+	}
+	printf("   emplace %8.3f s   (%ld distinct)\n", seconds(c), distinct);
+	map_destroy(&m);
+}
+
+int main(int argc, char* argv[])
+{
+	long n = argc > 1 ? atol(argv[1]) : N;
+	long* keys = (long*) malloc(n*sizeof(long));
+	long i;
+
+	/*
+	 * the product of two uniform numbers makes
+	 * the small keys much more frequent
+	 */
+	srand(42);
+	for(i = 0; i<n; i++)
+		keys[i] = (long)(rand()%DISTINCT) * (rand()%DISTINCT) / DISTINCT;
+
+	bench("rbtree", G_MAP_RBTREE, keys, n);
+	bench("btree", G_MAP_BTREE, keys, n);
+	bench("hash", G_MAP_HASH, keys, n);
+	bench("persistent", G_MAP_PERSISTENT, keys, n);
+
+	free(keys);
+
+	return 0;
+}
@@ -0,0 +1,70 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <generics/map.h>
+
+/*
+ * lookups of records of 256 bytes: map_at copies each record
+ * out of the map, while map_find_ptr returns a pointer to the
+ * record stored in the map, which is read in place
+ */
+
+#define N 100000
+#define LOOKUPS 2000000
+
+typedef struct record_t {
+	long id;
+	long balance;
+	char payload[240];
+} record_t;
+
+double seconds(clock_t start)
+{
+	return (double)(clock() - start)/CLOCKS_PER_SEC;
+}
+
+void bench(char* name, map_backend_t backend)
+{
+	map_t m;
+	record_t r;
+	record_t* p;
+	clock_t c;
+	long i, key, sum;
+
+	map_create_backend(&m, sizeof(long), sizeof(record_t), backend);
+
+	memset(&r, 0, sizeof(record_t));
+	for(i = 0; i<N; i++){
+		r.id = i;
+		r.balance = i % 100;
+		map_insert(&m, &i, &r);
+	}
+
+	c = clock();
+	for(i = 0, sum = 0; i<LOOKUPS; i++){
+		key = (i*7919) % N;
+		if(map_at(&m, &key, &r) == GERROR_OK)
+			sum += r.balance;
+	}
+	printf("%-10s map_at %8.3f s", name, seconds(c));
+
+	c = clock();
+	for(i = 0; i<LOOKUPS; i++){
+		key = (i*7919) % N;
+		if(map_find_ptr(&m, &key, (void**) &p) == GERROR_OK)
+			sum -= p->balance;
+	}
+	printf("   map_find_ptr %8.3f s   (difference %ld)\n", seconds(c), sum);
+
+	map_destroy(&m);
+}
+
+int main()
+{
+	bench("rbtree", G_MAP_RBTREE);
+	bench("btree", G_MAP_BTREE);
+	bench("hash", G_MAP_HASH);
+	bench("persistent", G_MAP_PERSISTENT);
+
+	return 0;
+}
@@ -0,0 +1,92 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <generics/red_black_tree.h>
+#include <generics/multimap.h>
+
+/*
+ * an index of documents by term: the sum of the documents of
+ * random terms is computed with multimap_equal_range and with
+ * a rbtree keeping the duplicated terms, walked from the lower
+ * bound of the term
+ */
+
+#define TERMS 10000
+#define POSTINGS 1000000
+#define QUERIES 100000
+
+typedef struct posting_t {
+	long term;
+	long document;
+} posting_t;
+
+double seconds(clock_t start)
+{
+	return (double)(clock() - start)/CLOCKS_PER_SEC;
+}
+
+int compare_term(void* a, void* b, void* arg)
+{
+	long x = ((posting_t*)a)->term;
+	long y = ((posting_t*)b)->term;
+	(void) arg;
+
+	return (x > y) - (x < y);
+}
+
+int sum_document(void* key, void* elem, void* arg)
+{
+	(void) key;
+	*(long*)arg += *(long*)elem;
+	return 0;
+}
+
+int main()
+{
+	multimap_t mm;
+	rbtree_t rbt;
+	rbnode_t* node;
+	posting_t p;
+	clock_t c;
+	long i, sum;
+	size_t count;
+
+	multimap_create(&mm, sizeof(long), sizeof(long));
+	rbtree_create(&rbt, sizeof(posting_t));
+	rbtree_set_compare_function(&rbt, compare_term, NULL);
+
+	srand(42);
+	for(i = 0; i<POSTINGS; i++){
+		p.term = rand() % TERMS;
+		p.document = i;
+		multimap_insert(&mm, &p.term, &p.document);
+		rbtree_add(&rbt, &p);
+	}
+
+	c = clock();
+	for(i = 0, sum = 0; i<QUERIES; i++){
+		p.term = (i*7919) % TERMS;
+		multimap_equal_range(&mm, &p.term, sum_document, &sum);
+	}
+	printf("multimap_equal_range %7.3f s (sum %ld)\n", seconds(c), sum);
+
+	c = clock();
+	for(i = 0, sum = 0; i<QUERIES; i++){
+		p.term = (i*7919) % TERMS;
+		rbtree_lower_bound(&rbt, &p, &node);
+		while(node && ((posting_t*)node->data)->term == p.term){
+			sum += ((posting_t*)node->data)->document;
+			rbtree_next(&rbt, node, &node);
+		}
+	}
+	printf("rbtree duplicates    %7.3f s (sum %ld)\n", seconds(c), sum);
+
+	p.term = 42;
+	multimap_count(&mm, &p.term, &count);
+	printf("term %ld is in %lu documents\n", p.term, (unsigned long) count);
+
+	multimap_destroy(&mm);
+	rbtree_destroy(&rbt);
+
+	return 0;
+}
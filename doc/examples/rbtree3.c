@@ -23,11 +23,19 @@ void print_rbt (rbnode_t* node, int t)
 
 rbnode_t* create_node(int v, rbcolor_t c, rbnode_t* l, rbnode_t* r)
 {
-	rbnode_t* node = (rbnode_t*) malloc(sizeof(rbnode_t));
+	/*
+	 * the element and the node are allocated in a single
+	 * block, the element first
+	 */
+	char* block = (char*) malloc(RBNODE_OFFSET(sizeof(int)) + sizeof(rbnode_t));
+	rbnode_t* node = (rbnode_t*) (block + RBNODE_OFFSET(sizeof(int)));
 
 	node->color = c;
+	node->flags = 0;
 	node->parent = NULL;
-	node->data = (void*) malloc(sizeof(int));
+	node->left = NULL;
+	node->right = NULL;
+	node->data = block;
 	memcpy(node->data, &v, sizeof(int));
 
 	if(l){
@@ -0,0 +1,58 @@
+#include <stdio.h>
+#include <generics/red_black_tree.h>
+
+#define N 20
+
+int compare_int(void* a, void* b, void* arg)
+{
+	(void) arg;
+	int x = *(int*)a;
+	int y = *(int*)b;
+
+	return (x > y) - (x < y);
+}
+
+int main()
+{
+	rbtree_t rbt;
+	rbnode_t* n;
+	int i;
+
+	rbtree_create(&rbt, sizeof(int));
+	rbtree_set_compare_function(&rbt, compare_int, NULL);
+
+	/*
+	 * only the even numbers
+	 */
+	for(i = 0; i<N; i++){
+		int v = (i*7)%N*2;
+		rbtree_add(&rbt, &v);
+	}
+
+	printf("in order:");
+	for(rbtree_first(&rbt, &n); n; rbtree_next(&rbt, n, &n))
+		printf(" %d", *(int*)n->data);
+	printf("\n");
+
+	printf("reverse order:");
+	for(rbtree_last(&rbt, &n); n; rbtree_prev(&rbt, n, &n))
+		printf(" %d", *(int*)n->data);
+	printf("\n");
+
+	int key = 11;
+	rbtree_lower_bound(&rbt, &key, &n);
+	printf("lower bound of %d: %d\n", key, *(int*)n->data);
+
+	key = 12;
+	rbtree_lower_bound(&rbt, &key, &n);
+	printf("lower bound of %d: %d\n", key, *(int*)n->data);
+	rbtree_upper_bound(&rbt, &key, &n);
+	printf("upper bound of %d: %d\n", key, *(int*)n->data);
+
+	key = 38;
+	rbtree_upper_bound(&rbt, &key, &n);
+	printf("upper bound of %d: %s\n", key, n ? "found" : "none");
+
+	rbtree_destroy(&rbt);
+	return 0;
+}
@@ -0,0 +1,60 @@
+#include <stdio.h>
+#include <time.h>
+#include <generics/red_black_tree.h>
+
+#define N 1000000
+
+int compare_int(void* a, void* b, void* arg)
+{
+	(void) arg;
+	int x = *(int*)a;
+	int y = *(int*)b;
+
+	return (x > y) - (x < y);
+}
+
+int main()
+{
+	static int sorted[N];
+	rbtree_t rbt;
+	clock_t c;
+	int i;
+
+	for(i = 0; i<N; i++)
+		sorted[i] = 2*i;
+
+	/*
+	 * one add per element
+	 */
+	rbtree_create(&rbt, sizeof(int));
+	rbtree_set_compare_function(&rbt, compare_int, NULL);
+
+	c = clock();
+	for(i = 0; i<N; i++)
+		rbtree_add(&rbt, &sorted[i]);
+	printf("rbtree_add:          %f s\n", (double)(clock() - c)/CLOCKS_PER_SEC);
+
+	rbtree_destroy(&rbt);
+
+	/*
+	 * linear build from the sorted array
+	 */
+	rbtree_create(&rbt, sizeof(int));
+	rbtree_set_compare_function(&rbt, compare_int, NULL);
+
+	c = clock();
+	rbtree_build_sorted(&rbt, sorted, N);
+	printf("rbtree_build_sorted: %f s\n", (double)(clock() - c)/CLOCKS_PER_SEC);
+
+	/*
+	 * the tree can be changed as usual after the build
+	 */
+	i = 7;
+	rbtree_add(&rbt, &i);
+	i = 8;
+	rbtree_remove_item(&rbt, &i);
+	printf("size: %lu\n", (unsigned long) rbt.size);
+
+	rbtree_destroy(&rbt);
+	return 0;
+}
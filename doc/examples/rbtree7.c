@@ -0,0 +1,62 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <generics/red_black_tree.h>
+
+#define N 100000
+
+int compare_latency(void* a, void* b, void* arg)
+{
+	(void) arg;
+	double x = *(double*)a;
+	double y = *(double*)b;
+
+	return (x > y) - (x < y);
+}
+
+/*
+ * the latency at `p` percent of the measurements
+ */
+double percentile(rbtree_t* rbt, double p)
+{
+	rbnode_t* node;
+	size_t k = (size_t)(p/100.0*(rbt->size - 1));
+
+	rbtree_select(rbt, k, &node);
+	return *(double*)node->data;
+}
+
+int main()
+{
+	rbtree_t rbt;
+	int i;
+
+	/*
+	 * equal latencies are kept, so it is a multiset
+	 */
+	rbtree_create(&rbt, sizeof(double));
+	rbtree_set_compare_function(&rbt, compare_latency, NULL);
+	rbtree_set_flags(&rbt, G_RB_ORDER_STATISTIC);
+
+	srand(42);
+	for(i = 0; i<N; i++){
+		double latency = (rand()%1000)/10.0;
+		if(rand()%100 == 0)
+			latency *= 10;
+		rbtree_add(&rbt, &latency);
+	}
+
+	printf("p50 %.1f ms\n", percentile(&rbt, 50));
+	printf("p90 %.1f ms\n", percentile(&rbt, 90));
+	printf("p99 %.1f ms\n", percentile(&rbt, 99));
+
+	double limit = 100.0;
+	size_t rank;
+	rbtree_rank(&rbt, &limit, &rank);
+	printf("%lu of %lu requests under %.1f ms\n",
+			(unsigned long) rank,
+			(unsigned long) rbt.size,
+			limit);
+
+	rbtree_destroy(&rbt);
+	return 0;
+}
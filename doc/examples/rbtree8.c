@@ -0,0 +1,90 @@
+#include <stdio.h>
+#include <time.h>
+#include <generics/red_black_tree.h>
+
+#define N 1000000
+#define M 500000
+
+int compare_int(void* a, void* b, void* arg)
+{
+	(void) arg;
+	int x = *(int*)a;
+	int y = *(int*)b;
+
+	return (x > y) - (x < y);
+}
+
+void create(rbtree_t* rbt, int* elems, int n)
+{
+	rbtree_create(rbt, sizeof(int));
+	rbtree_set_compare_function(rbt, compare_int, NULL);
+	rbtree_build_sorted(rbt, elems, n);
+}
+
+int main()
+{
+	static int big[N];
+	static int shard[M];
+	rbtree_t a;
+	rbtree_t b;
+	rbtree_t left;
+	rbtree_t right;
+	rbnode_t* node;
+	clock_t c;
+	int i;
+
+	for(i = 0; i<N; i++)
+		big[i] = 2*i;
+	for(i = 0; i<M; i++)
+		shard[i] = 4*i + 1;
+
+	/*
+	 * merging a small shard in a big tree, one add per element
+	 */
+	create(&a, big, N);
+
+	c = clock();
+	for(i = 0; i<M; i++)
+		rbtree_add(&a, &shard[i]);
+	printf("rbtree_add:   %f s, size %lu\n",
+		(double)(clock() - c)/CLOCKS_PER_SEC, (unsigned long) a.size);
+
+	rbtree_destroy(&a);
+
+	/*
+	 * the same merge with the union
+	 */
+	create(&a, big, N);
+	create(&b, shard, M);
+
+	c = clock();
+	rbtree_union(&a, &b);
+	printf("rbtree_union: %f s, size %lu\n",
+		(double)(clock() - c)/CLOCKS_PER_SEC, (unsigned long) a.size);
+
+	/*
+	 * removes the shard again with the difference,
+	 * using up to 4 threads
+	 */
+	create(&b, shard, M);
+	rbtree_set_operation(&a, &b, G_RB_DIFFERENCE, 4);
+	printf("difference:   size %lu\n", (unsigned long) a.size);
+	rbtree_destroy(&b);
+
+	/*
+	 * splits the tree in two halves and joins them back
+	 */
+	i = N;
+	rbtree_split(&a, &i, &left, &right);
+	rbtree_first(&right, &node);
+	printf("split:        %lu + %lu, right starts at %d\n",
+		(unsigned long) left.size, (unsigned long) right.size, *(int*)node->data);
+
+	rbtree_join(&left, &right);
+	printf("join:         size %lu\n", (unsigned long) left.size);
+
+	rbtree_destroy(&right);
+	rbtree_destroy(&left);
+	rbtree_destroy(&a);
+	return 0;
+}
@@ -0,0 +1,149 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <generics/rbtree_typed.h>
+
+#define N 10000
+#define LOOKUPS (100*N)
+
+/*
+ * trees of int and maps of long to long and of int to
+ * long with the comparison inlined in the descents
+ */
+GENERICS_DEFINE_RBTREE(itree, int, (a > b) - (a < b))
+GENERICS_DEFINE_MAP(lmap, long, long, (a > b) - (a < b))
+GENERICS_DEFINE_MAP(imap, int, long, (a > b) - (a < b))
+
+int compare_int(void* a, void* b, void* arg)
+{
+	int x = *(int*)a;
+	int y = *(int*)b;
+	(void) arg;
+
+	return (x > y) - (x < y);
+}
+
+double seconds(clock_t c)
+{
+	return (double)(clock() - c)/CLOCKS_PER_SEC;
+}
+
+int main()
+{
+	static int keys[N];
+	rbtree_t rbt;
+	rbnode_t* node;
+	map_t m;
+	clock_t c;
+	long i, found;
+
+	srand(42);
+	for(i = 0; i<N; i++)
+		keys[i] = rand();
+
+	/*
+	 * generic tree: a call through rbt->compare on each level
+	 */
+	rbtree_create(&rbt, sizeof(int));
+	rbtree_set_compare_function(&rbt, compare_int, NULL);
+
+	c = clock();
+	for(i = 0; i<N; i++)
+		rbtree_add(&rbt, &keys[i]);
+	printf("rbtree_add       %f s\n", seconds(c));
+
+	c = clock();
+	for(i = 0, found = 0; i<LOOKUPS; i++)
+		found += rbtree_find_node(&rbt, &keys[(i*7919)%N], &node) == GERROR_OK;
+	printf("rbtree_find_node %f s (%ld found)\n", seconds(c), found);
+
+	rbtree_destroy(&rbt);
+
+	/*
+	 * the same tree with the inlined comparison
+	 */
+	itree_create(&rbt);
+
+	c = clock();
+	for(i = 0; i<N; i++)
+		itree_add(&rbt, &keys[i]);
+	printf("itree_add        %f s\n", seconds(c));
+
+	c = clock();
+	for(i = 0, found = 0; i<LOOKUPS; i++)
+		found += itree_find(&rbt, &keys[(i*7919)%N], &node) == GERROR_OK;
+	printf("itree_find       %f s (%ld found)\n", seconds(c), found);
+
+	rbtree_destroy(&rbt);
+
+	/*
+	 * map of long to long
+	 */
+	map_create(&m, sizeof(long), sizeof(long));
+
+	c = clock();
+	for(i = 0; i<N; i++){
+		long key = keys[i];
+		map_insert(&m, &key, &i);
+	}
+	printf("map_insert       %f s\n", seconds(c));
+
+	c = clock();
+	for(i = 0, found = 0; i<LOOKUPS; i++){
+		long key = keys[(i*7919)%N], elem;
+		found += map_at(&m, &key, &elem) == GERROR_OK;
+	}
+	printf("map_at           %f s (%ld found)\n", seconds(c), found);
+
+	map_destroy(&m);
+
+	lmap_create(&m);
+
+	c = clock();
+	for(i = 0; i<N; i++){
+		long key = keys[i];
+		lmap_insert(&m, &key, &i);
+	}
+	printf("lmap_insert      %f s\n", seconds(c));
+
+	c = clock();
+	for(i = 0, found = 0; i<LOOKUPS; i++){
+		long key = keys[(i*7919)%N], elem;
+		found += lmap_at(&m, &key, &elem) == GERROR_OK;
+	}
+	printf("lmap_at          %f s (%ld found)\n", seconds(c), found);
+
+	map_destroy(&m);
+
+	/*
+	 * map of int to long: the element is stored after the key
+	 * rounded up, as in map_insert, so the typed functions and
+	 * the map functions can be mixed
+	 */
+	imap_create(&m);
+
+	c = clock();
+	for(i = 0; i<N; i++){
+		if(i%2)
+			imap_insert(&m, &keys[i], &i);
+		else
+			map_insert(&m, &keys[i], &i);
+	}
+	printf("imap_insert      %f s\n", seconds(c));
+
+	c = clock();
+	for(i = 0, found = 0; i<LOOKUPS; i++){
+		long elem, expected;
+		int* key = &keys[(i*7919)%N];
+
+		if(imap_at(&m, key, &elem) == GERROR_OK
+		&& map_at(&m, key, &expected) == GERROR_OK
+		&& elem == expected)
+			found++;
+	}
+	printf("imap_at, map_at  %f s (%ld found)\n", seconds(c), found);
+
+	map_destroy(&m);
+
+	return 0;
+}
@@ -0,0 +1,45 @@
+#include <stdio.h>
+#include <string.h>
+#include <generics/trie.h>
+
+#define FILE_PATH "trie2.trie"
+
+int main()
+{
+	trie_t t;
+	trie_create(&t, sizeof(int));
+
+	char* names[] = { "yudi", "barbara", "raul", "tutu", "boris" };
+	size_t n = sizeof(names)/sizeof(char*);
+
+	size_t i;
+	for(i=0; i<n; i++){
+		int v = i*10;
+		trie_add_element(&t, names[i], strlen(names[i]), &v);
+	}
+
+	g_assert(trie_save(&t, FILE_PATH));
+	trie_destroy(&t);
+
+	/*
+	 * the saved trie is used directly from the mapped file
+	 */
+	trie_mmap_t tm;
+	g_assert(trie_open_mmap(&tm, FILE_PATH));
+
+	for(i=0; i<n; i++){
+		int v;
+		trie_mmap_get_element(&tm, names[i], strlen(names[i]), &v);
+		printf("[%s] = %d\n", names[i], v);
+	}
+
+	char* missing = "bar";
+	int v;
+	gerror_t g = trie_mmap_get_element(&tm, missing, strlen(missing), &v);
+	printf("[%s]: %s\n", missing, gerror_to_str(g));
+
+	trie_close_mmap(&tm);
+	remove(FILE_PATH);
+
+	return 0;
+}
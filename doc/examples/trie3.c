@@ -0,0 +1,132 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <generics/trie.h>
+
+#define NKEYS		20000
+#define MAX_READERS	8
+#define DURATION	0.25
+
+typedef struct value_t {
+	long key;
+	long check;
+} value_t;
+
+trie_t t;
+volatile int running;
+
+double now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+size_t make_key(char* buffer, long i)
+{
+	return sprintf(buffer, "key:%ld", i);
+}
+
+/*
+ * the writer keeps adding, updating and removing keys
+ */
+void* writer(void* arg)
+{
+	unsigned long* writes = arg;
+	unsigned int seed = 1;
+	char key[32];
+
+	while(running){
+		long i = rand_r(&seed) % (2*NKEYS);
+		size_t size = make_key(key, i);
+		value_t v = { i, ~i };
+
+		if(i >= NKEYS && rand_r(&seed) % 2)
+			trie_remove_element(&t, key, size);
+		else
+			trie_add_element(&t, key, size, &v);
+
+		(*writes)++;
+	}
+
+	return NULL;
+}
+
+/*
+ * the readers never block and never see a torn value
+ */
+void* reader(void* arg)
+{
+	unsigned long* reads = arg;
+	unsigned int seed = (unsigned long)arg;
+	size_t id;
+	char key[32];
+
+	g_assert(trie_register_reader(&t, &id));
+
+	while(running){
+		long i = rand_r(&seed) % (2*NKEYS);
+		size_t size = make_key(key, i);
+		value_t v;
+
+		if(trie_concurrent_get_element(&t, id, key, size, &v) == GERROR_OK &&
+		   (v.key != i || v.check != ~i)){
+			fprintf(stderr, "inconsistent value for %s\n", key);
+			exit(EXIT_FAILURE);
+		}
+
+		(*reads)++;
+	}
+
+	trie_unregister_reader(&t, id);
+
+	return NULL;
+}
+
+int main()
+{
+	trie_create(&t, sizeof(value_t));
+	trie_enable_concurrency(&t, MAX_READERS);
+
+	char key[32];
+	long i;
+	for(i=0; i<NKEYS; i++){
+		value_t v = { i, ~i };
+		trie_add_element(&t, key, make_key(key, i), &v);
+	}
+
+	int nreaders;
+	for(nreaders=1; nreaders<=MAX_READERS; nreaders*=2){
+		pthread_t threads[MAX_READERS + 1];
+		unsigned long counters[MAX_READERS + 1] = { 0 };
+		int j;
+
+		running = 1;
+		pthread_create(&threads[0], NULL, writer, &counters[0]);
+		for(j=1; j<=nreaders; j++)
+			pthread_create(&threads[j], NULL, reader, &counters[j]);
+
+		double start = now();
+		while(now() - start < DURATION)
+			;
+		running = 0;
+
+		unsigned long reads = 0;
+		for(j=0; j<=nreaders; j++){
+			pthread_join(threads[j], NULL);
+			if(j)
+				reads += counters[j];
+		}
+
+		double elapsed = now() - start;
+		printf("%d reader(s): %10.0f reads/s %10.0f writes/s\n",
+				nreaders,
+				reads/elapsed,
+				counters[0]/elapsed);
+	}
+
+	trie_destroy(&t);
+
+	return 0;
+}
@@ -0,0 +1,77 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ */
+#ifndef __AHO_CORASICK_H__
+#define __AHO_CORASICK_H__
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "gerror.h"
+#include "trie.h"
+
+/** Minimal number of children for a state to be stored as a
+  * full transition row instead of a sorted list of children.
+  */
+#define AC_DENSE_FANOUT (16)
+
+/** Called for every match found by `ac_scan`.
+  * `end` is the position in the stream right after the match,
+  * `length` is the length of the pattern and `value` points to the
+  * element mapped to the pattern in the trie.
+  * Returning a value different of 0 stops the scan.
+  */
+typedef int (*ac_match_function)(size_t end, size_t length, void* value, void* arg);
+
+/** state of the automaton.
+  */
+typedef struct ac_state_t {
+	uint32_t fail;
+	uint32_t output;
+	uint32_t first_child;
+	uint32_t row;
+	uint32_t depth;
+	uint32_t value;
+	uint16_t nchildren;
+} ac_state_t;
+
+/** Aho-Corasick automaton built from the patterns of a `trie_t`.
+  * The automaton keeps the state of the scan, so a stream can be
+  * scanned in several buffers.
+  */
+typedef struct ac_t {
+	size_t member_size;
+	size_t nstates;
+	size_t nrows;
+
+	size_t state;
+	size_t position;
+
+	struct ac_state_t* states;
+	unsigned char* labels;
+	uint32_t* table;
+	void* values;
+} ac_t;
+
+gerror_t ac_build(struct ac_t* ac, struct trie_t* t);
+gerror_t ac_destroy(struct ac_t* ac);
+gerror_t ac_reset(struct ac_t* ac);
+gerror_t ac_scan(struct ac_t* ac, const void* buffer, size_t size,
+		ac_match_function callback, void* arg);
+
+#endif
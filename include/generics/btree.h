@@ -0,0 +1,101 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ */
+#ifndef __BTREE_H__
+#define __BTREE_H__
+
+#include <stdlib.h>
+#include <string.h>
+#include "gerror.h"
+
+/** Target size in bytes of a btree_t node; the capacity of the
+  * nodes is computed from it, the key size and the member size.
+  * Nodes grow beyond it to keep at least BTREE_MIN_CAPACITY
+  * entries.
+  */
+#define BTREE_NODE_SIZE (512)
+#define BTREE_MIN_CAPACITY (4)
+
+/** compare function of the keys of a btree_t; same
+  * protocol as rbtree_compare_function.
+  */
+typedef int (*btree_compare_function)(void* a, void* b, void* arg);
+
+/** Called by `btree_range` for each pair in key order.
+  * Returning a non zero value stops the iteration.
+  */
+typedef int (*btree_range_function)(void* key, void* elem, void* arg);
+
+/** node of a btree_t; the `n` keys follow the header and are
+  * followed by the elements, in a leaf, or by the `n + 1`
+  * children, in an internal node. The leaves are linked in
+  * key order.
+  */
+typedef struct bnode_t {
+	size_t n;
+	int leaf;
+	struct bnode_t* next;
+	struct bnode_t* prev;
+} bnode_t;
+
+/** B+tree with fixed size keys and elements stored inline
+  * in the nodes.
+  */
+typedef struct btree_t {
+	size_t size;
+	size_t key_size;
+	size_t member_size;
+
+	/* capacity in keys and offsets of the arrays of the nodes */
+	size_t leaf_capacity;
+	size_t inner_capacity;
+	size_t keys_offset;
+	size_t elems_offset;
+	size_t children_offset;
+
+	btree_compare_function compare;
+	void* compare_argument;
+
+	/* two keys used to pass separators up in splits */
+	void* scratch;
+	struct bnode_t* root;
+} btree_t;
+
+gerror_t btree_create(struct btree_t* bt, size_t key_size, size_t member_size);
+gerror_t btree_destroy(struct btree_t* bt);
+
+gerror_t btree_set_compare_function(
+		struct btree_t* bt,
+		btree_compare_function function,
+		void* argument);
+
+gerror_t btree_insert(struct btree_t* bt, void* key, void* elem);
+gerror_t btree_emplace(struct btree_t* bt, void* key, void** elem, int* inserted);
+gerror_t btree_build_sorted(struct btree_t* bt, void* keys, void* elems, size_t n);
+gerror_t btree_remove(struct btree_t* bt, void* key, void* elem);
+gerror_t btree_find(struct btree_t* bt, void* key, void* elem);
+gerror_t btree_find_ptr(struct btree_t* bt, void* key, void** elem);
+gerror_t btree_get_pair(struct btree_t* bt, void* key, void* rkey, void* relem);
+gerror_t btree_range(
+		struct btree_t* bt,
+		void* lo,
+		void* hi,
+		btree_range_function function,
+		void* arg);
+
+#endif
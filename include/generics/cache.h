@@ -0,0 +1,117 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ */
+#ifndef __CACHE_H__
+#define __CACHE_H__
+
+#include <stdlib.h>
+#include <string.h>
+#include "gerror.h"
+#include "hashmap.h"
+
+/** Eviction policy of a cache_t.
+  */
+typedef enum {
+	/** least recently used: a hit moves the entry to the
+	  * front of the recency list and the back is evicted
+	  */
+	G_CACHE_LRU,
+
+	/** CLOCK (second chance): a hit only sets the referenced
+	  * bit of the entry; the hand sweeps the slots, clearing the
+	  * bits, and evicts the first entry not referenced
+	  */
+	G_CACHE_CLOCK
+} cache_policy_t;
+
+/** Called with the key and the element of each evicted entry,
+  * before its slot is reused, and with the argument given to
+  * cache_set_evict_function.
+  */
+typedef void (*cache_evict_function)(void* key, void* elem, void* arg);
+
+/** header of a slot of a cache_t; the key and the element follow
+  * it. `prev` and `next` link the recency list with G_CACHE_LRU
+  * and the free slots with both policies.
+  */
+typedef struct centry_t {
+	size_t prev;
+	size_t next;
+	int referenced;
+} centry_t;
+
+/** Bounded cache of `capacity` entries with O(1) get and put. The
+  * entries are stored in slots allocated with the cache and indexed
+  * by a hashmap_t of keys to slot numbers; once the cache is full,
+  * a put evicts an entry and reuses its slot, without allocating.
+  */
+typedef struct cache_t {
+	size_t size;
+	size_t capacity;
+	size_t key_size;
+	size_t member_size;
+	size_t slot_size;
+	cache_policy_t policy;
+
+	/* counters of cache_get, cache_get_ptr and evictions */
+	size_t hits;
+	size_t misses;
+	size_t evictions;
+
+	cache_evict_function evict;
+	void* evict_argument;
+
+	char* slots;
+	hashmap_t index;
+
+	/* recency list, most recent first, and free slots */
+	size_t head;
+	size_t tail;
+	size_t free;
+
+	/* slot of the CLOCK hand */
+	size_t hand;
+} cache_t;
+
+gerror_t cache_create(
+		struct cache_t* c,
+		size_t key_size,
+		size_t member_size,
+		size_t capacity,
+		cache_policy_t policy);
+gerror_t cache_destroy(struct cache_t* c);
+
+gerror_t cache_set_evict_function(
+		struct cache_t* c,
+		cache_evict_function function,
+		void* argument);
+gerror_t cache_set_hash_function(
+		struct cache_t* c,
+		hashmap_hash_function function,
+		void* argument);
+gerror_t cache_set_compare_function(
+		struct cache_t* c,
+		hashmap_compare_function function,
+		void* argument);
+
+gerror_t cache_put(struct cache_t* c, void* key, void* elem);
+gerror_t cache_get(struct cache_t* c, void* key, void* elem);
+gerror_t cache_get_ptr(struct cache_t* c, void* key, void** elem);
+gerror_t cache_remove(struct cache_t* c, void* key, void* elem);
+
+#endif
@@ -0,0 +1,117 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ */
+#ifndef __CONCURRENT_MAP_H__
+#define __CONCURRENT_MAP_H__
+
+#include <stdlib.h>
+#include <string.h>
+#include "epoch.h"
+#include "gerror.h"
+
+/** Maximum number of levels of the skip list of a cmap_t; each
+  * level has a quarter of the nodes of the level below, so it is
+  * enough for about 4^CMAP_MAX_LEVEL keys.
+  */
+#define CMAP_MAX_LEVEL (16)
+
+/** compare function of the keys of a cmap_t; same protocol of
+  * rbtree_compare_function. It is called by several threads
+  * at the same time.
+  */
+typedef int (*cmap_compare_function)(void* a, void* b, void* arg);
+
+/** function called by cmap_range for each pair in the range,
+  * in key order; `key` and `elem` must not be modified and are
+  * valid only during the call. Returning a non zero value stops
+  * the iteration.
+  */
+typedef int (*cmap_range_function)(void* key, void* elem, void* arg);
+
+/** node of the skip list of a cmap_t. The node has `level` next
+  * pointers and the key is stored right after them. The element
+  * is allocated apart so it can be replaced atomically. A node is
+  * `linked` once it is in every level and `marked` once it is
+  * being removed; `lock` is taken by the writers that change it.
+  */
+typedef struct cmnode_t {
+	void* value;
+	int lock;
+	int marked;
+	int linked;
+	int level;
+	struct cmnode_t* next[1];
+} cmnode_t;
+
+#define CMNODE_KEY(node) ((void*) &(node)->next[(node)->level])
+
+/** state of a thread registered in a cmap_t, in its own cache line.
+  */
+typedef struct cmap_thread_t {
+	unsigned long random;
+	char padding[64 - sizeof(unsigned long)];
+} cmap_thread_t;
+
+/** Concurrent ordered map: a lazy skip list. The reads never take
+  * locks; the writers lock only the nodes around the changed key,
+  * so writers of different keys run in parallel. The removed nodes
+  * and the replaced elements are freed by epoch based reclamation.
+  */
+typedef struct cmap_t {
+	size_t size;
+	size_t key_size;
+	size_t member_size;
+
+	cmap_compare_function compare;
+	void* compare_argument;
+
+	struct cmnode_t* head;
+	int level;
+	struct epoch_t epoch;
+	struct cmap_thread_t* threads;
+} cmap_t;
+
+gerror_t cmap_create(
+		struct cmap_t* m,
+		size_t key_size,
+		size_t member_size,
+		size_t max_threads);
+gerror_t cmap_destroy(struct cmap_t* m);
+
+gerror_t cmap_set_compare_function(
+		struct cmap_t* m,
+		cmap_compare_function function,
+		void* argument);
+
+gerror_t cmap_register(struct cmap_t* m, size_t* thread);
+gerror_t cmap_unregister(struct cmap_t* m, size_t thread);
+
+gerror_t cmap_insert(struct cmap_t* m, size_t thread, void* key, void* elem);
+gerror_t cmap_remove(struct cmap_t* m, size_t thread, void* key, void* elem);
+gerror_t cmap_at(struct cmap_t* m, size_t thread, void* key, void* elem);
+gerror_t cmap_range(
+		struct cmap_t* m,
+		size_t thread,
+		void* lo,
+		void* hi,
+		cmap_range_function function,
+		void* arg);
+
+int cmap_default_compare_function(void* a, void* b, void* arg);
+
+#endif
@@ -27,16 +27,81 @@
 #include "vector.h"
 #include "map.h"
 
+/** Size of the buffer of the dict_t keys stored inline: keys
+  * shorter than it are kept, with their '\0' terminator, in the
+  * pair of the map, and compared there without following a
+  * pointer; the longer ones are kept in the string arena.
+  * It can be changed when the library is built.
+  */
+#ifndef DICT_INLINE_KEY
+#define DICT_INLINE_KEY (16)
+#endif
+
+/** key of a dict_t: the string with its length and, in
+  * G_DICT_HASH mode, its hash, computed once per insert or lookup
+  * and compared before the bytes. The string is in `key.buf` if
+  * `len` is less than DICT_INLINE_KEY and pointed by `key.str`
+  * otherwise.
+  */
+typedef struct dict_key_t {
+	size_t len;
+	size_t hash;
+	union {
+		const char* str;
+		char buf[DICT_INLINE_KEY];
+	} key;
+} dict_key_t;
+
+/** Size of the chunks of the string arena of a dict_t; longer
+  * keys get a chunk of their own size.
+  */
+#define DICT_ARENA_CHUNK (16384)
+
+/** chunk of the string arena of a dict_t; the keys are stored
+  * one after the other, with their '\0' terminator, in the `size`
+  * bytes that follow the header, of which `used` are taken.
+  */
+typedef struct dict_chunk_t {
+	struct dict_chunk_t* next;
+	size_t size;
+	size_t used;
+} dict_chunk_t;
+
 typedef struct dict_t {
 	size_t member_size;
+	int flags;
 	map_t map;
 
+	/* string arena, the newest chunk first */
+	dict_chunk_t* chunks;
+
+	/* strings of the arena, with G_DICT_INTERN */
+	hashmap_t interned;
+
 	int (*strcomprfunction)(const char*, const char*);
 } dict_t;
 
+/** function called by dict_range and dict_foreach_prefix for each
+  * key, in order; `key` is the stored string and `elem` points to
+  * the element stored in the dict, aligned as in dict_find_ptr.
+  * Returning a non zero value stops the iteration.
+  */
+typedef int (*dict_range_function)(const char* key, void* elem, void* arg);
+
 typedef enum dict_flags_t {
 	G_DICT_CASE_SENSITIVE = 0,
-	G_DICT_CASE_INSENSITIVE = 1
+	G_DICT_CASE_INSENSITIVE = 1,
+
+	/** keys in a hash table instead of a red-black tree; lookups
+	  * take O(1) expected string comparisons but the keys are
+	  * not ordered
+	  */
+	G_DICT_HASH = 2,
+
+	/** each distinct string is stored once in the arena, so a
+	  * key removed and inserted again takes no more memory
+	  */
+	G_DICT_INTERN = 4
 } dict_flags_t;
 
 gerror_t dict_create(struct dict_t* d, size_t member_size, int flags);
@@ -44,5 +109,17 @@ gerror_t dict_destroy(struct dict_t* d);
 gerror_t dict_insert(struct dict_t* d, const char* key, void* elem);
 gerror_t dict_remove(struct dict_t* d, const char* key, void* elem);
 gerror_t dict_at(struct dict_t* d, const char* key, void* elem);
+gerror_t dict_find_ptr(struct dict_t* d, const char* key, void** elem);
+gerror_t dict_range(
+		struct dict_t* d,
+		const char* lo,
+		const char* hi,
+		dict_range_function function,
+		void* arg);
+gerror_t dict_foreach_prefix(
+		struct dict_t* d,
+		const char* prefix,
+		dict_range_function function,
+		void* arg);
 
 #endif
@@ -0,0 +1,71 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ */
+#ifndef __EPOCH_H__
+#define __EPOCH_H__
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "gerror.h"
+
+/** Number of retired pointers that triggers a reclamation.
+  */
+#define EPOCH_RETIRE_THRESHOLD (64)
+
+/** Announcement of a thread; `epoch` is 0 while the thread is
+  * outside of a critical section. Padded to its own cache line.
+  */
+typedef struct epoch_slot_t {
+	unsigned long epoch;
+	int used;
+	char padding[64 - sizeof(unsigned long) - sizeof(int)];
+} epoch_slot_t;
+
+/** Pointer waiting for the readers that could still see it.
+  */
+typedef struct epoch_retired_t {
+	struct epoch_retired_t* next;
+	void* ptr;
+	unsigned long epoch;
+} epoch_retired_t;
+
+/** Epoch based memory reclamation.
+  * Readers run inside `epoch_enter`/`epoch_leave` without locks and the
+  * memory unlinked by the writers is freed by `epoch_retire` only after
+  * every reader that could have seen it has left.
+  */
+typedef struct epoch_t {
+	unsigned long global;
+	size_t nslots;
+	struct epoch_slot_t* slots;
+
+	pthread_mutex_t lock;
+	struct epoch_retired_t* retired;
+	size_t nretired;
+} epoch_t;
+
+gerror_t epoch_create(struct epoch_t* e, size_t nslots);
+gerror_t epoch_destroy(struct epoch_t* e);
+gerror_t epoch_register(struct epoch_t* e, size_t* slot);
+gerror_t epoch_unregister(struct epoch_t* e, size_t slot);
+void epoch_enter(struct epoch_t* e, size_t slot);
+void epoch_leave(struct epoch_t* e, size_t slot);
+gerror_t epoch_retire(struct epoch_t* e, void* ptr);
+gerror_t epoch_reclaim(struct epoch_t* e);
+
+#endif
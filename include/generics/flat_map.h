@@ -0,0 +1,89 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ */
+#ifndef __FLAT_MAP_H__
+#define __FLAT_MAP_H__
+
+#include <stdlib.h>
+#include <string.h>
+#include "gerror.h"
+#include "vector.h"
+
+/** Distance, in levels, of the keys prefetched by the search of
+  * a frozen flat_map_t: the 16 descendants of a key four levels
+  * below it are contiguous in the Eytzinger layout.
+  */
+#define FLAT_MAP_PREFETCH (16)
+
+/** compare function of the keys of a flat_map_t; same
+  * protocol as rbtree_compare_function.
+  */
+typedef int (*flat_map_compare_function)(void* a, void* b, void* arg);
+
+/** Called by `flat_map_foreach` for each pair in key order.
+  * Returning a non zero value stops the iteration.
+  */
+typedef int (*flat_map_foreach_function)(void* key, void* elem, void* arg);
+
+/** Map stored in two arrays, one of keys and one of elements,
+  * sorted by key: the binary search only touches the keys. The
+  * pairs added by flat_map_push are kept after the sorted ones
+  * until flat_map_sort. A frozen map has its arrays in Eytzinger
+  * order (the breadth first order of the search tree) and can't
+  * be changed until flat_map_thaw.
+  */
+typedef struct flat_map_t {
+	size_t key_size;
+	size_t member_size;
+
+	/* the pairs [0, sorted) are sorted and have unique keys */
+	size_t sorted;
+	int frozen;
+
+	flat_map_compare_function compare;
+	void* compare_argument;
+
+	vector_t keys;
+	vector_t elems;
+} flat_map_t;
+
+gerror_t flat_map_create(struct flat_map_t* fm, size_t key_size, size_t member_size);
+gerror_t flat_map_destroy(struct flat_map_t* fm);
+
+gerror_t flat_map_set_compare_function(
+		struct flat_map_t* fm,
+		flat_map_compare_function function,
+		void* argument);
+
+gerror_t flat_map_insert(struct flat_map_t* fm, void* key, void* elem);
+gerror_t flat_map_push(struct flat_map_t* fm, void* key, void* elem);
+gerror_t flat_map_sort(struct flat_map_t* fm);
+gerror_t flat_map_remove(struct flat_map_t* fm, void* key, void* elem);
+gerror_t flat_map_at(struct flat_map_t* fm, void* key, void* elem);
+gerror_t flat_map_find_ptr(struct flat_map_t* fm, void* key, void** elem);
+gerror_t flat_map_foreach(
+		struct flat_map_t* fm,
+		flat_map_foreach_function function,
+		void* arg);
+
+gerror_t flat_map_freeze(struct flat_map_t* fm);
+gerror_t flat_map_thaw(struct flat_map_t* fm);
+
+int flat_map_default_compare_function(void* a, void* b, void* arg);
+
+#endif
@@ -0,0 +1,39 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ */
+#ifndef __GALIGN_H__
+#define __GALIGN_H__
+
+/** alignment of the data stored after other data in a block
+  * of memory, as the elements after the keys of a pair or the
+  * nodes after their elements: that of long, double and void*.
+  * Types with a larger alignment, as long double on some
+  * platforms, are not aligned by G_ALIGN.
+  */
+typedef union galign_t {
+	long l;
+	double d;
+	void* p;
+} galign_t;
+
+/** `size` rounded up to a multiple of the alignment of galign_t.
+  */
+#define G_ALIGN(size) \
+	(((size) + sizeof(galign_t) - 1) / sizeof(galign_t) * sizeof(galign_t))
+
+#endif
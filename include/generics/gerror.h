@@ -38,6 +38,11 @@ typedef enum gerror_t{
 	GERROR_ELEMENT_NOT_FOUNDED,
 	GERROR_NULL_KEY,
 	GERROR_COMPARE_FUNCTION_WRONG_RETURN,
+	GERROR_FILE_IO,
+	GERROR_INVALID_FILE_FORMAT,
+	GERROR_FULL_STRUCTURE,
+	GERROR_UNSORTED_ELEMENTS,
+	GERROR_UNSUPPORTED_OPERATION,
 	GERROR_N_ERROR
 } gerror_t;
 
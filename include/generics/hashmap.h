@@ -0,0 +1,112 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ */
+#ifndef __HASHMAP_H__
+#define __HASHMAP_H__
+
+#include <stdlib.h>
+#include <string.h>
+#include "gerror.h"
+
+/** Number of control bytes probed at once; with SSE2 they are
+  * compared in a single instruction.
+  */
+#define HASHMAP_GROUP_SIZE (16)
+
+/** Number of slots of the old table moved to the new one by
+  * each insert or remove while the map is growing, so no
+  * operation pays for the whole rehash.
+  */
+#define HASHMAP_MIGRATE_STEP (8)
+
+/** hash function of the keys of a hashmap_t; `size` is the
+  * key size and `arg` the argument given with the function.
+  */
+typedef size_t (*hashmap_hash_function)(void* key, size_t size, void* arg);
+
+/** compare function of the keys of a hashmap_t; only equality
+  * (a return of 0) is used. Same protocol as rbtree_compare_function.
+  */
+typedef int (*hashmap_compare_function)(void* a, void* b, void* arg);
+
+/** Called by `hashmap_foreach` for each pair, in no particular order.
+  * Returning a non zero value stops the iteration.
+  */
+typedef int (*hashmap_foreach_function)(void* key, void* elem, void* arg);
+
+/** table of a hashmap_t: `capacity` slots with the pairs stored
+  * inline, the key padded to G_ALIGN so the element is aligned,
+  * and one control byte per slot, which holds 7 bits of
+  * the hash of the key in the slot or marks the slot as empty.
+  * The first HASHMAP_GROUP_SIZE control bytes are repeated after
+  * the last one, so a group can be loaded at any slot.
+  */
+typedef struct htable_t {
+	size_t capacity;
+	size_t count;
+	unsigned char* ctrl;
+	char* slots;
+} htable_t;
+
+/** open addressing hash map with linear probing and removal by
+  * backward shift, which leaves no tombstones. While it grows,
+  * the pairs are moved from `old` to `table` a few slots per
+  * operation, starting at the slot `migrate`.
+  */
+typedef struct hashmap_t {
+	size_t size;
+	size_t key_size;
+	size_t member_size;
+	size_t slot_size;
+
+	/* offset of the element in a slot, aligned as galign_t */
+	size_t elem_offset;
+
+	hashmap_hash_function hash;
+	void* hash_argument;
+	hashmap_compare_function compare;
+	void* compare_argument;
+
+	struct htable_t table;
+	struct htable_t old;
+	size_t migrate;
+} hashmap_t;
+
+gerror_t hashmap_create(struct hashmap_t* hm, size_t key_size, size_t member_size);
+gerror_t hashmap_destroy(struct hashmap_t* hm);
+
+gerror_t hashmap_set_hash_function(
+		struct hashmap_t* hm,
+		hashmap_hash_function function,
+		void* argument);
+gerror_t hashmap_set_compare_function(
+		struct hashmap_t* hm,
+		hashmap_compare_function function,
+		void* argument);
+
+gerror_t hashmap_insert(struct hashmap_t* hm, void* key, void* elem);
+gerror_t hashmap_emplace(struct hashmap_t* hm, void* key, void** elem, int* inserted);
+gerror_t hashmap_remove(struct hashmap_t* hm, void* key, void* elem);
+gerror_t hashmap_find(struct hashmap_t* hm, void* key, void* elem);
+gerror_t hashmap_find_ptr(struct hashmap_t* hm, void* key, void** elem);
+gerror_t hashmap_get_pair(struct hashmap_t* hm, void* key, void* rkey, void* relem);
+gerror_t hashmap_foreach(struct hashmap_t* hm, hashmap_foreach_function function, void* arg);
+
+size_t hashmap_default_hash_function(void* key, size_t size, void* arg);
+
+#endif
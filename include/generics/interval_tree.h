@@ -0,0 +1,62 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ */
+#ifndef __INTERVAL_TREE_H__
+#define __INTERVAL_TREE_H__
+
+#include "red_black_tree.h"
+#include "gerror.h"
+
+/** Called by `interval_tree_overlaps` for each interval overlapping
+  * the query, in order of `lo`; `elem` points to the element stored
+  * with the interval. Returning a non zero value stops the query.
+  */
+typedef int (*interval_tree_function)(long lo, long hi, void* elem, void* arg);
+
+/** interval stored in the nodes of an interval_tree_t; `max` is
+  * the greatest `hi` of the subtree, kept by the augment function.
+  * The element follows the interval.
+  */
+typedef struct interval_t {
+	long lo;
+	long hi;
+	long max;
+} interval_t;
+
+/** interval tree: a rbtree_t ordered by the start of half open
+  * intervals [lo, hi) and augmented by the greatest end of each
+  * subtree. Equal intervals are kept.
+  */
+typedef struct interval_tree_t {
+	size_t member_size;
+
+	redblacktree_t tree;
+} interval_tree_t;
+
+gerror_t interval_tree_create(struct interval_tree_t* it, size_t member_size);
+gerror_t interval_tree_destroy(struct interval_tree_t* it);
+gerror_t interval_tree_add(struct interval_tree_t* it, long lo, long hi, void* elem);
+gerror_t interval_tree_remove(struct interval_tree_t* it, long lo, long hi, void* elem);
+gerror_t interval_tree_overlaps(
+		struct interval_tree_t* it,
+		long lo,
+		long hi,
+		interval_tree_function function,
+		void* arg);
+
+#endif
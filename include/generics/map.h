@@ -21,29 +21,92 @@
 #define __MAP_H__
 
 #include "red_black_tree.h"
+#include "btree.h"
+#include "hashmap.h"
+#include "persistent_rbtree.h"
 #include "gerror.h"
 
+/** Data structure used by a map_t.
+  */
+typedef enum {
+	/** red-black tree of pairs, the default */
+	G_MAP_RBTREE,
+
+	/** B+tree with the pairs stored inline in the nodes;
+	  * faster and smaller for many small keys
+	  */
+	G_MAP_BTREE,
+
+	/** open addressing hash table; O(1) expected operations
+	  * but no order: map_range is not supported
+	  */
+	G_MAP_HASH,
+
+	/** persistent red-black tree; map_snapshot takes O(1)
+	  * and the changes after it copy only the nodes they touch
+	  */
+	G_MAP_PERSISTENT
+} map_backend_t;
+
+/** function called by map_range for each pair in the range,
+  * in key order; `key` and `elem` point to the pair stored in
+  * the map and `arg` is the argument given to map_range.
+  * Returning a non zero value stops the iteration.
+  */
+typedef int (*map_range_function)(void* key, void* elem, void* arg);
+
 typedef struct map_t {
 	size_t key_size;
 	size_t member_size;
+	map_backend_t backend;
 
-	redblacktree_t map;
+	/** structure of the pairs; only the member
+	  * selected by `backend` is used
+	  */
+	union {
+		redblacktree_t map;
+		btree_t btree;
+		hashmap_t hash;
+		prbtree_t persistent;
+	} data;
 } map_t;
 
 gerror_t map_create(struct map_t* m, size_t key_size, size_t member_size);
+gerror_t map_create_backend(
+		struct map_t* m,
+		size_t key_size,
+		size_t member_size,
+		map_backend_t backend);
 gerror_t map_destroy(struct map_t* m);
 gerror_t map_insert(struct map_t* m, void* key, void* elem);
+gerror_t map_emplace(struct map_t* m, void* key, void** elem, int* inserted);
+gerror_t map_build_sorted(struct map_t* m, void* keys, void* elems, size_t n);
 gerror_t map_remove(struct map_t* m, void* key, void* elem);
 gerror_t map_at(struct map_t* m, void* key, void* elem);
+gerror_t map_find_ptr(struct map_t* m, void* key, void** elem);
 gerror_t map_get_pair(
 		struct map_t* m,
 		void* key,
 		void* rkey,
 		void* relem);
 
+gerror_t map_range(
+		struct map_t* m,
+		void* lo,
+		void* hi,
+		map_range_function function,
+		void* arg);
+
+gerror_t map_foreach(struct map_t* m, map_range_function function, void* arg);
+gerror_t map_snapshot(struct map_t* m, struct map_t* snapshot);
+
 gerror_t map_set_compare_function(
 		struct map_t* m,
 		rbtree_compare_function compare_function,
 		void* arg);
+gerror_t map_set_hash_function(
+		struct map_t* m,
+		hashmap_hash_function hash_function,
+		void* arg);
 
 #endif
@@ -0,0 +1,57 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ */
+#ifndef __MULTIMAP_H__
+#define __MULTIMAP_H__
+
+#include "gerror.h"
+#include "vector.h"
+#include "map.h"
+
+/** Map of keys to any number of elements. The elements of a key
+  * are stored contiguously in a vector_t, in insertion order, which
+  * is the element of the key in a map_t: a key is looked up once
+  * and its elements are read without following a node per element.
+  */
+typedef struct multimap_t {
+	size_t size;
+	size_t key_size;
+	size_t member_size;
+
+	map_t map;
+} multimap_t;
+
+gerror_t multimap_create(struct multimap_t* mm, size_t key_size, size_t member_size);
+gerror_t multimap_destroy(struct multimap_t* mm);
+
+gerror_t multimap_set_compare_function(
+		struct multimap_t* mm,
+		rbtree_compare_function compare_function,
+		void* arg);
+
+gerror_t multimap_insert(struct multimap_t* mm, void* key, void* elem);
+gerror_t multimap_remove(struct multimap_t* mm, void* key);
+gerror_t multimap_count(struct multimap_t* mm, void* key, size_t* count);
+gerror_t multimap_values(struct multimap_t* mm, void* key, void** elems, size_t* count);
+gerror_t multimap_equal_range(
+		struct multimap_t* mm,
+		void* key,
+		map_range_function function,
+		void* arg);
+
+#endif
@@ -0,0 +1,86 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ */
+#ifndef __PERSISTENT_RBTREE_H__
+#define __PERSISTENT_RBTREE_H__
+
+#include <stdlib.h>
+#include <string.h>
+#include "red_black_tree.h"
+#include "gerror.h"
+
+/** function called by prbtree_range for each element in the
+  * range, in order; the element must not be modified.
+  * Returning a non zero value stops the iteration.
+  */
+typedef int (*prbtree_range_function)(void* elem, void* arg);
+
+/** node of a prbtree_t. A node may be shared by several versions
+  * of the tree and `refs` is the number of parents and roots that
+  * point to it; only the nodes with a single reference are changed
+  * in place. The element is stored after the node, at
+  * PRBNODE_DATA(node).
+  */
+typedef struct prbnode_t {
+	size_t refs;
+	struct prbnode_t* left;
+	struct prbnode_t* right;
+	unsigned char color;
+} prbnode_t;
+
+#define PRBNODE_DATA(node) ((void*)((char*)(node) + RBNODE_OFFSET(sizeof(prbnode_t))))
+
+/** persistent left leaning red-black tree. A snapshot shares all
+  * nodes with the tree it was taken from, and a later change of
+  * either copies the O(log n) nodes of the path it touches, so the
+  * memory of the snapshots is proportional to the changes. Equal
+  * elements are not kept: an add replaces the equal element.
+  */
+typedef struct prbtree_t {
+	size_t size;
+	size_t member_size;
+
+	rbtree_compare_function compare;
+	void* compare_argument;
+	struct prbnode_t* root;
+} prbtree_t;
+
+gerror_t prbtree_create(struct prbtree_t* t, size_t member_size);
+gerror_t prbtree_destroy(struct prbtree_t* t);
+
+gerror_t prbtree_set_compare_function(
+		struct prbtree_t* t,
+		rbtree_compare_function function,
+		void* argument);
+
+gerror_t prbtree_add(struct prbtree_t* t, void* elem);
+gerror_t prbtree_build_sorted(struct prbtree_t* t, void* buffer, size_t n);
+gerror_t prbtree_emplace(struct prbtree_t* t, void* elem, size_t size, void** found, int* inserted);
+gerror_t prbtree_remove(struct prbtree_t* t, void* elem);
+gerror_t prbtree_find(struct prbtree_t* t, void* elem, void** found);
+gerror_t prbtree_snapshot(struct prbtree_t* t, struct prbtree_t* snapshot);
+gerror_t prbtree_range(
+		struct prbtree_t* t,
+		void* lo,
+		void* hi,
+		prbtree_range_function function,
+		void* arg);
+
+int prbtree_default_compare_function(void* a, void* b, void* arg);
+
+#endif
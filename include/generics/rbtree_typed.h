@@ -0,0 +1,202 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ */
+#ifndef __RBTREE_TYPED_H__
+#define __RBTREE_TYPED_H__
+
+#include "red_black_tree.h"
+#include "map.h"
+
+/** Defines functions `name_*` for a rbtree_t of elements of type
+  * `key_type` ordered by `cmp_expr`, an expression of two `key_type`
+  * values `a` and `b` that is negative, zero or positive when `a`
+  * is smaller, equal or greater than `b`. The descents of
+  * `name_add`, `name_find` and `name_lower_bound` compare with
+  * `cmp_expr` inlined, instead of calling the compare function of
+  * the tree on each level. The tree is a regular rbtree_t: it must
+  * be created by `name_create`, which also sets a compare function
+  * with `cmp_expr` for the other rbtree functions.
+  *
+  * Example:
+  *	GENERICS_DEFINE_RBTREE(itree, int, (a > b) - (a < b))
+  *
+  * defines itree_create, itree_add, itree_find, itree_lower_bound
+  * and itree_remove.
+  */
+#define GENERICS_DEFINE_RBTREE(name, key_type, cmp_expr)			\
+										\
+static __inline__ int name##_cmp(const key_type* pa, const key_type* pb)	\
+{										\
+	const key_type a = *pa;							\
+	const key_type b = *pb;							\
+	return (cmp_expr);							\
+}										\
+										\
+static int name##_compare(void* a, void* b, void* arg)				\
+{										\
+	int c = name##_cmp((const key_type*) a, (const key_type*) b);		\
+	(void) arg;								\
+	return (c > 0) - (c < 0);						\
+}										\
+										\
+static __inline__ gerror_t name##_create(rbtree_t* rbt)				\
+{										\
+	gerror_t g = rbtree_create(rbt, sizeof(key_type));			\
+	if(g != GERROR_OK)							\
+		return g;							\
+	return rbtree_set_compare_function(rbt, name##_compare, NULL);		\
+}										\
+										\
+static __inline__ gerror_t name##_add(rbtree_t* rbt, key_type* key)		\
+{										\
+	rbnode_t* parent = NULL;						\
+	rbnode_t* node = rbt->root;						\
+	int right = 0;								\
+										\
+	while(node != NULL){							\
+		int c = name##_cmp(key, (const key_type*) node->data);		\
+		parent = node;							\
+		if(c == 0){							\
+			if(rbt->flags & G_RB_EQUAL_OVERRIDE){			\
+				memcpy(node->data, key, sizeof(key_type));	\
+				return rbtree_update_node(rbt, node);		\
+			}							\
+			c = rbt->flags & G_RB_LEFT_LEANING ? -1 : 1;		\
+		}								\
+		right = c > 0;							\
+		node = right ? node->right : node->left;			\
+	}									\
+										\
+	return rbtree_link_node(rbt, parent, right, key, NULL);			\
+}										\
+										\
+static __inline__ gerror_t name##_find(	rbtree_t* rbt,				\
+					key_type* key,				\
+					rbnode_t** found)			\
+{										\
+	rbnode_t* node = rbt->root;						\
+										\
+	while(node != NULL){							\
+		int c = name##_cmp(key, (const key_type*) node->data);		\
+		if(c == 0){							\
+			*found = node;						\
+			return GERROR_OK;					\
+		}								\
+		node = c < 0 ? node->left : node->right;			\
+	}									\
+										\
+	*found = NULL;								\
+	return GERROR_ELEMENT_NOT_FOUNDED;					\
+}										\
+										\
+static __inline__ gerror_t name##_lower_bound(	rbtree_t* rbt,			\
+						key_type* key,			\
+						rbnode_t** found)		\
+{										\
+	rbnode_t* node = rbt->root;						\
+										\
+	*found = NULL;								\
+	while(node != NULL){							\
+		if(name##_cmp((const key_type*) node->data, key) < 0){		\
+			node = node->right;					\
+		}else{								\
+			*found = node;						\
+			node = node->left;					\
+		}								\
+	}									\
+										\
+	return *found ? GERROR_OK : GERROR_ELEMENT_NOT_FOUNDED;			\
+}										\
+										\
+static __inline__ gerror_t name##_remove(rbtree_t* rbt, key_type* key)	\
+{										\
+	rbnode_t* node;								\
+	if(name##_find(rbt, key, &node) != GERROR_OK)				\
+		return GERROR_REMOVE_ELEMENT_NOT_FOUNDED;			\
+	return rbtree_remove_node(rbt, node);					\
+}
+
+/** element of a pair of a map_t with keys of type `key_type`,
+  * stored after the key rounded up as in the pairs of map.c.
+  */
+#define GENERICS_MAP_ELEM(key_type, pair) \
+	((char*) (pair) + RBNODE_OFFSET(sizeof(key_type)))
+
+/** Defines functions `name_*` for a map_t with keys of type
+  * `key_type`, elements of type `elem_type` and the order
+  * `cmp_expr`, as in GENERICS_DEFINE_RBTREE. The map must be
+  * created by `name_create`, which uses the G_MAP_RBTREE backend;
+  * `name_insert` and `name_at` descend with `cmp_expr` inlined
+  * and the other map functions work as usual.
+  *
+  * Example:
+  *	GENERICS_DEFINE_MAP(counts, long, long, (a > b) - (a < b))
+  *
+  * defines counts_create, counts_insert and counts_at.
+  */
+#define GENERICS_DEFINE_MAP(name, key_type, elem_type, cmp_expr)		\
+										\
+GENERICS_DEFINE_RBTREE(name##_keys, key_type, cmp_expr)			\
+										\
+static __inline__ gerror_t name##_create(map_t* m)				\
+{										\
+	gerror_t g = map_create(m, sizeof(key_type), sizeof(elem_type));	\
+	if(g != GERROR_OK)							\
+		return g;							\
+	return map_set_compare_function(m, name##_keys_compare, NULL);		\
+}										\
+										\
+static __inline__ gerror_t name##_insert(	map_t* m,			\
+						key_type* key,			\
+						elem_type* elem)		\
+{										\
+	char pair[RBNODE_OFFSET(sizeof(key_type)) + sizeof(elem_type)];		\
+	rbnode_t* parent = NULL;						\
+	rbnode_t* node = m->data.map.root;					\
+	int right = 0;								\
+										\
+	while(node != NULL){							\
+		int c = name##_keys_cmp(key, (const key_type*) node->data);	\
+		if(c == 0){							\
+			memcpy(GENERICS_MAP_ELEM(key_type, node->data),		\
+				elem, sizeof(elem_type));			\
+			return GERROR_OK;					\
+		}								\
+		parent = node;							\
+		right = c > 0;							\
+		node = right ? node->right : node->left;			\
+	}									\
+										\
+	memcpy(pair, key, sizeof(key_type));					\
+	memcpy(GENERICS_MAP_ELEM(key_type, pair), elem, sizeof(elem_type));	\
+	return rbtree_link_node(&m->data.map, parent, right, pair, NULL);	\
+}										\
+										\
+static __inline__ gerror_t name##_at(	map_t* m,				\
+					key_type* key,				\
+					elem_type* elem)			\
+{										\
+	rbnode_t* node;								\
+	gerror_t g = name##_keys_find(&m->data.map, key, &node);		\
+	if(g == GERROR_OK)							\
+		memcpy(elem, GENERICS_MAP_ELEM(key_type, node->data),		\
+			sizeof(elem_type));					\
+	return g;								\
+}
+
+#endif
@@ -22,6 +22,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include "gerror.h"
+#include "galign.h"
 
 /**
   * return of the redblacktree compare function
@@ -45,34 +46,99 @@ typedef enum {
 	  * the value will be override and the tree will not leaning
 	  * if this flag is set
 	  */
-	G_RB_EQUAL_OVERRIDE	= 1<<1
+	G_RB_EQUAL_OVERRIDE	= 1<<1,
+
+	/** if this flag is set, each node keeps the number of
+	  * nodes of its subtree, which allows rbtree_select and
+	  * rbtree_rank in O(log n); add and remove pay O(log n)
+	  * extra to keep the counts
+	  */
+	G_RB_ORDER_STATISTIC	= 1<<2
 } rbflag_t;
 
 typedef int (*rbtree_compare_function)(void* a, void *b, void* arg);
 
+/** function that updates the augmented data kept in the element
+  * `elem` of a node from the elements of its children, `left` and
+  * `right`, which are NULL for empty subtrees. It is called by the
+  * tree whenever the subtree of a node changes.
+  */
+typedef void (*rbtree_augment_function)(void* elem, void* left, void* right, void* arg);
+
 typedef enum {
 	G_RB_RED,
 	G_RB_BLACK,
 	G_RB_DOUBLE_BLACK,
 } rbcolor_t;
 
+/** Flags of a rbtree_t node.
+  */
+typedef enum {
+	/** the node is part of a block allocated by
+	  * `rbtree_build_sorted` and it is freed with the block
+	  */
+	G_RBNODE_POOLED	= 1
+} rbnode_flag_t;
+
+/** node of a rbtree_t.
+  * The element and the node are allocated in a single block:
+  * the element comes first and `data` points to it, so the
+  * element and the fields read while descending the tree
+  * (`data`, `left` and `right`) are contiguous in memory.
+  * The color is one of the rbcolor_t values and `count` is
+  * the number of nodes of the subtree, only kept with
+  * G_RB_ORDER_STATISTIC.
+  */
 typedef struct redblacknode_t {
+	void* data;
 	struct redblacknode_t* left;
 	struct redblacknode_t* right;
 	struct redblacknode_t* parent;
+	size_t count;
 
-	rbcolor_t color;
-	void* data;
+	unsigned char color;
+	unsigned char flags;
 } redblacknode_t;
 
+/** offset of the node from the beginning of its block,
+  * that is, the size of an element of `member_size` bytes
+  * rounded up to the alignment of the node.
+  */
+#define RBNODE_OFFSET(member_size) G_ALIGN(member_size)
+
+/** reference of a rbtree to a block of nodes. The block starts
+  * with its reference count, followed by the nodes; after a split
+  * the nodes of a block may belong to several trees and the block
+  * is freed with its last reference.
+  */
+typedef struct rbblock_t {
+	struct rbblock_t* next;
+	size_t* memory;
+} rbblock_t;
+
+/** set operations of rbtree_set_operation.
+  */
+typedef enum {
+	/** elements of any of the trees; for equal elements
+	  * the one of the second tree is kept */
+	G_RB_UNION,
+	/** elements of the first tree that are in the second */
+	G_RB_INTERSECTION,
+	/** elements of the first tree that are not in the second */
+	G_RB_DIFFERENCE
+} rbset_op_t;
+
 typedef struct redblacktree_t {
 	size_t size;
 	size_t member_size;
 
 	rbtree_compare_function compare;
 	void* compare_argument;
+	rbtree_augment_function augment;
+	void* augment_argument;
 	long flags;
 	struct redblacknode_t* root;
+	struct rbblock_t* blocks;
 } redblacktree_t;
 
 typedef struct redblacktree_t rbtree_t;
@@ -84,7 +150,14 @@ gerror_t rbtree_destroy(rbtree_t* rbt);
 gerror_t rbtree_set_compare_function(	rbtree_t* rbt,
 					rbtree_compare_function function,
 					void* argument);
+gerror_t rbtree_set_augment_function(	rbtree_t* rbt,
+					rbtree_augment_function function,
+					void* argument);
 gerror_t rbtree_add(rbtree_t* rbt, void* elem);
+gerror_t rbtree_build_sorted(rbtree_t* rbt, void* buffer, size_t n);
+gerror_t rbtree_link_node(rbtree_t* rbt, rbnode_t* parent, int right, void* elem, rbnode_t** node);
+gerror_t rbtree_update_node(rbtree_t* rbt, rbnode_t* node);
+gerror_t rbtree_emplace(rbtree_t* rbt, void* elem, size_t size, rbnode_t** node, int* inserted);
 gerror_t rbtree_remove_item(rbtree_t* rbt, void* elem);
 gerror_t rbtree_remove_node(rbtree_t* rbt, rbnode_t* node);
 
@@ -95,5 +168,23 @@ gerror_t rbtree_min_value(rbtree_t* rbt, void* elem);
 gerror_t rbtree_max_node(rbtree_t* rbt, rbnode_t** node);
 gerror_t rbtree_max_value(rbtree_t* rbt, void* elem);
 gerror_t rbtree_find_node(rbtree_t* rbt, void* elem, rbnode_t** node);
+gerror_t rbtree_find_ptr(rbtree_t* rbt, void* elem, void** found);
+
+gerror_t rbtree_first(rbtree_t* rbt, rbnode_t** node);
+gerror_t rbtree_last(rbtree_t* rbt, rbnode_t** node);
+gerror_t rbtree_next(rbtree_t* rbt, rbnode_t* node, rbnode_t** next);
+gerror_t rbtree_prev(rbtree_t* rbt, rbnode_t* node, rbnode_t** prev);
+gerror_t rbtree_lower_bound(rbtree_t* rbt, void* elem, rbnode_t** node);
+gerror_t rbtree_upper_bound(rbtree_t* rbt, void* elem, rbnode_t** node);
+
+gerror_t rbtree_select(rbtree_t* rbt, size_t k, rbnode_t** node);
+gerror_t rbtree_rank(rbtree_t* rbt, void* elem, size_t* rank);
+
+gerror_t rbtree_join(rbtree_t* a, rbtree_t* b);
+gerror_t rbtree_split(rbtree_t* rbt, void* key, rbtree_t* left, rbtree_t* right);
+gerror_t rbtree_union(rbtree_t* a, rbtree_t* b);
+gerror_t rbtree_intersection(rbtree_t* a, rbtree_t* b);
+gerror_t rbtree_difference(rbtree_t* a, rbtree_t* b);
+gerror_t rbtree_set_operation(rbtree_t* a, rbtree_t* b, rbset_op_t op, size_t nthreads);
 
 #endif
@@ -23,30 +23,130 @@
 #include <string.h>
 
 #include "gerror.h"
+#include "epoch.h"
 
 #define NBYTE (0x100)
 
+/** Flags of a tnode_t.
+  */
+typedef enum {
+	/** the node is part of a block allocated by `trie_bulk_load`
+	  * and it is freed with the block
+	  */
+	G_TNODE_POOLED_NODE	= 1,
+
+	/** the value is part of a block allocated by `trie_bulk_load`
+	  * and it is freed with the block
+	  */
+	G_TNODE_POOLED_VALUE	= 1<<1
+} tnode_flag_t;
+
 /** node of a trie_t element.
   */
 typedef struct tnode_t {
 	void* value;
 	struct tnode_t* children[NBYTE];
+	int flags;
 } tnode_t;
 
+/** block of memory owned by the trie.
+  */
+typedef struct tblock_t {
+	struct tblock_t* next;
+	void* memory;
+	size_t size;
+} tblock_t;
+
+/** Synchronization of a trie in concurrent mode.
+  */
+typedef struct trie_sync_t {
+	struct epoch_t epoch;
+	pthread_mutex_t writer;
+} trie_sync_t;
+
 /** Represents the trie structure.
   */
 typedef struct trie_t {
 	size_t size;
 	size_t member_size;
+	struct tblock_t* blocks;
+	struct trie_sync_t* sync;
 	struct tnode_t root;
 } trie_t;
 
+/** Number of buckets of the depth and chain histograms of
+  * trie_stats_t; the last bucket counts everything beyond it.
+  */
+#define TRIE_STATS_BUCKETS (64)
+
+/** Memory and shape of a trie, computed by `trie_stats`.
+  */
+typedef struct trie_stats_t {
+	/** number of nodes, including the root */
+	size_t node_count;
+	/** number of nodes with a value */
+	size_t value_count;
+	/** bytes of the values */
+	size_t value_bytes;
+	/** bytes allocated by the trie: nodes, values, blocks
+	  * and synchronization, without the trie_t itself */
+	size_t bytes_allocated;
+	/** depth of the deepest node */
+	size_t max_depth;
+	/** number of nodes by number of children */
+	size_t fanout_histogram[NBYTE + 1];
+	/** number of nodes by depth */
+	size_t depth_histogram[TRIE_STATS_BUCKETS];
+	/** number of maximal chains of nodes with a single child
+	  * and no value, by the length of the chain */
+	size_t chain_histogram[TRIE_STATS_BUCKETS];
+	size_t chain_count;
+	size_t longest_chain;
+} trie_stats_t;
+
+/** Read-only trie mapped from a file written by `trie_save`.
+  * The queries are answered directly from the mapped pages.
+  */
+typedef struct trie_mmap_t {
+	size_t size;
+	size_t member_size;
+
+	const unsigned char* base;
+	size_t length;
+	size_t root;
+} trie_mmap_t;
+
 gerror_t trie_create(struct trie_t* t, size_t member_size);
 gerror_t trie_destroy(struct trie_t* t);
 gerror_t trie_add_element(struct trie_t* t, void* string, size_t size, void* elem);
 gerror_t trie_remove_element(struct trie_t* t, void* string, size_t size);
 gerror_t trie_get_element(struct trie_t* t, void* string, size_t size, void* elem);
 gerror_t trie_set_element(struct trie_t* t, void* string, size_t size, void* elem);
+gerror_t trie_bulk_load(struct trie_t* t, void** keys, size_t* lens, void* values, size_t n);
+gerror_t trie_bulk_load_parallel(
+		struct trie_t* t,
+		void** keys,
+		size_t* lens,
+		void* values,
+		size_t n,
+		size_t nthreads);
 tnode_t* trie_get_node_or_allocate ( struct trie_t* t, void* string, size_t size);
 
+gerror_t trie_enable_concurrency(struct trie_t* t, size_t max_readers);
+gerror_t trie_register_reader(struct trie_t* t, size_t* reader);
+gerror_t trie_unregister_reader(struct trie_t* t, size_t reader);
+gerror_t trie_concurrent_get_element(
+		struct trie_t* t,
+		size_t reader,
+		void* string,
+		size_t size,
+		void* elem);
+
+gerror_t trie_stats(struct trie_t* t, struct trie_stats_t* stats);
+
+gerror_t trie_save(struct trie_t* t, const char* path);
+gerror_t trie_open_mmap(struct trie_mmap_t* tm, const char* path);
+gerror_t trie_close_mmap(struct trie_mmap_t* tm);
+gerror_t trie_mmap_get_element(struct trie_mmap_t* tm, void* string, size_t size, void* elem);
+
 #endif
@@ -0,0 +1,370 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ */
+#include "aho_corasick.h"
+#include "vector.h"
+
+#define AC_NONE ((uint32_t)-1)
+
+/*
+ * auxiliar function;
+ * returns the child of the state `s` by the byte `byte`
+ * or AC_NONE if there is no such child.
+ * the children of a state have consecutive ids and the
+ * labels are sorted, so a binary search is used
+ */
+static uint32_t ac_child(struct ac_t* ac, uint32_t s, unsigned char byte)
+{
+	uint32_t lo = ac->states[s].first_child;
+	uint32_t hi = lo + ac->states[s].nchildren;
+
+	while(lo < hi){
+		uint32_t mid = lo + (hi - lo)/2;
+		if(ac->labels[mid] < byte)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	if(lo < ac->states[s].first_child + ac->states[s].nchildren &&
+	   ac->labels[lo] == byte)
+		return lo;
+
+	return AC_NONE;
+}
+
+/*
+ * auxiliar function;
+ * the transition function of the automaton;
+ * the dense states have the complete row with the
+ * failure links already resolved and the root is always
+ * dense, so the loop always ends
+ */
+static uint32_t ac_next(struct ac_t* ac, uint32_t s, unsigned char byte)
+{
+	for(;;){
+		struct ac_state_t* state = &ac->states[s];
+
+		if(state->row != AC_NONE)
+			return ac->table[(size_t)state->row*NBYTE + byte];
+
+		uint32_t c = ac_child(ac, s, byte);
+		if(c != AC_NONE)
+			return c;
+
+		s = state->fail;
+	}
+}
+
+/*
+ * auxiliar function;
+ * returns the number of children of `node`
+ */
+static uint16_t ac_tnode_nchildren(struct tnode_t* node)
+{
+	uint16_t n = 0;
+	int i;
+
+	for(i=0; i<NBYTE; i++)
+		if(node->children[i])
+			n++;
+
+	return n;
+}
+
+/** Builds the Aho-Corasick automaton `ac` with the patterns stored in
+  * the trie `t`. The values mapped by the patterns are copied, so `t`
+  * can be modified or destroyed after the build. The empty pattern is
+  * ignored.
+  *
+  * The states with at least AC_DENSE_FANOUT children, the root and its
+  * children are stored as full transition rows; the others keep the
+  * sorted list of children and the failure link.
+  *
+  * @param ac	pointer to the structure to be populated;
+  * @param t	pointer to the trie with the patterns.
+  *
+  * @return	GERROR_OK in case of success operation;
+  * 		GERROR_NULL_STRUCURE in case `ac` or `t` is a NULL
+  */
+gerror_t ac_build (struct ac_t* ac, struct trie_t* t)
+{
+	if(!ac || !t) return GERROR_NULL_STRUCTURE;
+
+	vector_t nodes;
+	vector_t labels;
+	struct tnode_t* node = &t->root;
+	unsigned char label = 0;
+	size_t nvalues = 0;
+	size_t i;
+	int b;
+
+	/*
+	 * breadth first numbering of the nodes; the children of
+	 * a node receive consecutive ids in the order of the labels
+	 */
+	vector_create(&nodes, 0, sizeof(struct tnode_t*));
+	vector_create(&labels, 0, sizeof(unsigned char));
+	vector_add(&nodes, &node);
+	vector_add(&labels, &label);
+
+	for(i=0; i<nodes.size; i++){
+		node = *(struct tnode_t**)vector_ptr_at(&nodes, i);
+
+		if(i && node->value)
+			nvalues++;
+
+		for(b=0; b<NBYTE; b++){
+			if(node->children[b]){
+				label = (unsigned char)b;
+				vector_add(&nodes, &node->children[b]);
+				vector_add(&labels, &label);
+			}
+		}
+	}
+
+	ac->member_size = t->member_size;
+	ac->nstates = nodes.size;
+	ac->nrows = 0;
+	ac->state = 0;
+	ac->position = 0;
+	ac->states = (struct ac_state_t*) malloc(sizeof(struct ac_state_t)*ac->nstates);
+	ac->labels = (unsigned char*) malloc(ac->nstates);
+	ac->values = NULL;
+	memcpy(ac->labels, labels.data, ac->nstates);
+	vector_destroy(&labels);
+
+	if(nvalues && ac->member_size)
+		ac->values = malloc(nvalues*ac->member_size);
+
+	/*
+	 * children, depth and values of the states
+	 */
+	uint32_t next_id = 1;
+	uint32_t value_id = 0;
+
+	ac->states[0].depth = 0;
+	for(i=0; i<ac->nstates; i++){
+		struct ac_state_t* state = &ac->states[i];
+		node = *(struct tnode_t**)vector_ptr_at(&nodes, i);
+
+		state->first_child = next_id;
+		state->nchildren = ac_tnode_nchildren(node);
+		state->fail = 0;
+		state->output = AC_NONE;
+		state->row = AC_NONE;
+		state->value = AC_NONE;
+
+		if(i && node->value){
+			state->value = value_id;
+			if(ac->values)
+				memcpy((char*)ac->values + value_id*ac->member_size,
+					node->value,
+					ac->member_size);
+			value_id++;
+		}
+
+		uint32_t c;
+		for(c=next_id; c<next_id + state->nchildren; c++)
+			ac->states[c].depth = state->depth + 1;
+		next_id += state->nchildren;
+
+		if(i == 0 || state->depth == 1 || state->nchildren >= AC_DENSE_FANOUT)
+			state->row = ac->nrows++;
+	}
+
+	vector_destroy(&nodes);
+
+	/*
+	 * failure and output links; a failure link always
+	 * points to a state with a smaller id, so it is
+	 * already resolved when the children are visited
+	 */
+	for(i=0; i<ac->nstates; i++){
+		struct ac_state_t* state = &ac->states[i];
+		uint32_t c;
+
+		for(c=state->first_child; c<state->first_child + state->nchildren; c++){
+			uint32_t f = 0;
+
+			if(i){
+				f = state->fail;
+				for(;;){
+					uint32_t g = ac_child(ac, f, ac->labels[c]);
+					if(g != AC_NONE){
+						f = g;
+						break;
+					}
+					if(f == 0)
+						break;
+					f = ac->states[f].fail;
+				}
+			}
+
+			ac->states[c].fail = f;
+			if(f && ac->states[f].value != AC_NONE)
+				ac->states[c].output = f;
+			else
+				ac->states[c].output = ac->states[f].output;
+		}
+	}
+
+	/*
+	 * full rows of the dense states, also in the order
+	 * of the ids, so the rows reached through the failure
+	 * links are already filled
+	 */
+	ac->table = (uint32_t*) malloc(sizeof(uint32_t)*ac->nrows*NBYTE);
+
+	for(i=0; i<ac->nstates; i++){
+		struct ac_state_t* state = &ac->states[i];
+		if(state->row == AC_NONE)
+			continue;
+
+		uint32_t* row = &ac->table[(size_t)state->row*NBYTE];
+		for(b=0; b<NBYTE; b++){
+			uint32_t c = ac_child(ac, i, b);
+
+			if(c != AC_NONE)
+				row[b] = c;
+			else if(i == 0)
+				row[b] = 0;
+			else
+				row[b] = ac_next(ac, state->fail, b);
+		}
+	}
+
+	return GERROR_OK;
+}
+
+/** Deallocates the inner attributes of `ac`.
+  *
+  * @param ac	pointer to the structure.
+  *
+  * @return	GERROR_OK in case of success operation;
+  * 		GERROR_NULL_STRUCURE in case `ac` is a NULL
+  */
+gerror_t ac_destroy (struct ac_t* ac)
+{
+	if(!ac) return GERROR_NULL_STRUCTURE;
+
+	free(ac->states);
+	free(ac->labels);
+	free(ac->table);
+	if(ac->values)
+		free(ac->values);
+
+	ac->states = NULL;
+	ac->labels = NULL;
+	ac->table = NULL;
+	ac->values = NULL;
+	ac->nstates = 0;
+	ac->nrows = 0;
+	ac->state = 0;
+	ac->position = 0;
+
+	return GERROR_OK;
+}
+
+/** Resets the state of the scan, so the next `ac_scan` starts
+  * a new stream at the position 0.
+  *
+  * @param ac	pointer to the structure.
+  *
+  * @return	GERROR_OK in case of success operation;
+  * 		GERROR_NULL_STRUCURE in case `ac` is a NULL
+  */
+gerror_t ac_reset (struct ac_t* ac)
+{
+	if(!ac) return GERROR_NULL_STRUCTURE;
+
+	ac->state = 0;
+	ac->position = 0;
+
+	return GERROR_OK;
+}
+
+/** Scans `size` bytes of `buffer` and calls `callback` for every pattern
+  * that ends in these bytes. The state is kept between the calls, so the
+  * matches crossing the boundary of two buffers are found.
+  * If `callback` returns a value different of 0, the scan stops after the
+  * current byte and `ac->position` holds the number of bytes scanned.
+  *
+  * @param ac		pointer to the structure;
+  * @param buffer	pointer to the bytes to scan;
+  * @param size		number of bytes in `buffer`;
+  * @param callback	function called for every match;
+  * @param arg		argument passed to `callback`.
+  *
+  * @see ac_match_function
+  *
+  * @return	GERROR_OK in case of success operation;
+  * 		GERROR_NULL_STRUCURE in case `ac` is a NULL;
+  * 		GERROR_NULL_POINTER_TO_BUFFER in case `buffer` is NULL
+  */
+gerror_t ac_scan (
+		struct ac_t* ac,
+		const void* buffer,
+		size_t size,
+		ac_match_function callback,
+		void* arg)
+{
+	if(!ac || !ac->states) return GERROR_NULL_STRUCTURE;
+	if(!buffer && size) return GERROR_NULL_POINTER_TO_BUFFER;
+
+	const unsigned char* ptr = buffer;
+	uint32_t s = ac->state;
+	size_t i;
+
+	for(i=0; i<size; i++){
+		s = ac_next(ac, s, ptr[i]);
+
+		struct ac_state_t* state = &ac->states[s];
+		if(!callback || (state->value == AC_NONE && state->output == AC_NONE))
+			continue;
+
+		uint32_t o = state->value != AC_NONE ? s : state->output;
+		int stop = 0;
+
+		while(o != AC_NONE && !stop){
+			void* value = NULL;
+			if(ac->values)
+				value = (char*)ac->values +
+					ac->states[o].value*ac->member_size;
+
+			stop = callback(
+					ac->position + i + 1,
+					ac->states[o].depth,
+					value,
+					arg);
+
+			o = ac->states[o].output;
+		}
+
+		if(stop){
+			ac->state = s;
+			ac->position += i + 1;
+			return GERROR_OK;
+		}
+	}
+
+	ac->state = s;
+	ac->position += size;
+
+	return GERROR_OK;
+}
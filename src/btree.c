@@ -0,0 +1,985 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ */
+
+#include "btree.h"
+#include "galign.h"
+
+/*
+ * auxiliar function prototypes
+ */
+int btree_default_compare_function(void* a, void* b, void* arg);
+static void* bnode_key(btree_t* bt, bnode_t* node, size_t i);
+static void* bnode_elem(btree_t* bt, bnode_t* node, size_t i);
+static bnode_t** bnode_children(btree_t* bt, bnode_t* node);
+static bnode_t* bnode_create(btree_t* bt, int leaf);
+static void bnode_destroy(btree_t* bt, bnode_t* node);
+static size_t bnode_search(btree_t* bt, bnode_t* node, void* key, int upper, int* equal);
+static bnode_t* btree_find_leaf(btree_t* bt, void* key, size_t* i, int* equal);
+static void bnode_insert_pair(btree_t* bt, bnode_t* node, size_t i, void* key, void* elem);
+static void bnode_insert_child(btree_t* bt, bnode_t* node, size_t i, void* key, bnode_t* right);
+static void* btree_insert_pair(btree_t* bt, void* key, void* elem);
+static int btree_insert_node(
+		btree_t* bt,
+		bnode_t* node,
+		void* key,
+		void* elem,
+		bnode_t** right,
+		void** pair);
+static int btree_remove_node(btree_t* bt, bnode_t* node, void* key, void* elem);
+static void btree_fix_child(btree_t* bt, bnode_t* parent, size_t i);
+static void bnode_remove_inner(btree_t* bt, bnode_t* node, size_t i);
+static size_t btree_build_level(btree_t* bt, bnode_t** nodes, void** mins, size_t count);
+
+/** Creates a B+tree of keys with size `key_size` mapped to elements
+  * with size `member_size` and populates the previous allocated
+  * structure `bt`. The keys and the elements are stored in the
+  * nodes, which have about BTREE_NODE_SIZE bytes, and the leaves
+  * are linked for range scans.
+  * The default compare function only works for char, int and long
+  * keys; see btree_set_compare_function.
+  *
+  * @param bt		pointer to a previous allocated `btree_t` structure;
+  * @param key_size	size of the keys in bytes
+  * @param member_size	size of the elements in bytes
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `bt` is null
+  */
+gerror_t btree_create (struct btree_t* bt, size_t key_size, size_t member_size)
+{
+	if(!bt) return GERROR_NULL_STRUCTURE;
+
+	size_t header = G_ALIGN(sizeof(bnode_t));
+	size_t leaf_entry = key_size + member_size;
+	size_t inner_entry = key_size + sizeof(bnode_t*);
+
+	bt->size = 0;
+	bt->key_size = key_size;
+	bt->member_size = member_size;
+
+	bt->leaf_capacity = leaf_entry ? (BTREE_NODE_SIZE - header)/leaf_entry : BTREE_MIN_CAPACITY;
+	if(bt->leaf_capacity < BTREE_MIN_CAPACITY)
+		bt->leaf_capacity = BTREE_MIN_CAPACITY;
+
+	bt->inner_capacity = (BTREE_NODE_SIZE - header - sizeof(bnode_t*))/inner_entry;
+	if(bt->inner_capacity < BTREE_MIN_CAPACITY)
+		bt->inner_capacity = BTREE_MIN_CAPACITY;
+
+	bt->keys_offset = header;
+	bt->elems_offset = header + G_ALIGN(bt->leaf_capacity*key_size);
+	bt->children_offset = header + G_ALIGN(bt->inner_capacity*key_size);
+
+	bt->compare = btree_default_compare_function;
+	bt->compare_argument = &(bt->key_size);
+
+	bt->scratch = malloc(2*key_size + 1);
+	bt->root = NULL;
+
+	return GERROR_OK;
+}
+
+/** Destroys and deallocates the nodes of `bt`.
+  *
+  * @param bt	pointer to a previous allocated `btree_t` structure;
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `bt` is null
+  */
+gerror_t btree_destroy (struct btree_t* bt)
+{
+	if(!bt) return GERROR_NULL_STRUCTURE;
+
+	if(bt->root)
+		bnode_destroy(bt, bt->root);
+
+	free(bt->scratch);
+
+	bt->root = NULL;
+	bt->scratch = NULL;
+	bt->size = 0;
+	bt->compare = NULL;
+	bt->compare_argument = NULL;
+
+	return GERROR_OK;
+}
+
+/** Change the compare function of the keys of `bt` for `function`
+  * with the argument `argument`.
+  *
+  * @param bt		pointer to a previous allocated `btree_t` structure;
+  * @param function	comparison function of the keys
+  * @param argument	pointer to the argument to the comparison function
+  *
+  * @see rbtree_set_compare_function
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `bt` is null
+  */
+gerror_t btree_set_compare_function(
+		struct btree_t* bt,
+		btree_compare_function function,
+		void* argument)
+{
+	if(!bt) return GERROR_NULL_STRUCTURE;
+
+	bt->compare = function;
+	bt->compare_argument = argument;
+
+	return GERROR_OK;
+}
+
+/** Inserts the element `elem` at the key `key` in `bt`; if the
+  * key is already in `bt` its element is overwritten. O(log n).
+  *
+  * @param bt	pointer to a previous allocated `btree_t` structure;
+  * @param key	pointer to the key
+  * @param elem	pointer to the element to be copied or NULL
+  * 		to store a zeroed element
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `bt` is null
+  * 		GERROR_NULL_KEY in case that `key` is null
+  */
+gerror_t btree_insert (struct btree_t* bt, void* key, void* elem)
+{
+	if(!bt) return GERROR_NULL_STRUCTURE;
+	if(!key) return GERROR_NULL_KEY;
+
+	size_t size = bt->size;
+	void* pair = btree_insert_pair(bt, key, elem);
+
+	/*
+	 * the key was in `bt`: its element is overwritten
+	 */
+	if(elem && bt->size == size)
+		memcpy(pair, elem, bt->member_size);
+
+	return GERROR_OK;
+}
+
+/** Finds the element at the key `key` or, if `key` is not in `bt`,
+  * inserts it with a zeroed element, and writes in `elem` a pointer
+  * to the element in the leaf, which can be changed in place. The
+  * pointer is valid until the next insert or remove in `bt`.
+  * O(log n), with a single descent: the insert returns where
+  * the pair was placed, also after a split of its leaf.
+  *
+  * @param bt		pointer to a previous allocated `btree_t` structure;
+  * @param key		pointer to the key
+  * @param elem		pointer to write the pointer to the element
+  * @param inserted	pointer to write 1 if `key` was inserted and
+  * 			0 if it was found, or NULL
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `bt` is null
+  * 		GERROR_NULL_KEY in case that `key` is null
+  * 		GERROR_NULL_RETURN_POINTER in case `elem` is null
+  */
+gerror_t btree_emplace (struct btree_t* bt, void* key, void** elem, int* inserted)
+{
+	if(!bt) return GERROR_NULL_STRUCTURE;
+	if(!key) return GERROR_NULL_KEY;
+	if(!elem) return GERROR_NULL_RETURN_POINTER;
+
+	size_t size = bt->size;
+
+	*elem = btree_insert_pair(bt, key, NULL);
+
+	if(inserted)
+		*inserted = bt->size != size;
+
+	return GERROR_OK;
+}
+
+/** Builds `bt` from `n` keys sorted by the compare function and
+  * the elements mapped by them, in O(n): the leaves are filled left
+  * to right and linked, and then each level of internal nodes is
+  * built over the one below, without searches or splits. The pairs
+  * are spread evenly, so the nodes are nearly full and at least
+  * half full. If a key is repeated the last element is kept.
+  * If `bt` is not empty, the pairs are inserted one by one.
+  *
+  * @param bt		pointer to a previous allocated `btree_t` structure;
+  * @param keys		pointer to `n` sorted keys of `key_size` bytes
+  * @param elems	pointer to `n` elements of `member_size` bytes
+  * 			or NULL to store zeroed elements
+  * @param n		number of pairs
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `bt` is null
+  * 		GERROR_NULL_KEY in case that `keys` is null
+  * 		GERROR_UNSORTED_ELEMENTS in case `keys` is not sorted,
+  * 		`bt` is not changed
+  */
+gerror_t btree_build_sorted (struct btree_t* bt, void* keys, void* elems, size_t n)
+{
+	if(!bt) return GERROR_NULL_STRUCTURE;
+	if(!n) return GERROR_OK;
+	if(!keys) return GERROR_NULL_KEY;
+
+	char* k = (char*) keys;
+	char* e = (char*) elems;
+	size_t i, j, count = 1;
+
+	/*
+	 * check the order and count the distinct keys
+	 */
+	for(i = 1; i < n; i++){
+		int c = bt->compare(	k + (i - 1)*bt->key_size,
+					k + i*bt->key_size,
+					bt->compare_argument);
+		if(c > 0)
+			return GERROR_UNSORTED_ELEMENTS;
+		if(c < 0)
+			count++;
+	}
+
+	if(bt->root){
+		for(i = 0; i < n; i++)
+			btree_insert(bt, k + i*bt->key_size, e ? e + i*bt->member_size : NULL);
+		return GERROR_OK;
+	}
+
+	/*
+	 * the leaves get `count/leaves` pairs and the first
+	 * `count % leaves` one more
+	 */
+	size_t leaves = (count + bt->leaf_capacity - 1)/bt->leaf_capacity;
+	bnode_t** nodes = (bnode_t**) malloc(leaves*sizeof(bnode_t*));
+	void** mins = (void**) malloc(leaves*sizeof(void*));
+	bnode_t* prev = NULL;
+
+	for(i = 0, j = 0; j < leaves; j++){
+		bnode_t* leaf = bnode_create(bt, 1);
+		size_t fill = count/leaves + (j < count % leaves);
+
+		while(leaf->n < fill){
+			/*
+			 * only the last of equal keys
+			 */
+			if(i + 1 < n && bt->compare(	k + i*bt->key_size,
+							k + (i + 1)*bt->key_size,
+							bt->compare_argument) == 0){
+				i++;
+				continue;
+			}
+
+			memcpy(bnode_key(bt, leaf, leaf->n), k + i*bt->key_size, bt->key_size);
+			if(e)
+				memcpy(bnode_elem(bt, leaf, leaf->n), e + i*bt->member_size, bt->member_size);
+			else
+				memset(bnode_elem(bt, leaf, leaf->n), 0, bt->member_size);
+
+			leaf->n++;
+			i++;
+		}
+
+		leaf->prev = prev;
+		if(prev)
+			prev->next = leaf;
+		prev = leaf;
+
+		nodes[j] = leaf;
+		mins[j] = bnode_key(bt, leaf, 0);
+	}
+
+	while(leaves > 1)
+		leaves = btree_build_level(bt, nodes, mins, leaves);
+
+	bt->root = nodes[0];
+	bt->size = count;
+
+	free(nodes);
+	free(mins);
+
+	return GERROR_OK;
+}
+
+/** Removes the key `key` of `bt` and writes its element
+  * in `elem`. O(log n).
+  *
+  * @param bt	pointer to a previous allocated `btree_t` structure;
+  * @param key	pointer to the key
+  * @param elem	pointer to a location of memory where the element
+  * 		will be written or NULL
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `bt` is null
+  * 		GERROR_NULL_KEY in case that `key` is null
+  * 		GERROR_ELEMENT_NOT_FOUNDED in case `key` is not in `bt`
+  */
+gerror_t btree_remove (struct btree_t* bt, void* key, void* elem)
+{
+	if(!bt) return GERROR_NULL_STRUCTURE;
+	if(!key) return GERROR_NULL_KEY;
+
+	if(!bt->root || !btree_remove_node(bt, bt->root, key, elem))
+		return GERROR_ELEMENT_NOT_FOUNDED;
+
+	/*
+	 * the root loses a level when it has a single child
+	 */
+	if(!bt->root->leaf && bt->root->n == 0){
+		bnode_t* root = bt->root;
+		bt->root = bnode_children(bt, root)[0];
+		free(root);
+	}
+
+	return GERROR_OK;
+}
+
+/** Writes the element at the key `key` in `elem`. O(log n).
+  *
+  * @param bt	pointer to a previous allocated `btree_t` structure;
+  * @param key	pointer to the key
+  * @param elem	pointer to a location of memory where the element
+  * 		will be written or NULL to only check the key
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `bt` is null
+  * 		GERROR_NULL_KEY in case that `key` is null
+  * 		GERROR_ELEMENT_NOT_FOUNDED in case `key` is not in `bt`
+  */
+gerror_t btree_find (struct btree_t* bt, void* key, void* elem)
+{
+	return btree_get_pair(bt, key, NULL, elem);
+}
+
+/** Writes the key and the element at the key `key` in `rkey` and
+  * `relem`. O(log n).
+  *
+  * @param bt		pointer to a previous allocated `btree_t` structure;
+  * @param key		pointer to the key
+  * @param rkey		pointer to the memory location to write the key or NULL
+  * @param relem	pointer to the memory location to write the elem or NULL
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `bt` is null
+  * 		GERROR_NULL_KEY in case that `key` is null
+  * 		GERROR_ELEMENT_NOT_FOUNDED in case `key` is not in `bt`
+  */
+gerror_t btree_get_pair (struct btree_t* bt, void* key, void* rkey, void* relem)
+{
+	if(!bt) return GERROR_NULL_STRUCTURE;
+	if(!key) return GERROR_NULL_KEY;
+
+	size_t i;
+	int equal;
+	bnode_t* leaf = btree_find_leaf(bt, key, &i, &equal);
+
+	if(!leaf || !equal)
+		return GERROR_ELEMENT_NOT_FOUNDED;
+
+	if(rkey)
+		memcpy(rkey, bnode_key(bt, leaf, i), bt->key_size);
+
+	if(relem)
+		memcpy(relem, bnode_elem(bt, leaf, i), bt->member_size);
+
+	return GERROR_OK;
+}
+
+/** Writes in `elem` a pointer to the element at the key `key`,
+  * stored in a leaf of `bt`, without copying it. The element can
+  * be changed in place; the pointer is valid until the next insert
+  * or remove in `bt`, which may move the pairs of the leaf. O(log n).
+  *
+  * @param bt	pointer to a previous allocated `btree_t` structure;
+  * @param key	pointer to the key
+  * @param elem	pointer to write the pointer to the element
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `bt` is null
+  * 		GERROR_NULL_KEY in case that `key` is null
+  * 		GERROR_NULL_RETURN_POINTER in case `elem` is null
+  * 		GERROR_ELEMENT_NOT_FOUNDED in case `key` is not in `bt`;
+  * 		`*elem` is set to NULL
+  */
+gerror_t btree_find_ptr (struct btree_t* bt, void* key, void** elem)
+{
+	if(!bt) return GERROR_NULL_STRUCTURE;
+	if(!key) return GERROR_NULL_KEY;
+	if(!elem) return GERROR_NULL_RETURN_POINTER;
+
+	size_t i;
+	int equal;
+	bnode_t* leaf = btree_find_leaf(bt, key, &i, &equal);
+
+	if(!leaf || !equal){
+		*elem = NULL;
+		return GERROR_ELEMENT_NOT_FOUNDED;
+	}
+
+	*elem = bnode_elem(bt, leaf, i);
+
+	return GERROR_OK;
+}
+
+/** Calls `function` for each pair of `bt` with key in [`lo`, `hi`),
+  * in key order, following the linked leaves. O(log n + k).
+  * The tree must not be modified by `function`.
+  *
+  * @param bt		pointer to a previous allocated `btree_t` structure;
+  * @param lo		pointer to the smallest key of the range or NULL
+  * 			to start at the first key
+  * @param hi		pointer to the key ending the range (not included)
+  * 			or NULL to go until the last key
+  * @param function	function called for each pair; a non zero
+  * 			return stops the iteration
+  * @param arg		argument passed to `function`
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `bt` is null
+  * 		GERROR_NULL_ELEMENT_POINTER in case that `function` is null
+  */
+gerror_t btree_range (
+		struct btree_t* bt,
+		void* lo,
+		void* hi,
+		btree_range_function function,
+		void* arg)
+{
+	if(!bt) return GERROR_NULL_STRUCTURE;
+	if(!function) return GERROR_NULL_ELEMENT_POINTER;
+
+	bnode_t* leaf = bt->root;
+	size_t i = 0;
+	int equal;
+
+	if(!leaf)
+		return GERROR_OK;
+
+	if(lo){
+		leaf = btree_find_leaf(bt, lo, &i, &equal);
+	}else{
+		while(!leaf->leaf)
+			leaf = bnode_children(bt, leaf)[0];
+	}
+
+	while(leaf != NULL){
+		for(; i < leaf->n; i++){
+			void* key = bnode_key(bt, leaf, i);
+
+			if(hi && bt->compare(key, hi, bt->compare_argument) >= 0)
+				return GERROR_OK;
+
+			if(function(key, bnode_elem(bt, leaf, i), arg))
+				return GERROR_OK;
+		}
+
+		leaf = leaf->next;
+		i = 0;
+	}
+
+	return GERROR_OK;
+}
+
+/*
+ * the default comparison function. Just compare
+ * like to long
+ */
+int btree_default_compare_function(void* a, void* b, void* arg)
+{
+	size_t size = *(size_t*)arg;
+
+	long la = 0;
+	long lb = 0;
+
+	switch(size){
+	case sizeof(int):
+		la = *(int*)a;
+		lb = *(int*)b;
+		break;
+	case sizeof(char):
+		la = *(char*)a;
+		lb = *(char*)b;
+		break;
+	case sizeof(long):
+		la = *(long*)a;
+		lb = *(long*)b;
+		break;
+	}
+	return (la > lb) - (la < lb);
+}
+
+/*
+ * returns the pointer to the key `i` of `node`
+ */
+static void* bnode_key(btree_t* bt, bnode_t* node, size_t i)
+{
+	return (char*) node + bt->keys_offset + i*bt->key_size;
+}
+
+/*
+ * returns the pointer to the element `i` of the leaf `node`
+ */
+static void* bnode_elem(btree_t* bt, bnode_t* node, size_t i)
+{
+	return (char*) node + bt->elems_offset + i*bt->member_size;
+}
+
+/*
+ * returns the array of children of the internal node `node`
+ */
+static bnode_t** bnode_children(btree_t* bt, bnode_t* node)
+{
+	return (bnode_t**) ((char*) node + bt->children_offset);
+}
+
+/*
+ * allocates an empty node
+ */
+static bnode_t* bnode_create(btree_t* bt, int leaf)
+{
+	size_t size = leaf
+		? bt->elems_offset + bt->leaf_capacity*bt->member_size
+		: bt->children_offset + (bt->inner_capacity + 1)*sizeof(bnode_t*);
+
+	bnode_t* node = (bnode_t*) malloc(size);
+
+	node->n = 0;
+	node->leaf = leaf;
+	node->next = NULL;
+	node->prev = NULL;
+
+	return node;
+}
+
+/*
+ * deallocates `node` and its subtree
+ */
+static void bnode_destroy(btree_t* bt, bnode_t* node)
+{
+	if(!node->leaf){
+		size_t i;
+		for(i = 0; i <= node->n; i++)
+			bnode_destroy(bt, bnode_children(bt, node)[i]);
+	}
+
+	free(node);
+}
+
+/*
+ * binary search of `key` in the keys of `node`; returns the
+ * number of keys smaller than `key` or, if `upper`, the number
+ * of keys smaller or equal to `key`. `*equal` is set if the
+ * key at the returned position is equal to `key`.
+ */
+static size_t bnode_search(btree_t* bt, bnode_t* node, void* key, int upper, int* equal)
+{
+	size_t lo = 0;
+	size_t hi = node->n;
+
+	*equal = 0;
+
+	while(lo < hi){
+		size_t mid = lo + (hi - lo)/2;
+		int c = bt->compare(bnode_key(bt, node, mid), key, bt->compare_argument);
+
+		if(c < 0 || (upper && c == 0)){
+			lo = mid + 1;
+		}else{
+			*equal = c == 0;
+			hi = mid;
+		}
+	}
+
+	return lo;
+}
+
+/*
+ * returns the leaf where `key` is or would be and
+ * writes its position in `i`
+ */
+static bnode_t* btree_find_leaf(btree_t* bt, void* key, size_t* i, int* equal)
+{
+	bnode_t* node = bt->root;
+
+	*i = 0;
+	*equal = 0;
+
+	if(!node)
+		return NULL;
+
+	while(!node->leaf)
+		node = bnode_children(bt, node)[bnode_search(bt, node, key, 1, equal)];
+
+	*i = bnode_search(bt, node, key, 0, equal);
+
+	return node;
+}
+
+/*
+ * inserts the pair at the position `i` of the leaf `node`,
+ * which has room for it
+ */
+static void bnode_insert_pair(btree_t* bt, bnode_t* node, size_t i, void* key, void* elem)
+{
+	memmove(bnode_key(bt, node, i + 1), bnode_key(bt, node, i), (node->n - i)*bt->key_size);
+	memmove(bnode_elem(bt, node, i + 1), bnode_elem(bt, node, i), (node->n - i)*bt->member_size);
+
+	memcpy(bnode_key(bt, node, i), key, bt->key_size);
+
+	if(elem)
+		memcpy(bnode_elem(bt, node, i), elem, bt->member_size);
+	else
+		memset(bnode_elem(bt, node, i), 0, bt->member_size);
+
+	node->n++;
+}
+
+/*
+ * inserts the separator `key` at the position `i` of the internal
+ * `node`, which has room for it, with `right` as the child after it
+ */
+static void bnode_insert_child(btree_t* bt, bnode_t* node, size_t i, void* key, bnode_t* right)
+{
+	bnode_t** children = bnode_children(bt, node);
+
+	memmove(bnode_key(bt, node, i + 1), bnode_key(bt, node, i), (node->n - i)*bt->key_size);
+	memmove(children + i + 2, children + i + 1, (node->n - i)*sizeof(bnode_t*));
+
+	memcpy(bnode_key(bt, node, i), key, bt->key_size);
+	children[i + 1] = right;
+
+	node->n++;
+}
+
+/*
+ * finds the key `key` in `bt` or inserts it with the element
+ * `elem`, or a zeroed one if `elem` is null, in a single descent;
+ * returns the element of the pair in its leaf
+ */
+static void* btree_insert_pair(btree_t* bt, void* key, void* elem)
+{
+	if(!bt->root)
+		bt->root = bnode_create(bt, 1);
+
+	bnode_t* right;
+	void* pair;
+
+	if(btree_insert_node(bt, bt->root, key, elem, &right, &pair)){
+		/*
+		 * the root was split; the separator is
+		 * in the scratch buffer
+		 */
+		bnode_t* root = bnode_create(bt, 0);
+
+		memcpy(bnode_key(bt, root, 0), bt->scratch, bt->key_size);
+		bnode_children(bt, root)[0] = bt->root;
+		bnode_children(bt, root)[1] = right;
+		root->n = 1;
+
+		bt->root = root;
+	}
+
+	return pair;
+}
+
+/*
+ * inserts the pair in the subtree of `node`, if the key is not
+ * there, and writes in `*pair` the element of the key in its
+ * leaf; the splits of the internal nodes on the way back do not
+ * move the pairs. Returns 1 if `node` was split, in which case
+ * `*right` is the new node after it and the separator is written
+ * in the first key of the scratch buffer
+ */
+static int btree_insert_node(
+		btree_t* bt,
+		bnode_t* node,
+		void* key,
+		void* elem,
+		bnode_t** right,
+		void** pair)
+{
+	int equal;
+
+	if(node->leaf){
+		size_t i = bnode_search(bt, node, key, 0, &equal);
+
+		if(equal){
+			*pair = bnode_elem(bt, node, i);
+			return 0;
+		}
+
+		bt->size++;
+
+		if(node->n < bt->leaf_capacity){
+			bnode_insert_pair(bt, node, i, key, elem);
+			*pair = bnode_elem(bt, node, i);
+			return 0;
+		}
+
+		/*
+		 * split the leaf in halves and link the new one
+		 */
+		size_t mid = node->n/2;
+		bnode_t* r = bnode_create(bt, 1);
+
+		r->n = node->n - mid;
+		memcpy(bnode_key(bt, r, 0), bnode_key(bt, node, mid), r->n*bt->key_size);
+		memcpy(bnode_elem(bt, r, 0), bnode_elem(bt, node, mid), r->n*bt->member_size);
+		node->n = mid;
+
+		r->next = node->next;
+		r->prev = node;
+		if(node->next)
+			node->next->prev = r;
+		node->next = r;
+
+		if(i > mid){
+			bnode_insert_pair(bt, r, i - mid, key, elem);
+			*pair = bnode_elem(bt, r, i - mid);
+		}else{
+			bnode_insert_pair(bt, node, i, key, elem);
+			*pair = bnode_elem(bt, node, i);
+		}
+
+		memcpy(bt->scratch, bnode_key(bt, r, 0), bt->key_size);
+		*right = r;
+
+		return 1;
+	}
+
+	size_t i = bnode_search(bt, node, key, 1, &equal);
+	bnode_t* child_right;
+
+	if(!btree_insert_node(bt, bnode_children(bt, node)[i], key, elem, &child_right, pair))
+		return 0;
+
+	void* separator = bt->scratch;
+
+	if(node->n < bt->inner_capacity){
+		bnode_insert_child(bt, node, i, separator, child_right);
+		return 0;
+	}
+
+	/*
+	 * split the internal node; the middle key goes up
+	 */
+	void* up = (char*) bt->scratch + bt->key_size;
+	size_t mid = node->n/2;
+	bnode_t* r = bnode_create(bt, 0);
+
+	memcpy(up, bnode_key(bt, node, mid), bt->key_size);
+
+	r->n = node->n - mid - 1;
+	memcpy(bnode_key(bt, r, 0), bnode_key(bt, node, mid + 1), r->n*bt->key_size);
+	memcpy(	bnode_children(bt, r),
+		bnode_children(bt, node) + mid + 1,
+		(r->n + 1)*sizeof(bnode_t*));
+	node->n = mid;
+
+	if(i <= mid)
+		bnode_insert_child(bt, node, i, separator, child_right);
+	else
+		bnode_insert_child(bt, r, i - mid - 1, separator, child_right);
+
+	memcpy(bt->scratch, up, bt->key_size);
+	*right = r;
+
+	return 1;
+}
+
+/*
+ * removes `key` from the subtree of `node`, writing its element
+ * in `elem`; returns 1 if the key was found. The children left
+ * with less than half of the capacity are fixed on the way back.
+ */
+static int btree_remove_node(btree_t* bt, bnode_t* node, void* key, void* elem)
+{
+	int equal;
+
+	if(node->leaf){
+		size_t i = bnode_search(bt, node, key, 0, &equal);
+
+		if(!equal)
+			return 0;
+
+		if(elem)
+			memcpy(elem, bnode_elem(bt, node, i), bt->member_size);
+
+		memmove(bnode_key(bt, node, i), bnode_key(bt, node, i + 1), (node->n - i - 1)*bt->key_size);
+		memmove(bnode_elem(bt, node, i), bnode_elem(bt, node, i + 1), (node->n - i - 1)*bt->member_size);
+		node->n--;
+		bt->size--;
+
+		return 1;
+	}
+
+	size_t i = bnode_search(bt, node, key, 1, &equal);
+	bnode_t* child = bnode_children(bt, node)[i];
+
+	if(!btree_remove_node(bt, child, key, elem))
+		return 0;
+
+	if(child->n < (child->leaf ? bt->leaf_capacity : bt->inner_capacity)/2)
+		btree_fix_child(bt, node, i);
+
+	return 1;
+}
+
+/*
+ * removes the key `i` and the child `i + 1` of the internal `node`
+ */
+static void bnode_remove_inner(btree_t* bt, bnode_t* node, size_t i)
+{
+	bnode_t** children = bnode_children(bt, node);
+
+	memmove(bnode_key(bt, node, i), bnode_key(bt, node, i + 1), (node->n - i - 1)*bt->key_size);
+	memmove(children + i + 1, children + i + 2, (node->n - i - 1)*sizeof(bnode_t*));
+
+	node->n--;
+}
+
+/*
+ * fixes the child `i` of `parent`, which has one key less than
+ * the minimum, by borrowing a key from a sibling or by merging
+ * it with a sibling
+ */
+static void btree_fix_child(btree_t* bt, bnode_t* parent, size_t i)
+{
+	bnode_t** pc = bnode_children(bt, parent);
+	bnode_t* child = pc[i];
+	bnode_t* left = i > 0 ? pc[i - 1] : NULL;
+	bnode_t* right = i < parent->n ? pc[i + 1] : NULL;
+	size_t min = (child->leaf ? bt->leaf_capacity : bt->inner_capacity)/2;
+
+	if(child->leaf){
+		if(left && left->n > min){
+			bnode_insert_pair(	bt, child, 0,
+						bnode_key(bt, left, left->n - 1),
+						bnode_elem(bt, left, left->n - 1));
+			left->n--;
+			memcpy(bnode_key(bt, parent, i - 1), bnode_key(bt, child, 0), bt->key_size);
+
+		}else if(right && right->n > min){
+			bnode_insert_pair(	bt, child, child->n,
+						bnode_key(bt, right, 0),
+						bnode_elem(bt, right, 0));
+			memmove(bnode_key(bt, right, 0), bnode_key(bt, right, 1), (right->n - 1)*bt->key_size);
+			memmove(bnode_elem(bt, right, 0), bnode_elem(bt, right, 1), (right->n - 1)*bt->member_size);
+			right->n--;
+			memcpy(bnode_key(bt, parent, i), bnode_key(bt, right, 0), bt->key_size);
+
+		}else{
+			/*
+			 * merge the child with a sibling: `a` absorbs `b`
+			 */
+			bnode_t* a = left ? left : child;
+			bnode_t* b = left ? child : right;
+
+			memcpy(bnode_key(bt, a, a->n), bnode_key(bt, b, 0), b->n*bt->key_size);
+			memcpy(bnode_elem(bt, a, a->n), bnode_elem(bt, b, 0), b->n*bt->member_size);
+			a->n += b->n;
+
+			a->next = b->next;
+			if(b->next)
+				b->next->prev = a;
+
+			bnode_remove_inner(bt, parent, left ? i - 1 : i);
+			free(b);
+		}
+
+		return;
+	}
+
+	if(left && left->n > min){
+		bnode_t** cc = bnode_children(bt, child);
+
+		memmove(bnode_key(bt, child, 1), bnode_key(bt, child, 0), child->n*bt->key_size);
+		memmove(cc + 1, cc, (child->n + 1)*sizeof(bnode_t*));
+
+		memcpy(bnode_key(bt, child, 0), bnode_key(bt, parent, i - 1), bt->key_size);
+		cc[0] = bnode_children(bt, left)[left->n];
+		child->n++;
+
+		memcpy(bnode_key(bt, parent, i - 1), bnode_key(bt, left, left->n - 1), bt->key_size);
+		left->n--;
+
+	}else if(right && right->n > min){
+		bnode_t** rc = bnode_children(bt, right);
+
+		memcpy(bnode_key(bt, child, child->n), bnode_key(bt, parent, i), bt->key_size);
+		bnode_children(bt, child)[child->n + 1] = rc[0];
+		child->n++;
+
+		memcpy(bnode_key(bt, parent, i), bnode_key(bt, right, 0), bt->key_size);
+
+		memmove(bnode_key(bt, right, 0), bnode_key(bt, right, 1), (right->n - 1)*bt->key_size);
+		memmove(rc, rc + 1, right->n*sizeof(bnode_t*));
+		right->n--;
+
+	}else{
+		/*
+		 * merge: `a` absorbs the separator and `b`
+		 */
+		size_t k = left ? i - 1 : i;
+		bnode_t* a = left ? left : child;
+		bnode_t* b = left ? child : right;
+
+		memcpy(bnode_key(bt, a, a->n), bnode_key(bt, parent, k), bt->key_size);
+		memcpy(bnode_key(bt, a, a->n + 1), bnode_key(bt, b, 0), b->n*bt->key_size);
+		memcpy(	bnode_children(bt, a) + a->n + 1,
+			bnode_children(bt, b),
+			(b->n + 1)*sizeof(bnode_t*));
+		a->n += b->n + 1;
+
+		bnode_remove_inner(bt, parent, k);
+		free(b);
+	}
+}
+
+/*
+ * builds the internal nodes over the `count` nodes of `nodes`,
+ * whose smallest keys are in `mins`, spreading the children
+ * evenly; the new nodes and their smallest keys are written at
+ * the beginning of `nodes` and `mins`, and their number returned.
+ * With `parents` = ceil(count/(inner_capacity + 1)) each node gets
+ * more than half of the maximum number of children
+ */
+static size_t btree_build_level(btree_t* bt, bnode_t** nodes, void** mins, size_t count)
+{
+	size_t fanout = bt->inner_capacity + 1;
+	size_t parents = (count + fanout - 1)/fanout;
+	size_t i, j, c;
+
+	for(i = 0, j = 0; j < parents; j++){
+		bnode_t* node = bnode_create(bt, 0);
+		bnode_t** children = bnode_children(bt, node);
+		size_t fill = count/parents + (j < count % parents);
+		void* min = mins[i];
+
+		/*
+		 * the separator before each child but the
+		 * first is the smallest key of its subtree
+		 */
+		for(c = 0; c < fill; c++, i++){
+			if(c)
+				memcpy(bnode_key(bt, node, c - 1), mins[i], bt->key_size);
+			children[c] = nodes[i];
+		}
+
+		node->n = fill - 1;
+		nodes[j] = node;
+		mins[j] = min;
+	}
+
+	return parents;
+}
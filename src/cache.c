@@ -0,0 +1,456 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ */
+#include "cache.h"
+#include "galign.h"
+
+#define CACHE_NONE ((size_t) -1)
+
+#define CACHE_ENTRY(c, i) ((centry_t*) ((c)->slots + (i)*(c)->slot_size))
+#define CACHE_KEY(c, e) ((char*) (e) + G_ALIGN(sizeof(centry_t)))
+#define CACHE_ELEM(c, e) (CACHE_KEY(c, e) + G_ALIGN((c)->key_size))
+
+/*
+ * auxiliar function prototypes
+ */
+static void cache_unlink(cache_t* c, size_t i);
+static void cache_push_front(cache_t* c, size_t i);
+static void cache_touch(cache_t* c, size_t i);
+static size_t cache_victim(cache_t* c);
+static void cache_evict(cache_t* c, size_t i);
+static size_t cache_lookup(cache_t* c, void* key);
+
+/** Creates a cache of at most `capacity` entries of keys with size
+  * `key_size` mapped to elements with size `member_size`, evicted
+  * by `policy`, and populates the previous allocated structure `c`.
+  * The slots of the entries are allocated at once; by default the
+  * keys are hashed and compared byte by byte.
+  *
+  * @param c		pointer to a previous allocated `cache_t` structure;
+  * @param key_size	size of the keys in bytes
+  * @param member_size	size of the elements in bytes
+  * @param capacity	maximum number of entries, greater than zero
+  * @param policy	G_CACHE_LRU or G_CACHE_CLOCK
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `c` is null
+  * 		GERROR_ACCESS_OUT_OF_BOUND in case `capacity` is zero
+  */
+gerror_t cache_create (
+		struct cache_t* c,
+		size_t key_size,
+		size_t member_size,
+		size_t capacity,
+		cache_policy_t policy)
+{
+	if(!c) return GERROR_NULL_STRUCTURE;
+	if(!capacity) return GERROR_ACCESS_OUT_OF_BOUND;
+
+	size_t i;
+
+	c->size = 0;
+	c->capacity = capacity;
+	c->key_size = key_size;
+	c->member_size = member_size;
+	c->slot_size = G_ALIGN(sizeof(centry_t)) + G_ALIGN(key_size) + G_ALIGN(member_size);
+	c->policy = policy;
+
+	c->hits = 0;
+	c->misses = 0;
+	c->evictions = 0;
+
+	c->evict = NULL;
+	c->evict_argument = NULL;
+
+	c->slots = (char*) calloc(capacity, c->slot_size);
+
+	/*
+	 * all the slots start in the free list
+	 */
+	for(i = 0; i < capacity; i++)
+		CACHE_ENTRY(c, i)->next = i + 1 < capacity ? i + 1 : CACHE_NONE;
+
+	c->head = CACHE_NONE;
+	c->tail = CACHE_NONE;
+	c->free = 0;
+	c->hand = 0;
+
+	return hashmap_create(&c->index, key_size, sizeof(size_t));
+}
+
+/** Destroys and deallocates the slots and the index of `c`. The
+  * evict function is not called for the entries left in `c`.
+  *
+  * @param c	pointer to a previous allocated `cache_t` structure;
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `c` is null
+  */
+gerror_t cache_destroy (struct cache_t* c)
+{
+	if(!c) return GERROR_NULL_STRUCTURE;
+
+	free(c->slots);
+	c->slots = NULL;
+	c->size = 0;
+	c->capacity = 0;
+
+	return hashmap_destroy(&c->index);
+}
+
+/** Sets the function called with each entry evicted from `c` to
+  * make room for a new one; the entries removed by cache_remove
+  * are not passed to it.
+  *
+  * @param c		pointer to a previous allocated `cache_t` structure;
+  * @param function	function called with the key, the element and `argument`
+  * 			or NULL
+  * @param argument	argument to `function`
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `c` is null
+  */
+gerror_t cache_set_evict_function(
+		struct cache_t* c,
+		cache_evict_function function,
+		void* argument)
+{
+	if(!c) return GERROR_NULL_STRUCTURE;
+
+	c->evict = function;
+	c->evict_argument = argument;
+
+	return GERROR_OK;
+}
+
+/** Change the hash function of the keys of `c`; it must be set
+  * while `c` is empty.
+  *
+  * @param c		pointer to a previous allocated `cache_t` structure;
+  * @param function	hash function of the keys
+  * @param argument	pointer to the argument to the hash function
+  *
+  * @see hashmap_set_hash_function
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `c` is null
+  */
+gerror_t cache_set_hash_function(
+		struct cache_t* c,
+		hashmap_hash_function function,
+		void* argument)
+{
+	if(!c) return GERROR_NULL_STRUCTURE;
+
+	return hashmap_set_hash_function(&c->index, function, argument);
+}
+
+/** Change the compare function of the keys of `c`, which must
+  * agree with the hash function; it must be set while `c` is empty.
+  *
+  * @param c		pointer to a previous allocated `cache_t` structure;
+  * @param function	comparison function of the keys
+  * @param argument	pointer to the argument to the comparison function
+  *
+  * @see hashmap_set_compare_function
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `c` is null
+  */
+gerror_t cache_set_compare_function(
+		struct cache_t* c,
+		hashmap_compare_function function,
+		void* argument)
+{
+	if(!c) return GERROR_NULL_STRUCTURE;
+
+	return hashmap_set_compare_function(&c->index, function, argument);
+}
+
+/** Puts the element `elem` at the key `key` in `c`; if the key is
+  * already in `c` its element is overwritten and the entry counts
+  * as used. If `c` is full, an entry is evicted by the policy of `c`
+  * and passed to the evict function, and its slot is reused.
+  * O(1) expected; a full cache does not allocate.
+  *
+  * @param c	pointer to a previous allocated `cache_t` structure;
+  * @param key	pointer to the key
+  * @param elem	pointer to the element to be copied or NULL
+  * 		to store a zeroed element
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `c` is null
+  * 		GERROR_NULL_KEY in case that `key` is null
+  */
+gerror_t cache_put (struct cache_t* c, void* key, void* elem)
+{
+	if(!c) return GERROR_NULL_STRUCTURE;
+	if(!key) return GERROR_NULL_KEY;
+
+	centry_t* e;
+	size_t i = cache_lookup(c, key);
+
+	if(i != CACHE_NONE){
+		e = CACHE_ENTRY(c, i);
+		if(elem)
+			memcpy(CACHE_ELEM(c, e), elem, c->member_size);
+
+		cache_touch(c, i);
+		return GERROR_OK;
+	}
+
+	if(c->free == CACHE_NONE){
+		i = cache_victim(c);
+		cache_evict(c, i);
+	}else{
+		i = c->free;
+		c->free = CACHE_ENTRY(c, i)->next;
+	}
+
+	e = CACHE_ENTRY(c, i);
+	memcpy(CACHE_KEY(c, e), key, c->key_size);
+
+	if(elem)
+		memcpy(CACHE_ELEM(c, e), elem, c->member_size);
+	else
+		memset(CACHE_ELEM(c, e), 0, c->member_size);
+
+	e->referenced = 0;
+
+	if(c->policy == G_CACHE_LRU)
+		cache_push_front(c, i);
+
+	hashmap_insert(&c->index, key, &i);
+	c->size++;
+
+	return GERROR_OK;
+}
+
+/** Writes the element at the key `key` in `elem` and counts the
+  * entry as used; counts a hit or a miss. O(1) expected.
+  *
+  * @param c	pointer to a previous allocated `cache_t` structure;
+  * @param key	pointer to the key
+  * @param elem	pointer to a location of memory where the element
+  * 		will be written or NULL to only check the key
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `c` is null
+  * 		GERROR_NULL_KEY in case that `key` is null
+  * 		GERROR_ELEMENT_NOT_FOUNDED in case `key` is not in `c`
+  */
+gerror_t cache_get (struct cache_t* c, void* key, void* elem)
+{
+	void* ptr;
+	gerror_t g = cache_get_ptr(c, key, &ptr);
+
+	if(g == GERROR_OK && elem)
+		memcpy(elem, ptr, c->member_size);
+
+	return g;
+}
+
+/** Writes in `elem` a pointer to the element at the key `key`,
+  * stored in its slot, without copying it, and counts the entry as
+  * used; counts a hit or a miss. The element can be changed in
+  * place; the pointer is valid until the next put or remove in `c`,
+  * which may evict the entry and reuse its slot. O(1) expected.
+  *
+  * @param c	pointer to a previous allocated `cache_t` structure;
+  * @param key	pointer to the key
+  * @param elem	pointer to write the pointer to the element
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `c` is null
+  * 		GERROR_NULL_KEY in case that `key` is null
+  * 		GERROR_NULL_RETURN_POINTER in case `elem` is null
+  * 		GERROR_ELEMENT_NOT_FOUNDED in case `key` is not in `c`;
+  * 		`*elem` is set to NULL
+  */
+gerror_t cache_get_ptr (struct cache_t* c, void* key, void** elem)
+{
+	if(!c) return GERROR_NULL_STRUCTURE;
+	if(!key) return GERROR_NULL_KEY;
+	if(!elem) return GERROR_NULL_RETURN_POINTER;
+
+	size_t i = cache_lookup(c, key);
+
+	if(i == CACHE_NONE){
+		c->misses++;
+		*elem = NULL;
+		return GERROR_ELEMENT_NOT_FOUNDED;
+	}
+
+	c->hits++;
+	cache_touch(c, i);
+	*elem = CACHE_ELEM(c, CACHE_ENTRY(c, i));
+
+	return GERROR_OK;
+}
+
+/** Removes the key `key` of `c` and writes its element in `elem`;
+  * the evict function is not called. O(1) expected.
+  *
+  * @param c	pointer to a previous allocated `cache_t` structure;
+  * @param key	pointer to the key
+  * @param elem	pointer to a location of memory where the element
+  * 		will be written or NULL
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `c` is null
+  * 		GERROR_NULL_KEY in case that `key` is null
+  * 		GERROR_ELEMENT_NOT_FOUNDED in case `key` is not in `c`
+  */
+gerror_t cache_remove (struct cache_t* c, void* key, void* elem)
+{
+	if(!c) return GERROR_NULL_STRUCTURE;
+	if(!key) return GERROR_NULL_KEY;
+
+	size_t i = cache_lookup(c, key);
+
+	if(i == CACHE_NONE)
+		return GERROR_ELEMENT_NOT_FOUNDED;
+
+	centry_t* e = CACHE_ENTRY(c, i);
+
+	if(elem)
+		memcpy(elem, CACHE_ELEM(c, e), c->member_size);
+
+	hashmap_remove(&c->index, key, NULL);
+
+	if(c->policy == G_CACHE_LRU)
+		cache_unlink(c, i);
+
+	e->next = c->free;
+	c->free = i;
+	c->size--;
+
+	return GERROR_OK;
+}
+
+/*
+ * returns the slot of `key` or CACHE_NONE
+ */
+static size_t cache_lookup(cache_t* c, void* key)
+{
+	size_t slot;
+
+	if(hashmap_find(&c->index, key, &slot) != GERROR_OK)
+		return CACHE_NONE;
+
+	return slot;
+}
+
+/*
+ * removes the slot `i` from the recency list
+ */
+static void cache_unlink(cache_t* c, size_t i)
+{
+	centry_t* e = CACHE_ENTRY(c, i);
+
+	if(e->prev != CACHE_NONE)
+		CACHE_ENTRY(c, e->prev)->next = e->next;
+	else
+		c->head = e->next;
+
+	if(e->next != CACHE_NONE)
+		CACHE_ENTRY(c, e->next)->prev = e->prev;
+	else
+		c->tail = e->prev;
+}
+
+/*
+ * links the slot `i` as the most recent of the recency list
+ */
+static void cache_push_front(cache_t* c, size_t i)
+{
+	centry_t* e = CACHE_ENTRY(c, i);
+
+	e->prev = CACHE_NONE;
+	e->next = c->head;
+
+	if(c->head != CACHE_NONE)
+		CACHE_ENTRY(c, c->head)->prev = i;
+	else
+		c->tail = i;
+
+	c->head = i;
+}
+
+/*
+ * marks the slot `i` as used: LRU moves it to the front of
+ * the recency list and CLOCK only sets its referenced bit
+ */
+static void cache_touch(cache_t* c, size_t i)
+{
+	if(c->policy == G_CACHE_CLOCK){
+		CACHE_ENTRY(c, i)->referenced = 1;
+		return;
+	}
+
+	if(c->head == i)
+		return;
+
+	cache_unlink(c, i);
+	cache_push_front(c, i);
+}
+
+/*
+ * returns the slot to evict from the full cache `c`
+ */
+static size_t cache_victim(cache_t* c)
+{
+	if(c->policy == G_CACHE_LRU)
+		return c->tail;
+
+	/*
+	 * the hand clears the referenced bits until it finds an
+	 * entry without it, in at most one turn of the slots
+	 */
+	for(;;){
+		size_t i = c->hand;
+		centry_t* e = CACHE_ENTRY(c, i);
+
+		c->hand = i + 1 < c->capacity ? i + 1 : 0;
+
+		if(!e->referenced)
+			return i;
+
+		e->referenced = 0;
+	}
+}
+
+/*
+ * evicts the entry of the slot `i`, which is left unused
+ * and out of the free list
+ */
+static void cache_evict(cache_t* c, size_t i)
+{
+	centry_t* e = CACHE_ENTRY(c, i);
+
+	if(c->evict)
+		c->evict(CACHE_KEY(c, e), CACHE_ELEM(c, e), c->evict_argument);
+
+	hashmap_remove(&c->index, CACHE_KEY(c, e), NULL);
+
+	if(c->policy == G_CACHE_LRU)
+		cache_unlink(c, i);
+
+	c->size--;
+	c->evictions++;
+}
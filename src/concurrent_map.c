@@ -0,0 +1,667 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ */
+
+#include <stddef.h>
+#include <sched.h>
+#include "concurrent_map.h"
+
+#define CMAP_PUBLISH(PTR, VALUE)	__atomic_store_n(&(PTR), (VALUE), __ATOMIC_RELEASE)
+#define CMAP_LOAD(PTR)			__atomic_load_n(&(PTR), __ATOMIC_ACQUIRE)
+
+/*
+ * auxiliar function prototypes
+ */
+static cmnode_t* cmnode_create(cmap_t* m, void* key, void* value, int level);
+static void cmnode_lock(cmnode_t* node);
+static void cmnode_unlock(cmnode_t* node);
+static int cmap_random_level(cmap_t* m, size_t thread);
+static int cmap_compare(cmap_t* m, void* key, cmnode_t* node);
+static void cmap_top_level(cmap_t* m, int level);
+static int cmap_find(cmap_t* m, void* key, int level, cmnode_t** preds, cmnode_t** succs);
+static int cmap_lock_preds(	cmnode_t** preds,
+				cmnode_t** succs,
+				int level,
+				int* locked);
+static void cmap_unlock_preds(cmnode_t** preds, int locked);
+
+/** Creates a concurrent ordered map of keys with size `key_size`
+  * mapped to elements with size `member_size` and populates the
+  * previous allocated structure `m`. Up to `max_threads` threads
+  * can be registered to use the map at the same time.
+  * The default compare function only works for char, int and long
+  * keys; see cmap_set_compare_function.
+  *
+  * @param m		pointer to a previous allocated `cmap_t` structure;
+  * @param key_size	size of the keys in bytes
+  * @param member_size	size of the elements in bytes
+  * @param max_threads	maximum number of registered threads
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `m` is null
+  */
+gerror_t cmap_create (
+		struct cmap_t* m,
+		size_t key_size,
+		size_t member_size,
+		size_t max_threads)
+{
+	if(!m) return GERROR_NULL_STRUCTURE;
+
+	m->size = 0;
+	m->key_size = key_size;
+	m->member_size = member_size;
+	m->compare = cmap_default_compare_function;
+	m->compare_argument = &(m->key_size);
+
+	m->head = cmnode_create(m, NULL, NULL, CMAP_MAX_LEVEL);
+	m->head->linked = 1;
+	m->level = 1;
+
+	epoch_create(&m->epoch, max_threads);
+	m->threads = (cmap_thread_t*) calloc(max_threads ? max_threads : 1, sizeof(cmap_thread_t));
+
+	return GERROR_OK;
+}
+
+/** Destroys and deallocates the nodes and the elements of `m`.
+  * No thread can be using the map.
+  *
+  * @param m	pointer to a previous allocated `cmap_t` structure;
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `m` is null
+  */
+gerror_t cmap_destroy (struct cmap_t* m)
+{
+	if(!m) return GERROR_NULL_STRUCTURE;
+
+	cmnode_t* node = m->head;
+
+	while(node != NULL){
+		cmnode_t* next = node->next[0];
+		free(node->value);
+		free(node);
+		node = next;
+	}
+
+	epoch_destroy(&m->epoch);
+	free(m->threads);
+
+	m->head = NULL;
+	m->threads = NULL;
+	m->size = 0;
+
+	return GERROR_OK;
+}
+
+/** Change the compare function of the keys of `m`; it must be
+  * set before the first insert and it must be thread safe.
+  *
+  * @param m		pointer to a previous allocated `cmap_t` structure;
+  * @param function	compare function or NULL for the default one
+  * @param argument	pointer to the argument to the compare function
+  *
+  * @see rbtree_set_compare_function
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `m` is null
+  */
+gerror_t cmap_set_compare_function(
+		struct cmap_t* m,
+		cmap_compare_function function,
+		void* argument)
+{
+	if(!m) return GERROR_NULL_STRUCTURE;
+
+	if(!function){
+		m->compare = cmap_default_compare_function;
+		m->compare_argument = &(m->key_size);
+		return GERROR_OK;
+	}
+
+	m->compare = function;
+	m->compare_argument = argument;
+
+	return GERROR_OK;
+}
+
+/** Registers the calling thread in `m`; every thread has to be
+  * registered before reading or changing the map.
+  *
+  * @param m		pointer to a previous allocated `cmap_t` structure;
+  * @param thread	pointer to the returned thread id
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `m` is null
+  * 		GERROR_NULL_RETURN_POINTER in case `thread` is null
+  * 		GERROR_FULL_STRUCTURE in case there are `max_threads`
+  * 		threads registered
+  */
+gerror_t cmap_register (struct cmap_t* m, size_t* thread)
+{
+	if(!m) return GERROR_NULL_STRUCTURE;
+
+	gerror_t g = epoch_register(&m->epoch, thread);
+	if(g != GERROR_OK)
+		return g;
+
+	m->threads[*thread].random = 2654435761UL * (*thread + 1);
+
+	return GERROR_OK;
+}
+
+/** Unregisters the thread `thread` of `m`.
+  *
+  * @param m		pointer to a previous allocated `cmap_t` structure;
+  * @param thread	thread id returned by `cmap_register`
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `m` is null
+  * 		GERROR_ACCESS_OUT_OF_BOUND in case `thread` is invalid
+  */
+gerror_t cmap_unregister (struct cmap_t* m, size_t thread)
+{
+	if(!m) return GERROR_NULL_STRUCTURE;
+
+	return epoch_unregister(&m->epoch, thread);
+}
+
+/** Inserts a copy of `elem` in the key `key` of `m`; the element
+  * of an existing key is replaced atomically, so the readers see
+  * either the old or the new element, never a mix of both.
+  *
+  * @param m		pointer to a previous allocated `cmap_t` structure;
+  * @param thread	thread id returned by `cmap_register`
+  * @param key		pointer to the key
+  * @param elem		pointer to the element
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `m` is null
+  * 		GERROR_NULL_KEY in case that `key` is null
+  * 		GERROR_NULL_ELEMENT_POINTER in case that `elem` is null
+  * 		GERROR_ACCESS_OUT_OF_BOUND in case `thread` is invalid
+  */
+gerror_t cmap_insert (struct cmap_t* m, size_t thread, void* key, void* elem)
+{
+	if(!m) return GERROR_NULL_STRUCTURE;
+	if(!key) return GERROR_NULL_KEY;
+	if(!elem) return GERROR_NULL_ELEMENT_POINTER;
+	if(thread >= m->epoch.nslots) return GERROR_ACCESS_OUT_OF_BOUND;
+
+	cmnode_t* preds[CMAP_MAX_LEVEL];
+	cmnode_t* succs[CMAP_MAX_LEVEL];
+	int level = cmap_random_level(m, thread);
+	int l;
+
+	void* value = malloc(m->member_size ? m->member_size : 1);
+	memcpy(value, elem, m->member_size);
+
+	epoch_enter(&m->epoch, thread);
+
+	for(;;){
+		int found = cmap_find(m, key, level, preds, succs);
+
+		if(found != -1){
+			cmnode_t* node = succs[found];
+
+			/*
+			 * the element is replaced under the lock of the
+			 * node, so it is never replaced after a remove
+			 * took it; a marked node is retried
+			 */
+			cmnode_lock(node);
+			if(!CMAP_LOAD(node->marked)){
+				while(!CMAP_LOAD(node->linked))
+					sched_yield();
+
+				void* old = __atomic_exchange_n(&node->value, value, __ATOMIC_ACQ_REL);
+				cmnode_unlock(node);
+
+				epoch_leave(&m->epoch, thread);
+				epoch_retire(&m->epoch, old);
+				return GERROR_OK;
+			}
+			cmnode_unlock(node);
+			continue;
+		}
+
+		int locked;
+		if(!cmap_lock_preds(preds, succs, level, &locked)){
+			cmap_unlock_preds(preds, locked);
+			continue;
+		}
+
+		cmap_top_level(m, level);
+
+		cmnode_t* node = cmnode_create(m, key, value, level);
+		for(l = 0; l < level; l++)
+			node->next[l] = succs[l];
+
+		for(l = 0; l < level; l++)
+			CMAP_PUBLISH(preds[l]->next[l], node);
+
+		CMAP_PUBLISH(node->linked, 1);
+		cmap_unlock_preds(preds, locked);
+		break;
+	}
+
+	epoch_leave(&m->epoch, thread);
+	__atomic_add_fetch(&m->size, 1, __ATOMIC_RELAXED);
+
+	return GERROR_OK;
+}
+
+/** Removes the key `key` of `m` and writes its element in `elem`.
+  *
+  * @param m		pointer to a previous allocated `cmap_t` structure;
+  * @param thread	thread id returned by `cmap_register`
+  * @param key		pointer to the key
+  * @param elem		pointer to a location of memory where the element
+  * 			will be written or NULL
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `m` is null
+  * 		GERROR_NULL_KEY in case that `key` is null
+  * 		GERROR_ACCESS_OUT_OF_BOUND in case `thread` is invalid
+  * 		GERROR_ELEMENT_NOT_FOUNDED in case `key` is not in `m`
+  */
+gerror_t cmap_remove (struct cmap_t* m, size_t thread, void* key, void* elem)
+{
+	if(!m) return GERROR_NULL_STRUCTURE;
+	if(!key) return GERROR_NULL_KEY;
+	if(thread >= m->epoch.nslots) return GERROR_ACCESS_OUT_OF_BOUND;
+
+	cmnode_t* preds[CMAP_MAX_LEVEL];
+	cmnode_t* succs[CMAP_MAX_LEVEL];
+	cmnode_t* victim = NULL;
+	int l;
+
+	epoch_enter(&m->epoch, thread);
+
+	for(;;){
+		int found = cmap_find(m, key, 1, preds, succs);
+
+		if(!victim){
+			/*
+			 * only a node completely linked and not being
+			 * removed, found at its top level, can be removed
+			 */
+			if(found == -1
+			|| !CMAP_LOAD(succs[found]->linked)
+			|| succs[found]->level != found + 1
+			|| CMAP_LOAD(succs[found]->marked)){
+				epoch_leave(&m->epoch, thread);
+				return GERROR_ELEMENT_NOT_FOUNDED;
+			}
+
+			victim = succs[found];
+			cmnode_lock(victim);
+			if(CMAP_LOAD(victim->marked)){
+				cmnode_unlock(victim);
+				epoch_leave(&m->epoch, thread);
+				return GERROR_ELEMENT_NOT_FOUNDED;
+			}
+
+			/*
+			 * the remove takes effect here
+			 */
+			CMAP_PUBLISH(victim->marked, 1);
+		}
+
+		int locked;
+		if(!cmap_lock_preds(preds, succs, victim->level, &locked)){
+			cmap_unlock_preds(preds, locked);
+			continue;
+		}
+
+		for(l = victim->level - 1; l >= 0; l--)
+			CMAP_PUBLISH(preds[l]->next[l], victim->next[l]);
+
+		cmnode_unlock(victim);
+		cmap_unlock_preds(preds, locked);
+		break;
+	}
+
+	void* value = __atomic_exchange_n(&victim->value, NULL, __ATOMIC_ACQ_REL);
+	if(elem)
+		memcpy(elem, value, m->member_size);
+
+	epoch_leave(&m->epoch, thread);
+
+	epoch_retire(&m->epoch, value);
+	epoch_retire(&m->epoch, victim);
+	__atomic_sub_fetch(&m->size, 1, __ATOMIC_RELAXED);
+
+	return GERROR_OK;
+}
+
+/** Writes the element mapped by `key` in `elem`, without locks.
+  *
+  * @param m		pointer to a previous allocated `cmap_t` structure;
+  * @param thread	thread id returned by `cmap_register`
+  * @param key		pointer to the key
+  * @param elem		pointer to a location of memory where the element
+  * 			will be written or NULL
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `m` is null
+  * 		GERROR_NULL_KEY in case that `key` is null
+  * 		GERROR_ACCESS_OUT_OF_BOUND in case `thread` is invalid
+  * 		GERROR_ELEMENT_NOT_FOUNDED in case `key` is not in `m`
+  */
+gerror_t cmap_at (struct cmap_t* m, size_t thread, void* key, void* elem)
+{
+	if(!m) return GERROR_NULL_STRUCTURE;
+	if(!key) return GERROR_NULL_KEY;
+	if(thread >= m->epoch.nslots) return GERROR_ACCESS_OUT_OF_BOUND;
+
+	cmnode_t* pred = m->head;
+	cmnode_t* node = NULL;
+	gerror_t g = GERROR_ELEMENT_NOT_FOUNDED;
+	int l;
+
+	epoch_enter(&m->epoch, thread);
+
+	for(l = CMAP_LOAD(m->level) - 1; l >= 0; l--){
+		int c = 1;
+
+		node = CMAP_LOAD(pred->next[l]);
+		while(node && (c = cmap_compare(m, key, node)) > 0){
+			pred = node;
+			node = CMAP_LOAD(pred->next[l]);
+		}
+
+		if(node && c == 0)
+			break;
+	}
+
+	if(l >= 0 && CMAP_LOAD(node->linked) && !CMAP_LOAD(node->marked)){
+		void* value = CMAP_LOAD(node->value);
+
+		if(value){
+			if(elem)
+				memcpy(elem, value, m->member_size);
+			g = GERROR_OK;
+		}
+	}
+
+	epoch_leave(&m->epoch, thread);
+
+	return g;
+}
+
+/** Calls `function` for each pair of `m` with key in [`lo`, `hi`),
+  * in key order, without locks. The pairs inserted or removed
+  * during the iteration may or may not be visited. `function`
+  * must not change the map.
+  *
+  * @param m		pointer to a previous allocated `cmap_t` structure;
+  * @param thread	thread id returned by `cmap_register`
+  * @param lo		pointer to the smallest key of the range or NULL
+  * 			to start at the first key
+  * @param hi		pointer to the key ending the range (not included)
+  * 			or NULL to go until the last key
+  * @param function	function called for each pair; a non zero
+  * 			return stops the iteration
+  * @param arg		argument passed to `function`
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `m` is null
+  * 		GERROR_NULL_ELEMENT_POINTER in case that `function` is null
+  * 		GERROR_ACCESS_OUT_OF_BOUND in case `thread` is invalid
+  */
+gerror_t cmap_range(
+		struct cmap_t* m,
+		size_t thread,
+		void* lo,
+		void* hi,
+		cmap_range_function function,
+		void* arg)
+{
+	if(!m) return GERROR_NULL_STRUCTURE;
+	if(!function) return GERROR_NULL_ELEMENT_POINTER;
+	if(thread >= m->epoch.nslots) return GERROR_ACCESS_OUT_OF_BOUND;
+
+	cmnode_t* pred = m->head;
+	cmnode_t* node;
+	int l;
+
+	epoch_enter(&m->epoch, thread);
+
+	/*
+	 * the last node smaller than `lo`
+	 */
+	if(lo){
+		for(l = CMAP_LOAD(m->level) - 1; l >= 0; l--){
+			node = CMAP_LOAD(pred->next[l]);
+			while(node && cmap_compare(m, lo, node) > 0){
+				pred = node;
+				node = CMAP_LOAD(pred->next[l]);
+			}
+		}
+	}
+
+	for(node = CMAP_LOAD(pred->next[0]); node != NULL; node = CMAP_LOAD(node->next[0])){
+		if(hi && cmap_compare(m, hi, node) <= 0)
+			break;
+
+		if(!CMAP_LOAD(node->linked) || CMAP_LOAD(node->marked))
+			continue;
+
+		void* value = CMAP_LOAD(node->value);
+		if(value && function(CMNODE_KEY(node), value, arg))
+			break;
+	}
+
+	epoch_leave(&m->epoch, thread);
+
+	return GERROR_OK;
+}
+
+/*
+ * allocates a node with `level` levels, a copy
+ * of `key` and the element `value`
+ */
+static cmnode_t* cmnode_create(cmap_t* m, void* key, void* value, int level)
+{
+	cmnode_t* node = (cmnode_t*) malloc(	offsetof(cmnode_t, next)
+						+ level*sizeof(cmnode_t*)
+						+ m->key_size);
+
+	node->value = value;
+	node->lock = 0;
+	node->marked = 0;
+	node->linked = 0;
+	node->level = level;
+	memset(node->next, 0, level*sizeof(cmnode_t*));
+
+	if(key)
+		memcpy(CMNODE_KEY(node), key, m->key_size);
+
+	return node;
+}
+
+/*
+ * the locks of the nodes are held for a few stores,
+ * so a spin lock is enough
+ */
+static void cmnode_lock(cmnode_t* node)
+{
+	while(__atomic_exchange_n(&node->lock, 1, __ATOMIC_ACQUIRE))
+		sched_yield();
+}
+
+static void cmnode_unlock(cmnode_t* node)
+{
+	__atomic_store_n(&node->lock, 0, __ATOMIC_RELEASE);
+}
+
+/*
+ * level of a new node: i with probability 3/4^i
+ */
+static int cmap_random_level(cmap_t* m, size_t thread)
+{
+	unsigned long x = m->threads[thread].random;
+	int level = 1;
+
+	/*
+	 * xorshift
+	 */
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	m->threads[thread].random = x;
+
+	while(level < CMAP_MAX_LEVEL && (x & 3) == 0){
+		level++;
+		x >>= 2;
+	}
+
+	return level;
+}
+
+/*
+ * compares `key` with the key of `node`
+ */
+static int cmap_compare(cmap_t* m, void* key, cmnode_t* node)
+{
+	return m->compare(key, CMNODE_KEY(node), m->compare_argument);
+}
+
+/*
+ * raises the number of levels in use to `level`; the
+ * searches start at the highest level in use
+ */
+static void cmap_top_level(cmap_t* m, int level)
+{
+	int top = CMAP_LOAD(m->level);
+
+	while(top < level
+	&& !__atomic_compare_exchange_n(	&m->level,
+						&top,
+						level,
+						0,
+						__ATOMIC_ACQ_REL,
+						__ATOMIC_ACQUIRE))
+		;
+}
+
+/*
+ * writes in `preds` and `succs` the nodes around `key` in each
+ * level up to the highest level in use, or `level` if it is
+ * higher, and returns the highest level where `key` was found,
+ * or -1
+ */
+static int cmap_find(cmap_t* m, void* key, int level, cmnode_t** preds, cmnode_t** succs)
+{
+	cmnode_t* pred = m->head;
+	int found = -1;
+	int top = CMAP_LOAD(m->level);
+	int l;
+
+	for(l = (top > level ? top : level) - 1; l >= 0; l--){
+		cmnode_t* node = CMAP_LOAD(pred->next[l]);
+		int c = 1;
+
+		while(node && (c = cmap_compare(m, key, node)) > 0){
+			pred = node;
+			node = CMAP_LOAD(pred->next[l]);
+		}
+
+		if(found == -1 && node && c == 0)
+			found = l;
+
+		preds[l] = pred;
+		succs[l] = node;
+	}
+
+	return found;
+}
+
+/*
+ * locks the predecessors of the levels [0, level), from the
+ * bottom, and checks that they still link to the successors
+ * and that none of them is being removed; `locked` is the
+ * highest locked level
+ */
+static int cmap_lock_preds(	cmnode_t** preds,
+				cmnode_t** succs,
+				int level,
+				int* locked)
+{
+	cmnode_t* prev = NULL;
+	int l;
+
+	*locked = -1;
+
+	for(l = 0; l < level; l++){
+		if(preds[l] != prev){
+			cmnode_lock(preds[l]);
+			*locked = l;
+			prev = preds[l];
+		}
+
+		if(CMAP_LOAD(preds[l]->marked)
+		|| CMAP_LOAD(preds[l]->next[l]) != succs[l])
+			return 0;
+	}
+
+	return 1;
+}
+
+static void cmap_unlock_preds(cmnode_t** preds, int locked)
+{
+	cmnode_t* prev = NULL;
+	int l;
+
+	for(l = 0; l <= locked; l++){
+		if(preds[l] != prev){
+			cmnode_unlock(preds[l]);
+			prev = preds[l];
+		}
+	}
+}
+
+/*
+ * the default comparison function. Just compare
+ * like to long
+ */
+int cmap_default_compare_function(void* a, void* b, void* arg)
+{
+	size_t size = *(size_t*)arg;
+
+	long la = 0;
+	long lb = 0;
+
+	switch(size){
+	case sizeof(int):
+		la = *(int*)a;
+		lb = *(int*)b;
+		break;
+	case sizeof(char):
+		la = *(char*)a;
+		lb = *(char*)b;
+		break;
+	case sizeof(long):
+		la = *(long*)a;
+		lb = *(long*)b;
+		break;
+	}
+	return (la > lb) - (la < lb);
+}
@@ -17,18 +17,58 @@
  * For more information, please refer to <http://unlicense.org/>
  */
 
+#include <ctype.h>
 #include "dict.h"
 
 #define UNUSED(X) ((void)X)
 
+/*
+ * arguments of dict_range_pair: the function called for each
+ * key and, for dict_foreach_prefix, the prefix of the keys
+ */
+typedef struct dict_range_t {
+	dict_range_function function;
+	void* arg;
+
+	const char* prefix;
+	size_t prefix_len;
+	int (*strncomprfunction)(const char*, const char*, size_t);
+} dict_range_t;
+
 int compare_string_function(void* a, void* b, void* arg);
-void dict_free_node(redblacknode_t* node);
+int compare_hashed_string_function(void* a, void* b, void* arg);
+static size_t dict_hash_function(void* key, size_t size, void* arg);
+static void dict_key_init(dict_t* d, const char* str, dict_key_t* key);
+static size_t dict_hash_folded(const char* str, size_t* len);
+static const char* dict_key_bytes(const dict_key_t* key);
+static char* dict_arena_alloc(dict_t* d, size_t size);
+static void dict_arena_free(dict_t* d);
+static char* dict_store_key(dict_t* d, dict_key_t* key, int* owned);
+static int compare_interned_function(void* a, void* b, void* arg);
+static int dict_range_pair(void* key, void* elem, void* arg);
 
 /** Creates a dict and populates the structure `d`.
-  * TODO: A more datailed description of dict_create.
+  * The keys are kept in a red-black tree, in the order given by
+  * strcmp or, with G_DICT_CASE_INSENSITIVE, by strcasecmp.
+  * With G_DICT_HASH they are kept in a hash table instead: each
+  * key is stored with its length and hash, so a lookup hashes the
+  * string once and compares the bytes only of keys with the same
+  * hash and length. In case insensitive mode the hash is taken
+  * over the lower case bytes.
+  *
+  * Keys shorter than DICT_INLINE_KEY are stored inline in the
+  * pairs of the map. The others are copied in a string arena
+  * owned by `d`, in chunks
+  * of DICT_ARENA_CHUNK bytes, and freed all together by
+  * dict_destroy; the bytes of a removed key are reclaimed only
+  * then. With G_DICT_INTERN each distinct string is stored once,
+  * so removing and inserting again the same keys does not grow
+  * the arena.
   *
   * @param d		previous allocated `dict_t` structure
   * @param member_size	size of the member
+  * @param flags	G_DICT_CASE_SENSITIVE or G_DICT_CASE_INSENSITIVE,
+  * 			optionally or'ed with G_DICT_HASH and G_DICT_INTERN
   *
   * @see map_create
   * @see map_set_compare_function
@@ -42,23 +82,40 @@ gerror_t dict_create (struct dict_t* d, size_t member_size, int flags)
 	if(!d) return GERROR_NULL_STRUCTURE;
 
 	d->member_size = member_size;
-	map_create(&d->map, sizeof(char*), d->member_size);
+	d->flags = flags;
+	d->chunks = NULL;
+
+	if(flags & G_DICT_INTERN){
+		hashmap_create(&d->interned, sizeof(dict_key_t), 0);
+		hashmap_set_hash_function(&d->interned, dict_hash_function, NULL);
+		hashmap_set_compare_function(&d->interned, compare_interned_function, NULL);
+	}
 
 	if(flags & G_DICT_CASE_INSENSITIVE)
 		d->strcomprfunction = strcasecmp;
 	else
 		d->strcomprfunction = strcmp;
 
-	map_set_compare_function(
+	if(flags & G_DICT_HASH){
+		map_create_backend(&d->map, sizeof(dict_key_t), d->member_size, G_MAP_HASH);
+		map_set_hash_function(&d->map, dict_hash_function, NULL);
+
+		return map_set_compare_function(
+				&d->map,
+				compare_hashed_string_function,
+				d->strcomprfunction);
+	}
+
+	map_create(&d->map, sizeof(dict_key_t), d->member_size);
+
+	return map_set_compare_function(
 			&d->map,
 			compare_string_function,
 			d->strcomprfunction);
-
-	return GERROR_OK;
 }
 
-/** Deallocates and cleanup the `dict_t` structure.
-  * TODO: A more datailed description of dict_destroy.
+/** Deallocates and cleanup the `dict_t` structure. The keys
+  * are freed with the chunks of the string arena.
   *
   * @param d TODO
   *
@@ -72,21 +129,23 @@ gerror_t dict_destroy (struct dict_t* d)
 {
 	if(!d) return GERROR_NULL_STRUCTURE;
 
-	struct redblacknode_t* node = d->map.map.root;
+	dict_arena_free(d);
 
-	dict_free_node(node);
+	if(d->flags & G_DICT_INTERN)
+		hashmap_destroy(&d->interned);
 
 	return map_destroy(&d->map);
 }
 
 /** Inserts the element `elem` and mapped it with `key` in `d`.
-  * TODO: A more datailed description of dict_insert.
+  * If `key` is already in `d` its element is replaced and the
+  * stored key is kept.
   *
   * @param d	previous allocated `dict_t` structure
   * @param key	the string with '\0' terminator to map `elem`
   * @param elem	the element to be mapped
   *
-  * @see map_insert
+  * @see map_emplace
   *
   * @return	GERROR_OK in case of success;
   * 		GERROR_NULL_STRUCTURE in case the structure `d`
@@ -96,18 +155,40 @@ gerror_t dict_insert (struct dict_t* d, const char* key, void* elem)
 {
 	if(!d) return GERROR_NULL_STRUCTURE;
 	if(!key) return GERROR_NULL_KEY;
+	if(!elem) return GERROR_NULL_ELEMENT_POINTER;
+
+	dict_key_t k;
+	dict_key_init(d, key, &k);
+
+	int owned = 0;
+
+	if(k.len >= DICT_INLINE_KEY){
+		char* stored_key = dict_store_key(d, &k, &owned);
+		if(!stored_key) return GERROR_NULL_RETURN_POINTER;
+
+		k.key.str = stored_key;
+	}
+
+	void* value;
+	int inserted;
+	gerror_t g = map_emplace(&d->map, &k, &value, &inserted);
+
+	/*
+	 * the key was already in `d`: the stored copy is kept and
+	 * the new one, the last allocation of the arena, is undone
+	 */
+	if((g != GERROR_OK || !inserted) && owned)
+		d->chunks->used -= k.len+1;
 
-	size_t keylen = strlen(key);
-	size_t alloc_key_siz = keylen+1;
-	char* alloc_key = (char*) malloc(sizeof(char)*alloc_key_siz);
+	if(g == GERROR_OK)
+		memcpy(value, elem, d->member_size);
 
-	strncpy(alloc_key, key, alloc_key_siz);
-	return map_insert(&d->map, &alloc_key, elem);
+	return g;
 }
 
 /** Removes the elem mapped by `key` and write in the memory location
-  * pointed by `elem` if is different of null.
-  * TODO: A more datailed description of dict_remove.
+  * pointed by `elem` if is different of null. The bytes of the key
+  * stay in the string arena until `d` is destroyed.
   *
   * @param d	previous allocated `dict_t` structure
   * @param key	pointer to the key
@@ -117,21 +198,17 @@ gerror_t dict_insert (struct dict_t* d, const char* key, void* elem)
   * @return	GERROR_OK in case of success;
   * 		GERROR_NULL_STRUCTURE in case the structure `d`
   * 		GERROR_NULL_KEY in case that `key` is null
+  * 		GERROR_ELEMENT_NOT_FOUNDED in case `key` is not in `d`
   */
 gerror_t dict_remove (struct dict_t* d, const char* key, void* elem)
 {
 	if(!d) return GERROR_NULL_STRUCTURE;
 	if(!key) return GERROR_NULL_KEY;
 
-	char* rkey;
-	gerror_t g = map_get_pair(&d->map, &key, &rkey, elem);
+	dict_key_t k;
+	dict_key_init(d, key, &k);
 
-	if(g != GERROR_OK)
-		return g;
-
-	free(rkey);
-
-	return GERROR_OK;
+	return map_remove(&d->map, &k, elem);
 }
 
 /** Find the element pointed by `key` and writes in the memory location
@@ -153,25 +230,301 @@ gerror_t dict_at (struct dict_t* d, const char* key, void* elem)
 	if(!d) return GERROR_NULL_STRUCTURE;
 	if(!key) return GERROR_NULL_KEY;
 
-	return map_at(&d->map, &key, elem);
+	dict_key_t k;
+	dict_key_init(d, key, &k);
+
+	return map_at(&d->map, &k, elem);
+}
+
+/** Writes in `elem` a pointer to the element mapped by `key`,
+  * stored in `d`, without copying it. The element can be changed
+  * in place through the pointer, which is aligned for the element
+  * type if its alignment is at most that of galign_t.
+  *
+  * The pointer is borrowed from `d`. In tree mode it is valid until
+  * `key` is removed or `d` is destroyed, since the nodes are never
+  * moved; with G_DICT_HASH only until the next insert or remove in
+  * `d`, which may move the slots of the hash table.
+  *
+  * @param d	previous allocated `dict_t` structure
+  * @param key	pointer to the key
+  * @param elem	pointer to write the pointer to the element
+  *
+  * @see map_find_ptr
+  *
+  * @return	GERROR_OK in case of success;
+  * 		GERROR_NULL_STRUCTURE in case the structure `d`
+  * 		GERROR_NULL_KEY in case that `key` is null
+  * 		GERROR_ELEMENT_NOT_FOUNDED in case `key` is not in `d`
+  */
+gerror_t dict_find_ptr (struct dict_t* d, const char* key, void** elem)
+{
+	if(!d) return GERROR_NULL_STRUCTURE;
+	if(!key) return GERROR_NULL_KEY;
+
+	dict_key_t k;
+	dict_key_init(d, key, &k);
+
+	return map_find_ptr(&d->map, &k, elem);
+}
+
+/** Calls `function` for each key of `d` in [`lo`, `hi`), in the
+  * order of the dict, so case insensitive with
+  * G_DICT_CASE_INSENSITIVE. The scan is O(log n + k) and does
+  * not allocate. `d` must not be modified by `function`.
+  *
+  * @param d		previous allocated `dict_t` structure
+  * @param lo		the smallest key of the range or NULL to start
+  * 			at the first key
+  * @param hi		the key ending the range (not included) or NULL
+  * 			to go until the last key
+  * @param function	function called for each key; a non zero
+  * 			return stops the iteration
+  * @param arg		argument passed to `function`
+  *
+  * @see map_range
+  *
+  * @return	GERROR_OK in case of success;
+  * 		GERROR_NULL_STRUCTURE in case the structure `d`
+  * 		is pointed to null
+  * 		GERROR_NULL_ELEMENT_POINTER in case that `function` is null
+  * 		GERROR_UNSUPPORTED_OPERATION in case of G_DICT_HASH
+  */
+gerror_t dict_range (
+		struct dict_t* d,
+		const char* lo,
+		const char* hi,
+		dict_range_function function,
+		void* arg)
+{
+	if(!d) return GERROR_NULL_STRUCTURE;
+	if(!function) return GERROR_NULL_ELEMENT_POINTER;
+
+	dict_key_t klo, khi;
+	dict_range_t range;
+
+	range.function = function;
+	range.arg = arg;
+	range.prefix = NULL;
+
+	if(lo)
+		dict_key_init(d, lo, &klo);
+	if(hi)
+		dict_key_init(d, hi, &khi);
+
+	return map_range(
+			&d->map,
+			lo ? &klo : NULL,
+			hi ? &khi : NULL,
+			dict_range_pair,
+			&range);
+}
+
+/** Calls `function` for each key of `d` starting with `prefix`,
+  * in the order of the dict; with G_DICT_CASE_INSENSITIVE the
+  * case of the prefix is ignored. The keys with a prefix are
+  * contiguous, so the scan starts at the first of them and stops
+  * after the last one, in O(log n + k), and does not allocate.
+  * `d` must not be modified by `function`.
+  *
+  * Example, the completions of "net.":
+  *	dict_foreach_prefix(&d, "net.", print_key, NULL);
+  *
+  * @param d		previous allocated `dict_t` structure
+  * @param prefix	the prefix of the keys; "" for all of them
+  * @param function	function called for each key; a non zero
+  * 			return stops the iteration
+  * @param arg		argument passed to `function`
+  *
+  * @see dict_range
+  *
+  * @return	GERROR_OK in case of success;
+  * 		GERROR_NULL_STRUCTURE in case the structure `d`
+  * 		is pointed to null
+  * 		GERROR_NULL_KEY in case that `prefix` is null
+  * 		GERROR_NULL_ELEMENT_POINTER in case that `function` is null
+  * 		GERROR_UNSUPPORTED_OPERATION in case of G_DICT_HASH
+  */
+gerror_t dict_foreach_prefix (
+		struct dict_t* d,
+		const char* prefix,
+		dict_range_function function,
+		void* arg)
+{
+	if(!d) return GERROR_NULL_STRUCTURE;
+	if(!prefix) return GERROR_NULL_KEY;
+	if(!function) return GERROR_NULL_ELEMENT_POINTER;
+
+	dict_key_t klo;
+	dict_range_t range;
+
+	range.function = function;
+	range.arg = arg;
+	range.prefix = prefix;
+
+	if(d->flags & G_DICT_CASE_INSENSITIVE)
+		range.strncomprfunction = strncasecmp;
+	else
+		range.strncomprfunction = strncmp;
+
+	dict_key_init(d, prefix, &klo);
+	range.prefix_len = klo.len;
+
+	return map_range(&d->map, &klo, NULL, dict_range_pair, &range);
 }
 
 
 /*
- * recursively frees the node data `node`
+ * auxiliar function to fill the key `key` of the string `str`;
+ * the hash is only computed in G_DICT_HASH mode and, in case
+ * insensitive mode, over the lower case bytes. A short string is
+ * copied inline, so the key can be compared with the stored ones
  */
-void dict_free_node(redblacknode_t* node)
+static void dict_key_init(dict_t* d, const char* str, dict_key_t* key)
 {
-	if(node != NULL){
-		dict_free_node(node->left);
-		dict_free_node(node->right);
-		char* str;
+	key->key.str = str;
+	key->hash = 0;
+
+	if(!(d->flags & G_DICT_HASH)){
+		key->len = strlen(str);
+	}else if(!(d->flags & G_DICT_CASE_INSENSITIVE)){
+		key->len = strlen(str);
+		key->hash = hashmap_default_hash_function((void*) str, key->len, NULL);
+	}else{
+		key->hash = dict_hash_folded(str, &key->len);
+	}
+
+	if(key->len < DICT_INLINE_KEY)
+		memcpy(key->key.buf, str, key->len+1);
+}
+
+/*
+ * auxiliar function to hash the lower case bytes of `str`,
+ * with FNV-1a and a final mix since the hashmap uses the low
+ * and the high bits; writes the length of `str` in `len`
+ */
+static size_t dict_hash_folded(const char* str, size_t* len)
+{
+	const unsigned char* p = (const unsigned char*) str;
+	size_t h = (size_t) 2166136261u;
+
+	for(; *p; p++)
+		h = (h ^ (size_t) tolower(*p))*16777619u;
+
+	h ^= h >> 15;
+	h *= (size_t) 0x2C1B3C6Du;
+	h ^= h >> 12;
+
+	*len = (const char*) p - str;
+
+	return h;
+}
+
+/*
+ * auxiliar function to get the string of `key`; a short string
+ * is stored in the key itself and is compared where it is
+ */
+static const char* dict_key_bytes(const dict_key_t* key)
+{
+	return key->len < DICT_INLINE_KEY ? key->key.buf : key->key.str;
+}
+
+/*
+ * auxiliar function to use the hash stored in the key
+ */
+static size_t dict_hash_function(void* key, size_t size, void* arg)
+{
+	UNUSED(size);
+	UNUSED(arg);
+
+	return ((dict_key_t*) key)->hash;
+}
+
+/*
+ * auxiliar function to take `size` bytes of the string arena
+ * of `d`; they are always taken from the first chunk, so the
+ * last allocation can be undone by decreasing its `used`
+ */
+static char* dict_arena_alloc(dict_t* d, size_t size)
+{
+	dict_chunk_t* chunk = d->chunks;
+
+	if(!chunk || chunk->size - chunk->used < size){
+		size_t chunk_size = size > DICT_ARENA_CHUNK ? size : DICT_ARENA_CHUNK;
+
+		chunk = (dict_chunk_t*) malloc(sizeof(dict_chunk_t) + chunk_size);
+		if(!chunk)
+			return NULL;
+
+		chunk->next = d->chunks;
+		chunk->size = chunk_size;
+		chunk->used = 0;
+		d->chunks = chunk;
+	}
+
+	char* p = (char*)(chunk + 1) + chunk->used;
+	chunk->used += size;
+
+	return p;
+}
+
+/*
+ * auxiliar function to free the chunks of the string arena
+ */
+static void dict_arena_free(dict_t* d)
+{
+	while(d->chunks){
+		dict_chunk_t* next = d->chunks->next;
+		free(d->chunks);
+		d->chunks = next;
+	}
+}
+
+/*
+ * auxiliar function to get a copy of the string of `key` in the
+ * arena; `owned` is set to 1 if the copy is the last allocation
+ * of the arena and 0 if it is a string interned before
+ */
+static char* dict_store_key(dict_t* d, dict_key_t* key, int* owned)
+{
+	dict_key_t ikey;
+
+	*owned = 1;
+
+	if(d->flags & G_DICT_INTERN){
+		/*
+		 * the strings are interned by their bytes, also in
+		 * case insensitive mode, so they are hashed again
+		 * if the key hash is not the hash of the bytes
+		 */
+		ikey = *key;
+		if((d->flags & (G_DICT_HASH | G_DICT_CASE_INSENSITIVE)) != G_DICT_HASH)
+			ikey.hash = hashmap_default_hash_function((void*) key->key.str, key->len, NULL);
+
+		dict_key_t found;
+		if(hashmap_get_pair(&d->interned, &ikey, &found, NULL) == GERROR_OK){
+			*owned = 0;
+			return (char*) found.key.str;
+		}
+	}
+
+	char* str = dict_arena_alloc(d, key->len+1);
+	if(!str)
+		return NULL;
+
+	memcpy(str, key->key.str, key->len+1);
 
-		memcpy(&str, node->data, sizeof(char*));
+	if(d->flags & G_DICT_INTERN){
+		ikey.key.str = str;
+		hashmap_insert(&d->interned, &ikey, NULL);
 
-		if(str)
-			free(str);
+		/*
+		 * an interned string is never taken back
+		 */
+		*owned = 0;
 	}
+
+	return str;
 }
 
 /*
@@ -182,10 +535,7 @@ int compare_string_function(void* a, void* b, void* arg)
 
 	int (*strcompare)(const char*, const char*) = arg;
 
-	char* a_str = *(char**)a;
-	char* b_str = *(char**)b;
-
-	int r = strcompare(a_str, b_str);
+	int r = strcompare(dict_key_bytes(a), dict_key_bytes(b));
 	rbcomp_t result;
 
 	if(r < 0)
@@ -197,3 +547,61 @@ int compare_string_function(void* a, void* b, void* arg)
 
 	return result;
 }
+
+/*
+ * compare function of the dict in G_DICT_HASH mode; only the
+ * equality is used, so the bytes are compared only if the hashes
+ * and the lengths are equal
+ */
+int compare_hashed_string_function(void* a, void* b, void* arg)
+{
+	int (*strcompare)(const char*, const char*) = arg;
+
+	dict_key_t* ka = (dict_key_t*) a;
+	dict_key_t* kb = (dict_key_t*) b;
+
+	if(ka->hash != kb->hash || ka->len != kb->len)
+		return G_RB_FIRST_IS_SMALLER;
+
+	/*
+	 * interned strings are equal if they are the same
+	 */
+	if(ka->len >= DICT_INLINE_KEY && ka->key.str == kb->key.str)
+		return G_RB_EQUAL;
+
+	return strcompare(dict_key_bytes(ka), dict_key_bytes(kb)) == 0 ?
+		G_RB_EQUAL : G_RB_FIRST_IS_SMALLER;
+}
+
+/*
+ * compare function of the interned strings, by their bytes
+ */
+static int compare_interned_function(void* a, void* b, void* arg)
+{
+	UNUSED(arg);
+
+	dict_key_t* ka = (dict_key_t*) a;
+	dict_key_t* kb = (dict_key_t*) b;
+
+	if(ka->hash != kb->hash || ka->len != kb->len)
+		return G_RB_FIRST_IS_SMALLER;
+
+	return memcmp(ka->key.str, kb->key.str, ka->len) == 0 ? G_RB_EQUAL : G_RB_FIRST_IS_SMALLER;
+}
+
+/*
+ * auxiliar function to call the function of a dict_range or
+ * dict_foreach_prefix with the string of the key; stops at the
+ * first key without the prefix
+ */
+static int dict_range_pair(void* key, void* elem, void* arg)
+{
+	dict_range_t* range = (dict_range_t*) arg;
+	const char* str = dict_key_bytes(key);
+
+	if(range->prefix &&
+			range->strncomprfunction(str, range->prefix, range->prefix_len) != 0)
+		return 1;
+
+	return range->function(str, elem, range->arg);
+}
@@ -0,0 +1,233 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ */
+#include "epoch.h"
+
+/** Populates the structure `e` with room for `nslots` threads
+  * running critical sections at the same time.
+  *
+  * @param e		pointer to the structure;
+  * @param nslots	maximum number of registered threads.
+  *
+  * @return	GERROR_OK in case of success operation;
+  * 		GERROR_NULL_STRUCURE in case `e` is a NULL
+  */
+gerror_t epoch_create (struct epoch_t* e, size_t nslots)
+{
+	if(!e) return GERROR_NULL_STRUCTURE;
+
+	e->global = 1;
+	e->nslots = nslots;
+	e->slots = (struct epoch_slot_t*) calloc(nslots ? nslots : 1, sizeof(struct epoch_slot_t));
+	e->retired = NULL;
+	e->nretired = 0;
+	pthread_mutex_init(&e->lock, NULL);
+
+	return GERROR_OK;
+}
+
+/** Frees every retired pointer and the inner attributes of `e`.
+  * No thread can be inside a critical section.
+  *
+  * @param e	pointer to the structure.
+  *
+  * @return	GERROR_OK in case of success operation;
+  * 		GERROR_NULL_STRUCURE in case `e` is a NULL
+  */
+gerror_t epoch_destroy (struct epoch_t* e)
+{
+	if(!e) return GERROR_NULL_STRUCTURE;
+
+	while(e->retired){
+		struct epoch_retired_t* next = e->retired->next;
+		free(e->retired->ptr);
+		free(e->retired);
+		e->retired = next;
+	}
+
+	free(e->slots);
+	pthread_mutex_destroy(&e->lock);
+
+	e->slots = NULL;
+	e->nslots = 0;
+	e->nretired = 0;
+
+	return GERROR_OK;
+}
+
+/** Registers the calling thread and writes its slot in `slot`.
+  *
+  * @param e	pointer to the structure;
+  * @param slot	pointer to the returned slot.
+  *
+  * @return	GERROR_OK in case of success operation;
+  * 		GERROR_NULL_STRUCURE in case `e` is a NULL;
+  * 		GERROR_NULL_RETURN_POINTER in case `slot` is NULL;
+  * 		GERROR_FULL_STRUCTURE in case every slot is in use
+  */
+gerror_t epoch_register (struct epoch_t* e, size_t* slot)
+{
+	if(!e) return GERROR_NULL_STRUCTURE;
+	if(!slot) return GERROR_NULL_RETURN_POINTER;
+
+	size_t i;
+	for(i=0; i<e->nslots; i++){
+		int expected = 0;
+		if(__atomic_compare_exchange_n(
+				&e->slots[i].used,
+				&expected,
+				1,
+				0,
+				__ATOMIC_ACQ_REL,
+				__ATOMIC_RELAXED)){
+			*slot = i;
+			return GERROR_OK;
+		}
+	}
+
+	return GERROR_FULL_STRUCTURE;
+}
+
+/** Releases the slot `slot`, so other thread can register.
+  *
+  * @param e	pointer to the structure;
+  * @param slot	slot returned by `epoch_register`.
+  *
+  * @return	GERROR_OK in case of success operation;
+  * 		GERROR_NULL_STRUCURE in case `e` is a NULL;
+  * 		GERROR_ACCESS_OUT_OF_BOUND in case `slot` is invalid
+  */
+gerror_t epoch_unregister (struct epoch_t* e, size_t slot)
+{
+	if(!e) return GERROR_NULL_STRUCTURE;
+	if(slot >= e->nslots) return GERROR_ACCESS_OUT_OF_BOUND;
+
+	__atomic_store_n(&e->slots[slot].epoch, 0, __ATOMIC_RELEASE);
+	__atomic_store_n(&e->slots[slot].used, 0, __ATOMIC_RELEASE);
+
+	return GERROR_OK;
+}
+
+/** Starts a critical section of the thread registered in `slot`.
+  * The pointers read inside the critical section are valid until
+  * `epoch_leave`.
+  */
+void epoch_enter (struct epoch_t* e, size_t slot)
+{
+	unsigned long g = __atomic_load_n(&e->global, __ATOMIC_ACQUIRE);
+
+	/*
+	 * the announcement has to be visible before any pointer
+	 * is read, so a sequentially consistent store is used
+	 */
+	__atomic_store_n(&e->slots[slot].epoch, g, __ATOMIC_SEQ_CST);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+/** Ends the critical section of the thread registered in `slot`.
+  */
+void epoch_leave (struct epoch_t* e, size_t slot)
+{
+	__atomic_store_n(&e->slots[slot].epoch, 0, __ATOMIC_RELEASE);
+}
+
+/*
+ * auxiliar function;
+ * frees the retired pointers that no reader can see;
+ * the lock has to be held
+ */
+static void epoch_reclaim_locked (struct epoch_t* e)
+{
+	unsigned long min = (unsigned long)-1;
+	size_t i;
+
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+	for(i=0; i<e->nslots; i++){
+		unsigned long epoch = __atomic_load_n(&e->slots[i].epoch, __ATOMIC_SEQ_CST);
+		if(epoch && epoch < min)
+			min = epoch;
+	}
+
+	/*
+	 * a pointer retired in the epoch `r` can be seen only by
+	 * the readers that entered in an epoch less or equal to `r`
+	 */
+	struct epoch_retired_t** it = &e->retired;
+	while(*it){
+		struct epoch_retired_t* r = *it;
+		if(r->epoch < min){
+			*it = r->next;
+			free(r->ptr);
+			free(r);
+			e->nretired--;
+		}else{
+			it = &r->next;
+		}
+	}
+}
+
+/** Retires `ptr`, which was already unlinked from the shared structure.
+  * `ptr` is freed when no reader can see it anymore.
+  *
+  * @param e	pointer to the structure;
+  * @param ptr	pointer allocated by malloc.
+  *
+  * @return	GERROR_OK in case of success operation;
+  * 		GERROR_NULL_STRUCURE in case `e` is a NULL
+  */
+gerror_t epoch_retire (struct epoch_t* e, void* ptr)
+{
+	if(!e) return GERROR_NULL_STRUCTURE;
+	if(!ptr) return GERROR_OK;
+
+	struct epoch_retired_t* r = (struct epoch_retired_t*) malloc(sizeof(struct epoch_retired_t));
+
+	pthread_mutex_lock(&e->lock);
+
+	r->ptr = ptr;
+	r->epoch = __atomic_fetch_add(&e->global, 1, __ATOMIC_SEQ_CST);
+	r->next = e->retired;
+	e->retired = r;
+	e->nretired++;
+
+	if(e->nretired >= EPOCH_RETIRE_THRESHOLD)
+		epoch_reclaim_locked(e);
+
+	pthread_mutex_unlock(&e->lock);
+
+	return GERROR_OK;
+}
+
+/** Frees every retired pointer that no reader can see.
+  *
+  * @param e	pointer to the structure.
+  *
+  * @return	GERROR_OK in case of success operation;
+  * 		GERROR_NULL_STRUCURE in case `e` is a NULL
+  */
+gerror_t epoch_reclaim (struct epoch_t* e)
+{
+	if(!e) return GERROR_NULL_STRUCTURE;
+
+	pthread_mutex_lock(&e->lock);
+	epoch_reclaim_locked(e);
+	pthread_mutex_unlock(&e->lock);
+
+	return GERROR_OK;
+}
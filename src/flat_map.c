@@ -0,0 +1,757 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ */
+#include "flat_map.h"
+
+#define FLAT_MAP_NONE ((size_t) -1)
+
+#define FLAT_MAP_KEY(fm, i) ((char*) (fm)->keys.data + (i)*(fm)->key_size)
+#define FLAT_MAP_ELEM(fm, i) ((char*) (fm)->elems.data + (i)*(fm)->member_size)
+
+/*
+ * auxiliar function prototypes
+ */
+static void flat_map_reserve(flat_map_t* fm, size_t n);
+static size_t flat_map_lower_bound(flat_map_t* fm, void* key, int* equal);
+static size_t flat_map_eytzinger_search(flat_map_t* fm, void* key, int* equal);
+static size_t flat_map_find(flat_map_t* fm, void* key);
+static void flat_map_merge_sort(flat_map_t* fm, size_t* idx, size_t* tmp, size_t n);
+static size_t flat_map_eytzinger_copy(	flat_map_t* fm,
+					char* keys,
+					char* elems,
+					size_t i,
+					size_t k,
+					int freeze);
+static int flat_map_eytzinger_foreach(	flat_map_t* fm,
+					size_t k,
+					flat_map_foreach_function function,
+					void* arg);
+
+/** Creates a flat map of keys with size `key_size` mapped to
+  * elements with size `member_size` and populates the previous
+  * allocated structure `fm`. The pairs are stored in two vector_t,
+  * without a node per pair, which suits small maps and maps built
+  * once and read many times.
+  * The default compare function only works for char, int and long
+  * keys; see flat_map_set_compare_function.
+  *
+  * @param fm		pointer to a previous allocated `flat_map_t` structure;
+  * @param key_size	size of the keys in bytes
+  * @param member_size	size of the elements in bytes
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `fm` is null
+  */
+gerror_t flat_map_create (struct flat_map_t* fm, size_t key_size, size_t member_size)
+{
+	if(!fm) return GERROR_NULL_STRUCTURE;
+
+	fm->key_size = key_size;
+	fm->member_size = member_size;
+	fm->sorted = 0;
+	fm->frozen = 0;
+
+	fm->compare = flat_map_default_compare_function;
+	fm->compare_argument = &(fm->key_size);
+
+	vector_create(&fm->keys, 0, key_size);
+	vector_create(&fm->elems, 0, member_size);
+
+	return GERROR_OK;
+}
+
+/** Destroys and deallocates the arrays of `fm`.
+  *
+  * @param fm	pointer to a previous allocated `flat_map_t` structure;
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `fm` is null
+  */
+gerror_t flat_map_destroy (struct flat_map_t* fm)
+{
+	if(!fm) return GERROR_NULL_STRUCTURE;
+
+	vector_destroy(&fm->keys);
+	vector_destroy(&fm->elems);
+
+	fm->sorted = 0;
+	fm->frozen = 0;
+	fm->compare = NULL;
+	fm->compare_argument = NULL;
+
+	return GERROR_OK;
+}
+
+/** Change the compare function of the keys of `fm` for `function`
+  * with the argument `argument`. It must be set while `fm` is empty.
+  *
+  * @param fm		pointer to a previous allocated `flat_map_t` structure;
+  * @param function	comparison function of the keys
+  * @param argument	pointer to the argument to the comparison function
+  *
+  * @see rbtree_set_compare_function
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `fm` is null
+  */
+gerror_t flat_map_set_compare_function(
+		struct flat_map_t* fm,
+		flat_map_compare_function function,
+		void* argument)
+{
+	if(!fm) return GERROR_NULL_STRUCTURE;
+
+	fm->compare = function;
+	fm->compare_argument = argument;
+
+	return GERROR_OK;
+}
+
+/** Inserts the element `elem` at the key `key` in `fm`; if the
+  * key is already in `fm` its element is overwritten. The following
+  * pairs are moved, so the insert is O(n): many pairs are better
+  * added with flat_map_push and flat_map_sort.
+  *
+  * @param fm	pointer to a previous allocated `flat_map_t` structure;
+  * @param key	pointer to the key
+  * @param elem	pointer to the element to be copied or NULL
+  * 		to store a zeroed element
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `fm` is null
+  * 		GERROR_NULL_KEY in case that `key` is null
+  * 		GERROR_UNSUPPORTED_OPERATION in case `fm` is frozen
+  */
+gerror_t flat_map_insert (struct flat_map_t* fm, void* key, void* elem)
+{
+	if(!fm) return GERROR_NULL_STRUCTURE;
+	if(!key) return GERROR_NULL_KEY;
+	if(fm->frozen) return GERROR_UNSUPPORTED_OPERATION;
+
+	flat_map_sort(fm);
+
+	int equal;
+	size_t i = flat_map_lower_bound(fm, key, &equal);
+
+	if(!equal){
+		size_t n = fm->keys.size;
+
+		flat_map_reserve(fm, n + 1);
+
+		memmove(FLAT_MAP_KEY(fm, i + 1), FLAT_MAP_KEY(fm, i), (n - i)*fm->key_size);
+		memmove(FLAT_MAP_ELEM(fm, i + 1), FLAT_MAP_ELEM(fm, i), (n - i)*fm->member_size);
+		memcpy(FLAT_MAP_KEY(fm, i), key, fm->key_size);
+
+		if(!elem)
+			memset(FLAT_MAP_ELEM(fm, i), 0, fm->member_size);
+
+		fm->keys.size++;
+		fm->elems.size++;
+		fm->sorted++;
+	}
+
+	if(elem)
+		memcpy(FLAT_MAP_ELEM(fm, i), elem, fm->member_size);
+
+	return GERROR_OK;
+}
+
+/** Appends the element `elem` at the key `key` to `fm` in O(1),
+  * without keeping the order: the pushed pairs are sorted and
+  * merged with the others by flat_map_sort, which is also called
+  * by the other functions of `fm`. If a key is pushed more than
+  * once, the last element pushed is kept.
+  *
+  * @param fm	pointer to a previous allocated `flat_map_t` structure;
+  * @param key	pointer to the key
+  * @param elem	pointer to the element to be copied or NULL
+  * 		to store a zeroed element
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `fm` is null
+  * 		GERROR_NULL_KEY in case that `key` is null
+  * 		GERROR_UNSUPPORTED_OPERATION in case `fm` is frozen
+  */
+gerror_t flat_map_push (struct flat_map_t* fm, void* key, void* elem)
+{
+	if(!fm) return GERROR_NULL_STRUCTURE;
+	if(!key) return GERROR_NULL_KEY;
+	if(fm->frozen) return GERROR_UNSUPPORTED_OPERATION;
+
+	size_t n = fm->keys.size;
+
+	flat_map_reserve(fm, n + 1);
+
+	memcpy(FLAT_MAP_KEY(fm, n), key, fm->key_size);
+
+	if(elem)
+		memcpy(FLAT_MAP_ELEM(fm, n), elem, fm->member_size);
+	else
+		memset(FLAT_MAP_ELEM(fm, n), 0, fm->member_size);
+
+	fm->keys.size++;
+	fm->elems.size++;
+
+	return GERROR_OK;
+}
+
+/** Sorts the pairs pushed by flat_map_push and merges them with
+  * the sorted pairs of `fm`, in O(m log m + n) for `m` pushed pairs.
+  * The sort is stable, so of the pairs with equal keys the last
+  * one pushed is kept.
+  *
+  * @param fm	pointer to a previous allocated `flat_map_t` structure;
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `fm` is null
+  */
+gerror_t flat_map_sort (struct flat_map_t* fm)
+{
+	if(!fm) return GERROR_NULL_STRUCTURE;
+	if(fm->sorted == fm->keys.size) return GERROR_OK;
+
+	size_t n = fm->keys.size;
+	size_t m = fm->sorted;
+	size_t i, j, k;
+
+	size_t* idx = (size_t*) malloc(2*n*sizeof(size_t));
+	size_t* tmp = idx + n;
+
+	for(i = 0; i < n; i++)
+		idx[i] = i;
+
+	flat_map_merge_sort(fm, idx + m, tmp, n - m);
+
+	/*
+	 * merges the sorted pairs and the pushed ones; on equal
+	 * keys the sorted pair goes first, so the pushed one wins
+	 */
+	i = 0;
+	j = m;
+	k = 0;
+	while(i < m && j < n){
+		if(fm->compare(FLAT_MAP_KEY(fm, idx[j]), FLAT_MAP_KEY(fm, idx[i]), fm->compare_argument) < 0)
+			tmp[k++] = idx[j++];
+		else
+			tmp[k++] = idx[i++];
+	}
+	while(i < m)
+		tmp[k++] = idx[i++];
+	while(j < n)
+		tmp[k++] = idx[j++];
+
+	vector_t keys;
+	vector_t elems;
+
+	vector_create(&keys, n, fm->key_size);
+	vector_create(&elems, n, fm->member_size);
+
+	for(i = 0, k = 0; i < n; i++){
+		/*
+		 * of a run of equal keys only the last pair is kept
+		 */
+		if(i + 1 < n && fm->compare(	FLAT_MAP_KEY(fm, tmp[i]),
+						FLAT_MAP_KEY(fm, tmp[i + 1]),
+						fm->compare_argument) == 0)
+			continue;
+
+		memcpy((char*) keys.data + k*fm->key_size, FLAT_MAP_KEY(fm, tmp[i]), fm->key_size);
+		memcpy((char*) elems.data + k*fm->member_size, FLAT_MAP_ELEM(fm, tmp[i]), fm->member_size);
+		k++;
+	}
+
+	keys.size = k;
+	elems.size = k;
+
+	vector_destroy(&fm->keys);
+	vector_destroy(&fm->elems);
+
+	fm->keys = keys;
+	fm->elems = elems;
+	fm->sorted = k;
+
+	free(idx);
+
+	return GERROR_OK;
+}
+
+/** Removes the key `key` of `fm` and writes its element in `elem`.
+  * The following pairs are moved, so the remove is O(n).
+  *
+  * @param fm	pointer to a previous allocated `flat_map_t` structure;
+  * @param key	pointer to the key
+  * @param elem	pointer to a location of memory where the element
+  * 		will be written or NULL
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `fm` is null
+  * 		GERROR_NULL_KEY in case that `key` is null
+  * 		GERROR_UNSUPPORTED_OPERATION in case `fm` is frozen
+  * 		GERROR_ELEMENT_NOT_FOUNDED in case `key` is not in `fm`
+  */
+gerror_t flat_map_remove (struct flat_map_t* fm, void* key, void* elem)
+{
+	if(!fm) return GERROR_NULL_STRUCTURE;
+	if(!key) return GERROR_NULL_KEY;
+	if(fm->frozen) return GERROR_UNSUPPORTED_OPERATION;
+
+	flat_map_sort(fm);
+
+	int equal;
+	size_t i = flat_map_lower_bound(fm, key, &equal);
+	size_t n = fm->keys.size;
+
+	if(!equal)
+		return GERROR_ELEMENT_NOT_FOUNDED;
+
+	if(elem)
+		memcpy(elem, FLAT_MAP_ELEM(fm, i), fm->member_size);
+
+	memmove(FLAT_MAP_KEY(fm, i), FLAT_MAP_KEY(fm, i + 1), (n - i - 1)*fm->key_size);
+	memmove(FLAT_MAP_ELEM(fm, i), FLAT_MAP_ELEM(fm, i + 1), (n - i - 1)*fm->member_size);
+
+	fm->keys.size--;
+	fm->elems.size--;
+	fm->sorted--;
+
+	return GERROR_OK;
+}
+
+/** Writes the element at the key `key` in `elem`. O(log n), with
+  * a binary search over the array of keys or, in a frozen map, a
+  * search of the Eytzinger layout that prefetches the keys of the
+  * next levels.
+  *
+  * @param fm	pointer to a previous allocated `flat_map_t` structure;
+  * @param key	pointer to the key
+  * @param elem	pointer to a location of memory where the element
+  * 		will be written or NULL to only check the key
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `fm` is null
+  * 		GERROR_NULL_KEY in case that `key` is null
+  * 		GERROR_ELEMENT_NOT_FOUNDED in case `key` is not in `fm`
+  */
+gerror_t flat_map_at (struct flat_map_t* fm, void* key, void* elem)
+{
+	if(!fm) return GERROR_NULL_STRUCTURE;
+	if(!key) return GERROR_NULL_KEY;
+
+	size_t i = flat_map_find(fm, key);
+
+	if(i == FLAT_MAP_NONE)
+		return GERROR_ELEMENT_NOT_FOUNDED;
+
+	if(elem)
+		memcpy(elem, FLAT_MAP_ELEM(fm, i), fm->member_size);
+
+	return GERROR_OK;
+}
+
+/** Writes in `elem` a pointer to the element at the key `key`,
+  * stored in the array of elements of `fm`, without copying it.
+  * The element can be changed in place; the pointer is valid until
+  * the next insert, push, remove, sort, freeze or thaw of `fm`,
+  * which may move the pairs.
+  *
+  * @param fm	pointer to a previous allocated `flat_map_t` structure;
+  * @param key	pointer to the key
+  * @param elem	pointer to write the pointer to the element
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `fm` is null
+  * 		GERROR_NULL_KEY in case that `key` is null
+  * 		GERROR_NULL_RETURN_POINTER in case `elem` is null
+  * 		GERROR_ELEMENT_NOT_FOUNDED in case `key` is not in `fm`;
+  * 		`*elem` is set to NULL
+  */
+gerror_t flat_map_find_ptr (struct flat_map_t* fm, void* key, void** elem)
+{
+	if(!fm) return GERROR_NULL_STRUCTURE;
+	if(!key) return GERROR_NULL_KEY;
+	if(!elem) return GERROR_NULL_RETURN_POINTER;
+
+	size_t i = flat_map_find(fm, key);
+
+	if(i == FLAT_MAP_NONE){
+		*elem = NULL;
+		return GERROR_ELEMENT_NOT_FOUNDED;
+	}
+
+	*elem = FLAT_MAP_ELEM(fm, i);
+
+	return GERROR_OK;
+}
+
+/** Calls `function` for each pair of `fm` in key order.
+  * The map must not be modified by `function`.
+  *
+  * @param fm		pointer to a previous allocated `flat_map_t` structure;
+  * @param function	function called with the key, the element and `arg`
+  * @param arg		argument to `function`
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `fm` is null
+  * 		GERROR_NULL_ELEMENT_POINTER in case that `function` is null
+  */
+gerror_t flat_map_foreach (
+		struct flat_map_t* fm,
+		flat_map_foreach_function function,
+		void* arg)
+{
+	if(!fm) return GERROR_NULL_STRUCTURE;
+	if(!function) return GERROR_NULL_ELEMENT_POINTER;
+
+	flat_map_sort(fm);
+
+	if(fm->frozen){
+		flat_map_eytzinger_foreach(fm, 1, function, arg);
+		return GERROR_OK;
+	}
+
+	size_t i;
+	for(i = 0; i < fm->keys.size; i++)
+		if(function(FLAT_MAP_KEY(fm, i), FLAT_MAP_ELEM(fm, i), arg))
+			break;
+
+	return GERROR_OK;
+}
+
+/** Freezes `fm`: its pairs are sorted and laid out in Eytzinger
+  * order, the breadth first order of a complete binary search tree.
+  * The first levels of the tree share a few cache lines and the
+  * search prefetches the keys FLAT_MAP_PREFETCH positions ahead,
+  * so lookups in large maps wait for fewer cache misses than the
+  * binary search. A frozen map can't be changed; see flat_map_thaw.
+  * O(n).
+  *
+  * @param fm	pointer to a previous allocated `flat_map_t` structure;
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `fm` is null
+  */
+gerror_t flat_map_freeze (struct flat_map_t* fm)
+{
+	if(!fm) return GERROR_NULL_STRUCTURE;
+	if(fm->frozen) return GERROR_OK;
+
+	flat_map_sort(fm);
+
+	vector_t keys;
+	vector_t elems;
+	size_t n = fm->keys.size;
+
+	vector_create(&keys, n, fm->key_size);
+	vector_create(&elems, n, fm->member_size);
+
+	flat_map_eytzinger_copy(fm, keys.data, elems.data, 0, 1, 1);
+
+	keys.size = n;
+	elems.size = n;
+
+	vector_destroy(&fm->keys);
+	vector_destroy(&fm->elems);
+
+	fm->keys = keys;
+	fm->elems = elems;
+	fm->frozen = 1;
+
+	return GERROR_OK;
+}
+
+/** Restores the sorted order of the pairs of the frozen `fm`,
+  * which can be changed again. O(n).
+  *
+  * @param fm	pointer to a previous allocated `flat_map_t` structure;
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `fm` is null
+  */
+gerror_t flat_map_thaw (struct flat_map_t* fm)
+{
+	if(!fm) return GERROR_NULL_STRUCTURE;
+	if(!fm->frozen) return GERROR_OK;
+
+	vector_t keys;
+	vector_t elems;
+	size_t n = fm->keys.size;
+
+	vector_create(&keys, n, fm->key_size);
+	vector_create(&elems, n, fm->member_size);
+
+	flat_map_eytzinger_copy(fm, keys.data, elems.data, 0, 1, 0);
+
+	keys.size = n;
+	elems.size = n;
+
+	vector_destroy(&fm->keys);
+	vector_destroy(&fm->elems);
+
+	fm->keys = keys;
+	fm->elems = elems;
+	fm->frozen = 0;
+
+	return GERROR_OK;
+}
+
+/*
+ * default compare function of the keys; `arg` points to the key size
+ */
+int flat_map_default_compare_function(void* a, void* b, void* arg)
+{
+	size_t size = *(size_t*)arg;
+
+	long la = 0;
+	long lb = 0;
+
+	switch(size){
+	case sizeof(int):
+		la = *(int*)a;
+		lb = *(int*)b;
+		break;
+	case sizeof(char):
+		la = *(char*)a;
+		lb = *(char*)b;
+		break;
+	case sizeof(long):
+		la = *(long*)a;
+		lb = *(long*)b;
+		break;
+	}
+	return (la > lb) - (la < lb);
+}
+
+/*
+ * makes room for `n` pairs, at least doubling the arrays
+ */
+static void flat_map_reserve(flat_map_t* fm, size_t n)
+{
+	size_t capacity = 2*fm->keys.size;
+
+	if(capacity < n)
+		capacity = n;
+
+	if(n*fm->key_size > fm->keys.buffer_size)
+		vector_resize_buffer(&fm->keys, capacity);
+	if(n*fm->member_size > fm->elems.buffer_size)
+		vector_resize_buffer(&fm->elems, capacity);
+}
+
+/*
+ * binary search of the sorted keys of type `type` compared
+ * in place, as flat_map_default_compare_function does
+ */
+#define FLAT_MAP_BINARY_SEARCH(fm, key, lo, n, type)				\
+{										\
+	type* keys = (type*) (fm)->keys.data;					\
+	type value = *(type*) (key);						\
+	size_t half;								\
+										\
+	while((n) > 0){								\
+		half = (n)/2;							\
+		if(keys[(lo) + half] < value){					\
+			(lo) += half + 1;					\
+			(n) -= half + 1;					\
+		}else{								\
+			(n) = half;						\
+		}								\
+	}									\
+}
+
+/*
+ * returns the position of the first sorted key not smaller
+ * than `key` and sets `equal` if it is equal to `key`
+ */
+static size_t flat_map_lower_bound(flat_map_t* fm, void* key, int* equal)
+{
+	size_t lo = 0;
+	size_t n = fm->sorted;
+	size_t half;
+
+	if(fm->compare == flat_map_default_compare_function && fm->key_size == sizeof(long)){
+		FLAT_MAP_BINARY_SEARCH(fm, key, lo, n, long);
+	}else if(fm->compare == flat_map_default_compare_function && fm->key_size == sizeof(int)){
+		FLAT_MAP_BINARY_SEARCH(fm, key, lo, n, int);
+	}else{
+		while(n > 0){
+			half = n/2;
+			if(fm->compare(FLAT_MAP_KEY(fm, lo + half), key, fm->compare_argument) < 0){
+				lo += half + 1;
+				n -= half + 1;
+			}else{
+				n = half;
+			}
+		}
+	}
+
+	*equal = lo < fm->sorted
+		&& fm->compare(key, FLAT_MAP_KEY(fm, lo), fm->compare_argument) == 0;
+
+	return lo;
+}
+
+/*
+ * descends the Eytzinger layout of keys of type `type` compared
+ * in place, as flat_map_default_compare_function does
+ */
+#define FLAT_MAP_EYTZINGER_DESCENT(fm, key, k, type)				\
+{										\
+	type* keys = (type*) (fm)->keys.data;					\
+	type value = *(type*) (key);						\
+	size_t n = (fm)->keys.size;						\
+										\
+	while((k) <= n){							\
+		__builtin_prefetch(keys + FLAT_MAP_PREFETCH*(k) - 1);		\
+		(k) = 2*(k) + (keys[(k) - 1] < value);				\
+	}									\
+}
+
+/*
+ * lower bound in the Eytzinger layout: the node `k` (from 1)
+ * is at the position `k - 1` and its children are `2k` and
+ * `2k + 1`; returns the position of the first key not smaller
+ * than `key` and sets `equal` if it is equal to `key`
+ */
+static size_t flat_map_eytzinger_search(flat_map_t* fm, void* key, int* equal)
+{
+	size_t n = fm->keys.size;
+	size_t k = 1;
+
+	/*
+	 * the call of the compare function per level keeps the
+	 * prefetches from paying off, so the keys of the default
+	 * compare function are compared in place, as in
+	 * flat_map_lower_bound
+	 */
+	if(fm->compare == flat_map_default_compare_function && fm->key_size == sizeof(long)){
+		FLAT_MAP_EYTZINGER_DESCENT(fm, key, k, long);
+	}else if(fm->compare == flat_map_default_compare_function && fm->key_size == sizeof(int)){
+		FLAT_MAP_EYTZINGER_DESCENT(fm, key, k, int);
+	}else{
+		while(k <= n){
+			__builtin_prefetch(FLAT_MAP_KEY(fm, FLAT_MAP_PREFETCH*k - 1));
+			k = 2*k + (fm->compare(FLAT_MAP_KEY(fm, k - 1), key, fm->compare_argument) < 0);
+		}
+	}
+
+	/*
+	 * the lower bound is the last node where the search went
+	 * left: the right turns at the end of the path are undone
+	 */
+	while(k & 1)
+		k >>= 1;
+	k >>= 1;
+
+	*equal = k && fm->compare(key, FLAT_MAP_KEY(fm, k - 1), fm->compare_argument) == 0;
+
+	return k - 1;
+}
+
+/*
+ * returns the position of the pair with the key `key`
+ * or FLAT_MAP_NONE
+ */
+static size_t flat_map_find(flat_map_t* fm, void* key)
+{
+	int equal;
+	size_t i;
+
+	flat_map_sort(fm);
+
+	if(fm->frozen)
+		i = flat_map_eytzinger_search(fm, key, &equal);
+	else
+		i = flat_map_lower_bound(fm, key, &equal);
+
+	return equal ? i : FLAT_MAP_NONE;
+}
+
+/*
+ * stable merge sort of the `n` positions of `idx`
+ * by their keys; `tmp` has room for `n` positions
+ */
+static void flat_map_merge_sort(flat_map_t* fm, size_t* idx, size_t* tmp, size_t n)
+{
+	if(n < 2)
+		return;
+
+	size_t h = n/2;
+	size_t i = 0;
+	size_t j = h;
+	size_t k = 0;
+
+	flat_map_merge_sort(fm, idx, tmp, h);
+	flat_map_merge_sort(fm, idx + h, tmp, n - h);
+
+	while(i < h && j < n){
+		if(fm->compare(FLAT_MAP_KEY(fm, idx[j]), FLAT_MAP_KEY(fm, idx[i]), fm->compare_argument) < 0)
+			tmp[k++] = idx[j++];
+		else
+			tmp[k++] = idx[i++];
+	}
+	while(i < h)
+		tmp[k++] = idx[i++];
+	while(j < n)
+		tmp[k++] = idx[j++];
+
+	memcpy(idx, tmp, n*sizeof(size_t));
+}
+
+/*
+ * visits the subtree of the node `k` in order, the `i`-th visited
+ * node being the `i`-th sorted pair; copies the pairs of `fm` to
+ * `keys` and `elems` from the sorted order to the Eytzinger one if
+ * `freeze` is set, or back otherwise. Returns the next `i`
+ */
+static size_t flat_map_eytzinger_copy(	flat_map_t* fm,
+					char* keys,
+					char* elems,
+					size_t i,
+					size_t k,
+					int freeze)
+{
+	if(k > fm->keys.size)
+		return i;
+
+	i = flat_map_eytzinger_copy(fm, keys, elems, i, 2*k, freeze);
+
+	size_t from = freeze ? i : k - 1;
+	size_t to = freeze ? k - 1 : i;
+
+	memcpy(keys + to*fm->key_size, FLAT_MAP_KEY(fm, from), fm->key_size);
+	memcpy(elems + to*fm->member_size, FLAT_MAP_ELEM(fm, from), fm->member_size);
+
+	return flat_map_eytzinger_copy(fm, keys, elems, i + 1, 2*k + 1, freeze);
+}
+
+/*
+ * calls `function` for the pairs of the subtree of the node `k`
+ * of a frozen map, in order; returns non zero if it was stopped
+ */
+static int flat_map_eytzinger_foreach(	flat_map_t* fm,
+					size_t k,
+					flat_map_foreach_function function,
+					void* arg)
+{
+	if(k > fm->keys.size)
+		return 0;
+
+	return flat_map_eytzinger_foreach(fm, 2*k, function, arg)
+		|| function(FLAT_MAP_KEY(fm, k - 1), FLAT_MAP_ELEM(fm, k - 1), arg)
+		|| flat_map_eytzinger_foreach(fm, 2*k + 1, function, arg);
+}
@@ -27,14 +27,19 @@ char* gerror_to_string[GERROR_N_ERROR] = {
 	"Attempt to remove an element but the structure is empty",
 	"Attempt to add a edge with inexistent vertex",
 	"Attempt to access a position out of the container or buffer",
-	"Attempt to append two vectors with different member_size"
+	"Attempt to append two vectors with different member_size",
 	"Null pointer passed to write the return data",
 	"Attempt to pass a empty structure",
 	"Attempt to operate a function with a prohibitive null pointer element",
 	"Attempt to remove an element that is not in the structure",
+	"Element not found",
 	"The pointer to the key cannot be null",
 	"Compare function return an unknown value",
-	"Element not found"
+	"Could not read or write the file",
+	"The file is not in the expected format or version",
+	"Attempt to add an element but the structure is full",
+	"The elements are not sorted by the compare function",
+	"Operation not supported by the structure in its current mode"
 };
 
 char* gerror_to_str (gerror_t g)
@@ -0,0 +1,683 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ */
+
+#include <stdint.h>
+#include "hashmap.h"
+#include "galign.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/*
+ * control bytes; the hash bits of a full slot are
+ * smaller than HM_EMPTY. HM_DEAD marks the slots of
+ * the old table already moved to the new one; it keeps
+ * the probe sequences of the old table intact
+ */
+#define HM_EMPTY	((unsigned char) 0x80)
+#define HM_DEAD		((unsigned char) 0xFE)
+#define HM_NONE		((size_t) -1)
+
+#define HM_INITIAL_CAPACITY (16)
+
+/*
+ * auxiliar function prototypes
+ */
+static unsigned int hm_group_match(const unsigned char* group, unsigned char byte);
+static void htable_init(hashmap_t* hm, htable_t* t, size_t capacity);
+static void htable_free(htable_t* t);
+static void htable_set_ctrl(htable_t* t, size_t i, unsigned char byte);
+static void* htable_slot(hashmap_t* hm, htable_t* t, size_t i);
+static size_t htable_find(hashmap_t* hm, htable_t* t, void* key, size_t hash);
+static size_t htable_claim(hashmap_t* hm, htable_t* t, size_t hash);
+static void htable_erase(hashmap_t* hm, htable_t* t, size_t i);
+static int hm_equal(hashmap_t* hm, void* a, void* b);
+static void hm_migrate(hashmap_t* hm, size_t steps);
+static void hm_grow(hashmap_t* hm);
+static size_t hm_lookup(hashmap_t* hm, void* key, htable_t** t);
+
+/** Creates a hash map of keys with size `key_size` mapped to elements
+  * with size `member_size` and populates the previous allocated
+  * structure `hm`. By default the keys are hashed and compared
+  * byte by byte.
+  *
+  * @param hm		pointer to a previous allocated `hashmap_t` structure;
+  * @param key_size	size of the keys in bytes
+  * @param member_size	size of the elements in bytes
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `hm` is null
+  */
+gerror_t hashmap_create (struct hashmap_t* hm, size_t key_size, size_t member_size)
+{
+	if(!hm) return GERROR_NULL_STRUCTURE;
+
+	hm->size = 0;
+	hm->key_size = key_size;
+	hm->member_size = member_size;
+
+	/*
+	 * the keys and the elements start at aligned offsets,
+	 * so the elements in the slots are aligned
+	 */
+	hm->elem_offset = G_ALIGN(key_size);
+	hm->slot_size = hm->elem_offset + G_ALIGN(member_size);
+
+	hm->hash = hashmap_default_hash_function;
+	hm->hash_argument = NULL;
+	hm->compare = NULL;
+	hm->compare_argument = NULL;
+
+	memset(&hm->table, 0, sizeof(htable_t));
+	memset(&hm->old, 0, sizeof(htable_t));
+	hm->migrate = 0;
+
+	return GERROR_OK;
+}
+
+/** Destroys and deallocates the tables of `hm`.
+  *
+  * @param hm	pointer to a previous allocated `hashmap_t` structure;
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `hm` is null
+  */
+gerror_t hashmap_destroy (struct hashmap_t* hm)
+{
+	if(!hm) return GERROR_NULL_STRUCTURE;
+
+	htable_free(&hm->table);
+	htable_free(&hm->old);
+	hm->size = 0;
+
+	return GERROR_OK;
+}
+
+/** Change the hash function of the keys of `hm`. It must be set
+  * before the first insert and it must be consistent with the
+  * compare function: equal keys must have equal hashes.
+  *
+  * @param hm		pointer to a previous allocated `hashmap_t` structure;
+  * @param function	hash function or NULL for the default one
+  * @param argument	pointer to the argument to the hash function
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `hm` is null
+  */
+gerror_t hashmap_set_hash_function(
+		struct hashmap_t* hm,
+		hashmap_hash_function function,
+		void* argument)
+{
+	if(!hm) return GERROR_NULL_STRUCTURE;
+
+	hm->hash = function ? function : hashmap_default_hash_function;
+	hm->hash_argument = argument;
+
+	return GERROR_OK;
+}
+
+/** Change the function used to check the equality of the keys of
+  * `hm`; by default the keys are compared byte by byte.
+  *
+  * @param hm		pointer to a previous allocated `hashmap_t` structure;
+  * @param function	compare function or NULL for the default one
+  * @param argument	pointer to the argument to the compare function
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `hm` is null
+  */
+gerror_t hashmap_set_compare_function(
+		struct hashmap_t* hm,
+		hashmap_compare_function function,
+		void* argument)
+{
+	if(!hm) return GERROR_NULL_STRUCTURE;
+
+	hm->compare = function;
+	hm->compare_argument = argument;
+
+	return GERROR_OK;
+}
+
+/** Inserts the element `elem` at the key `key` in `hm`; if the
+  * key is already in `hm` its element is overwritten.
+  * O(1) expected; a growing map moves HASHMAP_MIGRATE_STEP slots
+  * of the old table per insert.
+  *
+  * @param hm	pointer to a previous allocated `hashmap_t` structure;
+  * @param key	pointer to the key
+  * @param elem	pointer to the element to be copied or NULL
+  * 		to store a zeroed element
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `hm` is null
+  * 		GERROR_NULL_KEY in case that `key` is null
+  */
+gerror_t hashmap_insert (struct hashmap_t* hm, void* key, void* elem)
+{
+	void* slot;
+	gerror_t g = hashmap_emplace(hm, key, &slot, NULL);
+
+	if(g == GERROR_OK && elem)
+		memcpy(slot, elem, hm->member_size);
+
+	return g;
+}
+
+/** Finds the element at the key `key` or, if `key` is not in `hm`,
+  * inserts it with a zeroed element, and writes in `elem` a pointer
+  * to the element in its slot, which can be changed in place. The
+  * pointer is valid until the next insert or remove in `hm`, which
+  * may move the slots. O(1) expected, with a single lookup.
+  *
+  * @param hm		pointer to a previous allocated `hashmap_t` structure;
+  * @param key		pointer to the key
+  * @param elem		pointer to write the pointer to the element
+  * @param inserted	pointer to write 1 if `key` was inserted and
+  * 			0 if it was found, or NULL
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `hm` is null
+  * 		GERROR_NULL_KEY in case that `key` is null
+  * 		GERROR_NULL_RETURN_POINTER in case `elem` is null
+  */
+gerror_t hashmap_emplace (struct hashmap_t* hm, void* key, void** elem, int* inserted)
+{
+	if(!hm) return GERROR_NULL_STRUCTURE;
+	if(!key) return GERROR_NULL_KEY;
+	if(!elem) return GERROR_NULL_RETURN_POINTER;
+
+	htable_t* t;
+	size_t i = hm_lookup(hm, key, &t);
+
+	if(i != HM_NONE){
+		*elem = (char*) htable_slot(hm, t, i) + hm->elem_offset;
+		if(inserted)
+			*inserted = 0;
+		return GERROR_OK;
+	}
+
+	/*
+	 * at most 7/8 of the slots are used
+	 */
+	if(hm->table.count + 1 > hm->table.capacity/8*7)
+		hm_grow(hm);
+
+	size_t hash = hm->hash(key, hm->key_size, hm->hash_argument);
+	i = htable_claim(hm, &hm->table, hash);
+
+	char* slot = (char*) htable_slot(hm, &hm->table, i);
+	memcpy(slot, key, hm->key_size);
+	memset(slot + hm->elem_offset, 0, hm->member_size);
+
+	hm->size++;
+
+	/*
+	 * the migration only claims slots of the new
+	 * table, so `slot` is not moved
+	 */
+	hm_migrate(hm, HASHMAP_MIGRATE_STEP);
+
+	*elem = slot + hm->elem_offset;
+	if(inserted)
+		*inserted = 1;
+
+	return GERROR_OK;
+}
+
+/** Removes the key `key` of `hm` and writes its element in `elem`.
+  * The following keys of the probe sequence are shifted back, so
+  * no tombstone is left. O(1) expected.
+  *
+  * @param hm	pointer to a previous allocated `hashmap_t` structure;
+  * @param key	pointer to the key
+  * @param elem	pointer to a location of memory where the element
+  * 		will be written or NULL
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `hm` is null
+  * 		GERROR_NULL_KEY in case that `key` is null
+  * 		GERROR_ELEMENT_NOT_FOUNDED in case `key` is not in `hm`
+  */
+gerror_t hashmap_remove (struct hashmap_t* hm, void* key, void* elem)
+{
+	if(!hm) return GERROR_NULL_STRUCTURE;
+	if(!key) return GERROR_NULL_KEY;
+
+	htable_t* t;
+	size_t i = hm_lookup(hm, key, &t);
+
+	if(i == HM_NONE)
+		return GERROR_ELEMENT_NOT_FOUNDED;
+
+	if(elem)
+		memcpy(elem, (char*) htable_slot(hm, t, i) + hm->elem_offset, hm->member_size);
+
+	if(t == &hm->table){
+		htable_erase(hm, t, i);
+	}else{
+		htable_set_ctrl(t, i, HM_DEAD);
+		t->count--;
+	}
+
+	hm->size--;
+	hm_migrate(hm, HASHMAP_MIGRATE_STEP);
+
+	return GERROR_OK;
+}
+
+/** Writes the element at the key `key` in `elem`. O(1) expected.
+  *
+  * @param hm	pointer to a previous allocated `hashmap_t` structure;
+  * @param key	pointer to the key
+  * @param elem	pointer to a location of memory where the element
+  * 		will be written or NULL to only check the key
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `hm` is null
+  * 		GERROR_NULL_KEY in case that `key` is null
+  * 		GERROR_ELEMENT_NOT_FOUNDED in case `key` is not in `hm`
+  */
+gerror_t hashmap_find (struct hashmap_t* hm, void* key, void* elem)
+{
+	return hashmap_get_pair(hm, key, NULL, elem);
+}
+
+/** Writes the key and the element at the key `key` in `rkey`
+  * and `relem`. O(1) expected.
+  *
+  * @param hm		pointer to a previous allocated `hashmap_t` structure;
+  * @param key		pointer to the key
+  * @param rkey		pointer to the memory location to write the key or NULL
+  * @param relem	pointer to the memory location to write the elem or NULL
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `hm` is null
+  * 		GERROR_NULL_KEY in case that `key` is null
+  * 		GERROR_ELEMENT_NOT_FOUNDED in case `key` is not in `hm`
+  */
+gerror_t hashmap_get_pair (struct hashmap_t* hm, void* key, void* rkey, void* relem)
+{
+	if(!hm) return GERROR_NULL_STRUCTURE;
+	if(!key) return GERROR_NULL_KEY;
+
+	htable_t* t;
+	size_t i = hm_lookup(hm, key, &t);
+
+	if(i == HM_NONE)
+		return GERROR_ELEMENT_NOT_FOUNDED;
+
+	char* slot = (char*) htable_slot(hm, t, i);
+
+	if(rkey)
+		memcpy(rkey, slot, hm->key_size);
+
+	if(relem)
+		memcpy(relem, slot + hm->elem_offset, hm->member_size);
+
+	return GERROR_OK;
+}
+
+/** Writes in `elem` a pointer to the element at the key `key`,
+  * stored in its slot, without copying it. The pointer is aligned
+  * for the element type if its alignment is at most that of
+  * galign_t, and the element can be changed in place through
+  * it; the pointer is valid until the next insert or
+  * remove in `hm`, which may move the slots. O(1) expected.
+  *
+  * @param hm	pointer to a previous allocated `hashmap_t` structure;
+  * @param key	pointer to the key
+  * @param elem	pointer to write the pointer to the element
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `hm` is null
+  * 		GERROR_NULL_KEY in case that `key` is null
+  * 		GERROR_NULL_RETURN_POINTER in case `elem` is null
+  * 		GERROR_ELEMENT_NOT_FOUNDED in case `key` is not in `hm`;
+  * 		`*elem` is set to NULL
+  */
+gerror_t hashmap_find_ptr (struct hashmap_t* hm, void* key, void** elem)
+{
+	if(!hm) return GERROR_NULL_STRUCTURE;
+	if(!key) return GERROR_NULL_KEY;
+	if(!elem) return GERROR_NULL_RETURN_POINTER;
+
+	htable_t* t;
+	size_t i = hm_lookup(hm, key, &t);
+
+	if(i == HM_NONE){
+		*elem = NULL;
+		return GERROR_ELEMENT_NOT_FOUNDED;
+	}
+
+	*elem = (char*) htable_slot(hm, t, i) + hm->elem_offset;
+
+	return GERROR_OK;
+}
+
+/** Calls `function` for each pair of `hm`, in no particular order.
+  * The map must not be modified by `function`.
+  *
+  * @param hm		pointer to a previous allocated `hashmap_t` structure;
+  * @param function	function called for each pair; a non zero
+  * 			return stops the iteration
+  * @param arg		argument passed to `function`
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `hm` is null
+  * 		GERROR_NULL_ELEMENT_POINTER in case that `function` is null
+  */
+gerror_t hashmap_foreach (struct hashmap_t* hm, hashmap_foreach_function function, void* arg)
+{
+	if(!hm) return GERROR_NULL_STRUCTURE;
+	if(!function) return GERROR_NULL_ELEMENT_POINTER;
+
+	htable_t* tables[2];
+	size_t i, k;
+
+	tables[0] = &hm->table;
+	tables[1] = &hm->old;
+
+	for(k = 0; k < 2; k++){
+		htable_t* t = tables[k];
+
+		for(i = 0; i < t->capacity; i++){
+			if(t->ctrl[i] >= HM_EMPTY)
+				continue;
+
+			char* slot = (char*) htable_slot(hm, t, i);
+			if(function(slot, slot + hm->elem_offset, arg))
+				return GERROR_OK;
+		}
+	}
+
+	return GERROR_OK;
+}
+
+/** Default hash function of the hashmap_t keys; hashes the
+  * `size` bytes of `key` eight at a time.
+  *
+  * @param key	pointer to the key
+  * @param size	size of the key in bytes
+  * @param arg	unused
+  *
+  * @return	the hash of the key
+  */
+size_t hashmap_default_hash_function(void* key, size_t size, void* arg)
+{
+	const unsigned char* p = (const unsigned char*) key;
+	uint64_t h = UINT64_C(0x9E3779B97F4A7C15) ^ size;
+	uint64_t w;
+	(void) arg;
+
+	while(size >= sizeof(w)){
+		memcpy(&w, p, sizeof(w));
+		h = (h ^ w)*UINT64_C(0xBF58476D1CE4E5B9);
+		h ^= h >> 31;
+		p += sizeof(w);
+		size -= sizeof(w);
+	}
+
+	if(size){
+		w = 0;
+		memcpy(&w, p, size);
+		h = (h ^ w)*UINT64_C(0xBF58476D1CE4E5B9);
+		h ^= h >> 31;
+	}
+
+	h ^= h >> 33;
+	h *= UINT64_C(0xFF51AFD7ED558CCD);
+	h ^= h >> 33;
+
+	return (size_t) h;
+}
+
+/*
+ * returns a mask with the bit `i` set if the byte `i`
+ * of the group is equal to `byte`
+ */
+static unsigned int hm_group_match(const unsigned char* group, unsigned char byte)
+{
+#ifdef __SSE2__
+	__m128i g = _mm_loadu_si128((const __m128i*) group);
+	return (unsigned int) _mm_movemask_epi8(_mm_cmpeq_epi8(g, _mm_set1_epi8((char) byte)));
+#else
+	unsigned int mask = 0;
+	int i;
+
+	for(i = 0; i < HASHMAP_GROUP_SIZE; i++)
+		if(group[i] == byte)
+			mask |= 1u << i;
+
+	return mask;
+#endif
+}
+
+/*
+ * allocates an empty table with `capacity` slots,
+ * a power of two
+ */
+static void htable_init(hashmap_t* hm, htable_t* t, size_t capacity)
+{
+	t->capacity = capacity;
+	t->count = 0;
+	t->ctrl = (unsigned char*) malloc(capacity + HASHMAP_GROUP_SIZE);
+	t->slots = (char*) malloc(capacity*hm->slot_size);
+
+	memset(t->ctrl, HM_EMPTY, capacity + HASHMAP_GROUP_SIZE);
+}
+
+/*
+ * deallocates the table
+ */
+static void htable_free(htable_t* t)
+{
+	free(t->ctrl);
+	free(t->slots);
+	memset(t, 0, sizeof(htable_t));
+}
+
+/*
+ * writes the control byte of the slot `i`
+ * and of its copy after the end
+ */
+static void htable_set_ctrl(htable_t* t, size_t i, unsigned char byte)
+{
+	t->ctrl[i] = byte;
+
+	if(i < HASHMAP_GROUP_SIZE)
+		t->ctrl[t->capacity + i] = byte;
+}
+
+/*
+ * returns the pointer to the slot `i`
+ */
+static void* htable_slot(hashmap_t* hm, htable_t* t, size_t i)
+{
+	return t->slots + i*hm->slot_size;
+}
+
+/*
+ * returns 1 if the keys are equal
+ */
+static int hm_equal(hashmap_t* hm, void* a, void* b)
+{
+	if(hm->compare)
+		return hm->compare(a, b, hm->compare_argument) == 0;
+
+	return memcmp(a, b, hm->key_size) == 0;
+}
+
+/*
+ * returns the slot of `key` in `t` or HM_NONE; the probe
+ * sequence of a key ends at the first empty slot
+ */
+static size_t htable_find(hashmap_t* hm, htable_t* t, void* key, size_t hash)
+{
+	size_t mask = t->capacity - 1;
+	size_t pos = (hash >> 7) & mask;
+	unsigned char h2 = hash & 0x7F;
+
+	for(;;){
+		const unsigned char* group = t->ctrl + pos;
+		unsigned int match = hm_group_match(group, h2);
+
+		while(match){
+			size_t i = (pos + __builtin_ctz(match)) & mask;
+
+			if(hm_equal(hm, htable_slot(hm, t, i), key))
+				return i;
+
+			match &= match - 1;
+		}
+
+		if(hm_group_match(group, HM_EMPTY))
+			return HM_NONE;
+
+		pos = (pos + HASHMAP_GROUP_SIZE) & mask;
+	}
+}
+
+/*
+ * takes the first empty slot of the probe sequence
+ * of `hash` in `t` and returns it
+ */
+static size_t htable_claim(hashmap_t* hm, htable_t* t, size_t hash)
+{
+	size_t mask = t->capacity - 1;
+	size_t pos = (hash >> 7) & mask;
+	(void) hm;
+
+	for(;;){
+		unsigned int empty = hm_group_match(t->ctrl + pos, HM_EMPTY);
+
+		if(empty){
+			size_t i = (pos + __builtin_ctz(empty)) & mask;
+
+			htable_set_ctrl(t, i, hash & 0x7F);
+			t->count++;
+
+			return i;
+		}
+
+		pos = (pos + HASHMAP_GROUP_SIZE) & mask;
+	}
+}
+
+/*
+ * empties the slot `i` and shifts back the following keys
+ * of the cluster which may take it, so every key remains
+ * reachable from its home slot without tombstones
+ */
+static void htable_erase(hashmap_t* hm, htable_t* t, size_t i)
+{
+	size_t mask = t->capacity - 1;
+	size_t j = i;
+
+	for(;;){
+		j = (j + 1) & mask;
+
+		if(t->ctrl[j] == HM_EMPTY)
+			break;
+
+		void* slot = htable_slot(hm, t, j);
+		size_t home = (hm->hash(slot, hm->key_size, hm->hash_argument) >> 7) & mask;
+
+		/*
+		 * the key at `j` may move to `i` if `i` is
+		 * between its home and `j`
+		 */
+		if(((j - home) & mask) >= ((j - i) & mask)){
+			memcpy(htable_slot(hm, t, i), slot, hm->slot_size);
+			htable_set_ctrl(t, i, t->ctrl[j]);
+			i = j;
+		}
+	}
+
+	htable_set_ctrl(t, i, HM_EMPTY);
+	t->count--;
+}
+
+/*
+ * looks for `key` in the table and in the old table;
+ * returns the slot and writes its table in `t`
+ */
+static size_t hm_lookup(hashmap_t* hm, void* key, htable_t** t)
+{
+	if(!hm->size)
+		return HM_NONE;
+
+	size_t hash = hm->hash(key, hm->key_size, hm->hash_argument);
+	size_t i;
+
+	*t = &hm->table;
+	i = htable_find(hm, *t, key, hash);
+
+	if(i == HM_NONE && hm->old.ctrl){
+		*t = &hm->old;
+		i = htable_find(hm, *t, key, hash);
+	}
+
+	return i;
+}
+
+/*
+ * moves up to `steps` slots of the old table to the table;
+ * the moved slots are marked dead
+ */
+static void hm_migrate(hashmap_t* hm, size_t steps)
+{
+	htable_t* old = &hm->old;
+
+	while(old->ctrl && steps--){
+		if(old->ctrl[hm->migrate] < HM_EMPTY){
+			char* from = (char*) htable_slot(hm, old, hm->migrate);
+			size_t hash = hm->hash(from, hm->key_size, hm->hash_argument);
+			size_t i = htable_claim(hm, &hm->table, hash);
+
+			memcpy(htable_slot(hm, &hm->table, i), from, hm->slot_size);
+			htable_set_ctrl(old, hm->migrate, HM_DEAD);
+			old->count--;
+		}
+
+		if(++hm->migrate == old->capacity)
+			htable_free(old);
+	}
+}
+
+/*
+ * starts to move the pairs to a table with twice the
+ * capacity; a previous growth is finished first
+ */
+static void hm_grow(hashmap_t* hm)
+{
+	if(hm->old.ctrl)
+		hm_migrate(hm, hm->old.capacity);
+
+	if(!hm->table.capacity){
+		htable_init(hm, &hm->table, HM_INITIAL_CAPACITY);
+		return;
+	}
+
+	hm->old = hm->table;
+	hm->migrate = 0;
+	htable_init(hm, &hm->table, 2*hm->old.capacity);
+}
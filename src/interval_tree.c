@@ -0,0 +1,258 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ */
+
+#include "interval_tree.h"
+
+/*
+ * offset of the element from the beginning of the interval
+ */
+#define INTERVAL_ELEM_OFFSET RBNODE_OFFSET(sizeof(interval_t))
+
+/*
+ * auxiliar function prototypes
+ */
+static int interval_tree_compare(void* a, void* b, void* arg);
+static void interval_tree_augment(void* elem, void* left, void* right, void* arg);
+static int interval_tree_visit(
+		rbnode_t* node,
+		long lo,
+		long hi,
+		interval_tree_function function,
+		void* arg);
+
+/** Creates an interval tree of elements with size `member_size`
+  * and populates the previous allocated structure `it`.
+  *
+  * @param it		pointer to a previous allocated `interval_tree_t` structure;
+  * @param member_size	size of the elements stored with the intervals in bytes
+  *
+  * @see rbtree_create
+  *
+  * @return	GERROR_OK in case of success
+  */
+gerror_t interval_tree_create (struct interval_tree_t* it, size_t member_size)
+{
+	if(!it) return GERROR_NULL_STRUCTURE;
+
+	it->member_size = member_size;
+
+	gerror_t g = rbtree_create(&it->tree, INTERVAL_ELEM_OFFSET + member_size);
+	if(g != GERROR_OK)
+		return g;
+
+	g = rbtree_set_flags(&it->tree, 0);
+	if(g != GERROR_OK)
+		return g;
+
+	g = rbtree_set_compare_function(&it->tree, interval_tree_compare, NULL);
+	if(g != GERROR_OK)
+		return g;
+
+	return rbtree_set_augment_function(&it->tree, interval_tree_augment, NULL);
+}
+
+/** Destroys and deallocates inner attributes of `it`.
+  *
+  * @param it	pointer to a previous allocated `interval_tree_t` structure;
+  *
+  * @see rbtree_destroy
+  *
+  * @return	GERROR_OK in case of success
+  */
+gerror_t interval_tree_destroy (struct interval_tree_t* it)
+{
+	if(!it) return GERROR_NULL_STRUCTURE;
+
+	it->member_size = 0;
+
+	return rbtree_destroy(&it->tree);
+}
+
+/** Adds the interval [`lo`, `hi`) with the element `elem`;
+  * O(log n).
+  *
+  * @param it	pointer to a previous allocated `interval_tree_t` structure;
+  * @param lo	start of the interval
+  * @param hi	end of the interval, not included
+  * @param elem	pointer to the element to be copied or NULL
+  * 		to store a zeroed element
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_ACCESS_OUT_OF_BOUND in case that `hi` is
+  * 		smaller than `lo`
+  */
+gerror_t interval_tree_add (struct interval_tree_t* it, long lo, long hi, void* elem)
+{
+	if(!it) return GERROR_NULL_STRUCTURE;
+	if(hi < lo) return GERROR_ACCESS_OUT_OF_BOUND;
+
+	void* buffer = (void*) malloc(it->tree.member_size);
+	interval_t* interval = (interval_t*) buffer;
+
+	interval->lo = lo;
+	interval->hi = hi;
+	interval->max = hi;
+
+	if(elem)
+		memcpy(buffer + INTERVAL_ELEM_OFFSET, elem, it->member_size);
+	else
+		memset(buffer + INTERVAL_ELEM_OFFSET, 0, it->member_size);
+
+	gerror_t g = rbtree_add(&it->tree, buffer);
+
+	free(buffer);
+	return g;
+}
+
+/** Removes one interval equal to [`lo`, `hi`); O(log n).
+  *
+  * @param it	pointer to a previous allocated `interval_tree_t` structure;
+  * @param lo	start of the interval
+  * @param hi	end of the interval, not included
+  * @param elem	pointer to a location of memory where the element
+  * 		of the removed interval will be written or NULL
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_ELEMENT_NOT_FOUNDED in case there is no
+  * 		such interval
+  */
+gerror_t interval_tree_remove (struct interval_tree_t* it, long lo, long hi, void* elem)
+{
+	if(!it) return GERROR_NULL_STRUCTURE;
+
+	interval_t key;
+	rbnode_t* node;
+
+	key.lo = lo;
+	key.hi = hi;
+	key.max = hi;
+
+	gerror_t g = rbtree_find_node(&it->tree, &key, &node);
+	if(g != GERROR_OK)
+		return g;
+
+	if(elem)
+		memcpy(elem, node->data + INTERVAL_ELEM_OFFSET, it->member_size);
+
+	return rbtree_remove_node(&it->tree, node);
+}
+
+/** Calls `function` for each interval of `it` overlapping
+  * [`lo`, `hi`), in order of start; O(log n + k) for k intervals.
+  * Two half open intervals [a, b) and [lo, hi) overlap if
+  * a < hi and lo < b.
+  * The tree must not be modified by `function`.
+  *
+  * @param it		pointer to a previous allocated `interval_tree_t` structure;
+  * @param lo		start of the query
+  * @param hi		end of the query, not included
+  * @param function	function called for each interval; a non zero
+  * 			return stops the query
+  * @param arg		argument passed to `function`
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_ELEMENT_POINTER in case that `function` is null
+  */
+gerror_t interval_tree_overlaps (
+		struct interval_tree_t* it,
+		long lo,
+		long hi,
+		interval_tree_function function,
+		void* arg)
+{
+	if(!it) return GERROR_NULL_STRUCTURE;
+	if(!function) return GERROR_NULL_ELEMENT_POINTER;
+
+	interval_tree_visit(it->tree.root, lo, hi, function, arg);
+
+	return GERROR_OK;
+}
+
+/*
+ * auxiliar function;
+ * visits the intervals of the subtree of `node` overlapping
+ * [lo, hi); the subtrees which end before `lo` are skipped by
+ * `max` and the right subtrees which start at or after `hi`
+ * by the order. returns non zero if the query was stopped
+ */
+static int interval_tree_visit(
+		rbnode_t* node,
+		long lo,
+		long hi,
+		interval_tree_function function,
+		void* arg)
+{
+	while(node != NULL){
+		interval_t* interval = (interval_t*) node->data;
+
+		if(interval->max <= lo)
+			return 0;
+
+		if(interval_tree_visit(node->left, lo, hi, function, arg))
+			return 1;
+
+		if(interval->lo >= hi)
+			return 0;
+
+		if(interval->hi > lo
+		&& function(	interval->lo,
+				interval->hi,
+				node->data + INTERVAL_ELEM_OFFSET,
+				arg))
+			return 1;
+
+		node = node->right;
+	}
+
+	return 0;
+}
+
+/*
+ * compare function of the interval tree;
+ * orders by the start and then by the end
+ */
+static int interval_tree_compare(void* a, void* b, void* arg)
+{
+	interval_t* x = (interval_t*) a;
+	interval_t* y = (interval_t*) b;
+	(void) arg;
+
+	if(x->lo != y->lo)
+		return (x->lo > y->lo) - (x->lo < y->lo);
+
+	return (x->hi > y->hi) - (x->hi < y->hi);
+}
+
+/*
+ * augment function of the interval tree;
+ * keeps the greatest end of the subtree
+ */
+static void interval_tree_augment(void* elem, void* left, void* right, void* arg)
+{
+	interval_t* interval = (interval_t*) elem;
+	(void) arg;
+
+	interval->max = interval->hi;
+
+	if(left && ((interval_t*) left)->max > interval->max)
+		interval->max = ((interval_t*) left)->max;
+
+	if(right && ((interval_t*) right)->max > interval->max)
+		interval->max = ((interval_t*) right)->max;
+}
@@ -26,6 +26,26 @@
   */
 int map_default_compare_function (void* a, void* b, void* arg);
 
+/*
+ * a map_range call over the G_MAP_PERSISTENT backend
+ */
+typedef struct map_range_t {
+	map_range_function function;
+	void* arg;
+	size_t elem_offset;
+} map_range_t;
+
+/*
+ * the pairs of the G_MAP_RBTREE and G_MAP_PERSISTENT backends
+ * are the key and then the element, at the key size rounded up
+ * to the alignment of galign_t
+ */
+#define MAP_ELEM_OFFSET(m) RBNODE_OFFSET((m)->key_size)
+#define MAP_PAIR_SIZE(m) (MAP_ELEM_OFFSET(m) + (m)->member_size)
+#define MAP_ELEM(m, pair) ((char*) (pair) + MAP_ELEM_OFFSET(m))
+
+static int map_range_pair(void* pair, void* arg);
+
 /** Creates a map of key size `key_size` and mapped member with size `member_size`
   * and populates the previous allocated structure `m`.
   * TODO: A more datailed description of map_create.
@@ -39,19 +59,62 @@ int map_default_compare_function (void* a, void* b, void* arg);
   * @return	GERROR_OK in case of success
   */
 gerror_t map_create (struct map_t* m, size_t key_size, size_t member_size)
+{
+	return map_create_backend(m, key_size, member_size, G_MAP_RBTREE);
+}
+
+/** Creates a map like map_create using the data structure
+  * `backend`. The behavior of the map is the same for every
+  * backend; see map_backend_t.
+  *
+  * @param m		pointer to a previous allocated `map_t` structure;
+  * @param key_size	size of the key in bytes
+  * @param member_size	size of the members in bytes
+  * @param backend	data structure of the map
+  *
+  * @see map_create
+  * @see btree_create
+  *
+  * @return	GERROR_OK in case of success
+  */
+gerror_t map_create_backend (
+		struct map_t* m,
+		size_t key_size,
+		size_t member_size,
+		map_backend_t backend)
 {
 	if(!m) return GERROR_NULL_STRUCTURE;
 
 	m->key_size = key_size;
 	m->member_size = member_size;
+	m->backend = backend;
+
+	if(backend == G_MAP_HASH)
+		return hashmap_create(&m->data.hash, key_size, member_size);
+
+	if(backend == G_MAP_BTREE){
+		gerror_t g = btree_create(&m->data.btree, key_size, member_size);
+		if(g != GERROR_OK)
+			return g;
+
+		return btree_set_compare_function(&m->data.btree, map_default_compare_function, m);
+	}
 
-	gerror_t g = rbtree_create(&m->map, key_size + member_size);
+	if(backend == G_MAP_PERSISTENT){
+		gerror_t g = prbtree_create(&m->data.persistent, MAP_PAIR_SIZE(m));
+		if(g != GERROR_OK)
+			return g;
+
+		return prbtree_set_compare_function(&m->data.persistent, map_default_compare_function, m);
+	}
+
+	gerror_t g = rbtree_create(&m->data.map, MAP_PAIR_SIZE(m));
 	if(g != GERROR_OK)
 		return g;
 
-	g = rbtree_set_flags(&m->map, G_RB_EQUAL_OVERRIDE);
+	g = rbtree_set_flags(&m->data.map, G_RB_EQUAL_OVERRIDE);
 
-	return rbtree_set_compare_function(&m->map, map_default_compare_function, m);
+	return rbtree_set_compare_function(&m->data.map, map_default_compare_function, m);
 }
 
 /** Destroys and deallocates inner attributes of `m`.
@@ -70,7 +133,14 @@ gerror_t map_destroy (struct map_t* m)
 	m->key_size = 0;
 	m->member_size = 0;
 
-	return rbtree_destroy(&m->map);
+	if(m->backend == G_MAP_BTREE)
+		return btree_destroy(&m->data.btree);
+	if(m->backend == G_MAP_HASH)
+		return hashmap_destroy(&m->data.hash);
+	if(m->backend == G_MAP_PERSISTENT)
+		return prbtree_destroy(&m->data.persistent);
+
+	return rbtree_destroy(&m->data.map);
 }
 
 /** Inserts a element `elem` in the key `key` in the map `m`.
@@ -80,7 +150,7 @@ gerror_t map_destroy (struct map_t* m)
   * @param key	pointer to the key used to map the `elem`
   * @param elem	pointer to the element to be inserted
   *
-  * @see rbtree_add
+  * @see map_emplace
   *
   * @return	GERROR_OK in case of success
   */
@@ -90,13 +160,146 @@ gerror_t map_insert (struct map_t* m, void* key, void* elem)
 	if(!key) return GERROR_NULL_KEY;
 	if(!elem) return GERROR_NULL_ELEMENT_POINTER;
 
-	void* pair = (void*) malloc(m->key_size + m->member_size);
-	memcpy(pair, key, m->key_size);
-	memcpy(pair + m->key_size, elem, m->member_size);
+	if(m->backend == G_MAP_BTREE)
+		return btree_insert(&m->data.btree, key, elem);
+	if(m->backend == G_MAP_HASH)
+		return hashmap_insert(&m->data.hash, key, elem);
+
+	/*
+	 * the pair is created in place, without a temporary copy
+	 */
+	void* value;
+	gerror_t g = map_emplace(m, key, &value, NULL);
+
+	if(g == GERROR_OK)
+		memcpy(value, elem, m->member_size);
+
+	return g;
+}
+
+/** Finds the element mapped by `key` or, if `key` is not in `m`,
+  * inserts it mapped to a zeroed element, and writes in `elem` a
+  * pointer to the element stored in `m`, which can be read and
+  * changed in place: the "get or insert default" of counting
+  * loops takes a single descent and a single allocation.
+  *
+  * The pointer is valid until the next insert or remove in `m`,
+  * or until `m` is destroyed; with the G_MAP_PERSISTENT backend
+  * also until the next map_snapshot, since the element is then
+  * shared with the snapshot. It is aligned as in map_find_ptr.
+  *
+  * Example:
+  *	long* count;
+  *	map_emplace(&m, &word, (void**) &count, NULL);
+  *	(*count)++;
+  *
+  * @param m		pointer to a previous allocated `map_t` structure;
+  * @param key		pointer to the key
+  * @param elem		pointer to write the pointer to the element
+  * @param inserted	pointer to write 1 if `key` was inserted and
+  * 			0 if it was found, or NULL
+  *
+  * @see rbtree_emplace
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `m` is null
+  * 		GERROR_NULL_KEY in case that `key` is null
+  * 		GERROR_NULL_RETURN_POINTER in case `elem` is null
+  */
+gerror_t map_emplace (struct map_t* m, void* key, void** elem, int* inserted)
+{
+	if(!m) return GERROR_NULL_STRUCTURE;
+	if(!key) return GERROR_NULL_KEY;
+	if(!elem) return GERROR_NULL_RETURN_POINTER;
+
+	if(m->backend == G_MAP_BTREE)
+		return btree_emplace(&m->data.btree, key, elem, inserted);
+	if(m->backend == G_MAP_HASH)
+		return hashmap_emplace(&m->data.hash, key, elem, inserted);
+
+	if(m->backend == G_MAP_PERSISTENT){
+		void* pair;
+		gerror_t g = prbtree_emplace(&m->data.persistent, key, m->key_size, &pair, inserted);
+		if(g != GERROR_OK)
+			return g;
+
+		*elem = MAP_ELEM(m, pair);
+		return GERROR_OK;
+	}
+
+	rbnode_t* node;
+	gerror_t g = rbtree_emplace(&m->data.map, key, m->key_size, &node, inserted);
+	if(g != GERROR_OK)
+		return g;
+
+	*elem = MAP_ELEM(m, node->data);
+	return GERROR_OK;
+}
+
+/** Builds the map `m` from `n` keys sorted by the compare function
+  * and the elements mapped by them. If a key is repeated the last
+  * element is kept. The cost depends on the backend:
+  * 	G_MAP_RBTREE: O(n), the pairs are packed once and the
+  * 	nodes are linked directly, without searches or rotations;
+  * 	G_MAP_BTREE: O(n), the leaves are filled in order and the
+  * 	internal levels are built bottom-up over them;
+  * 	G_MAP_PERSISTENT: O(n), the tree is built recursively from
+  * 	the middle of each range, without path copies;
+  * 	G_MAP_HASH: O(n) expected, the pairs are inserted one by
+  * 	one and the order of the keys is not checked.
+  * If `m` is not empty the pairs are inserted one by one, in
+  * O(n log(size + n)) for the tree backends. With the tree
+  * backends an unsorted `keys` is rejected before `m` is changed.
+  *
+  * @param m	pointer to a previous allocated `map_t` structure;
+  * @param keys	pointer to `n` sorted keys of `key_size` bytes
+  * @param elems	pointer to `n` elements of `member_size` bytes
+  * @param n	number of pairs
+  *
+  * @see rbtree_build_sorted
+  * @see btree_build_sorted
+  * @see prbtree_build_sorted
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_KEY in case that `keys` is null
+  * 		GERROR_NULL_ELEMENT_POINTER in case that `elems` is null
+  * 		GERROR_UNSORTED_ELEMENTS in case that `keys` is not sorted
+  */
+gerror_t map_build_sorted (struct map_t* m, void* keys, void* elems, size_t n)
+{
+	if(!m) return GERROR_NULL_STRUCTURE;
+	if(!n) return GERROR_OK;
+	if(!keys) return GERROR_NULL_KEY;
+	if(!elems) return GERROR_NULL_ELEMENT_POINTER;
+
+	size_t i;
+
+	if(m->backend == G_MAP_HASH){
+		for(i = 0; i < n; i++)
+			hashmap_insert(&m->data.hash, keys + i*m->key_size, elems + i*m->member_size);
+
+		return GERROR_OK;
+	}
+
+	if(m->backend == G_MAP_BTREE)
+		return btree_build_sorted(&m->data.btree, keys, elems, n);
+
+	size_t pair_size = MAP_PAIR_SIZE(m);
+	void* pairs = (void*) malloc(n*pair_size);
+
+	for(i = 0; i < n; i++){
+		memcpy(pairs + i*pair_size, keys + i*m->key_size, m->key_size);
+		memcpy(MAP_ELEM(m, pairs + i*pair_size), elems + i*m->member_size, m->member_size);
+	}
+
+	gerror_t g;
 
-	gerror_t g = rbtree_add(&m->map, pair);
+	if(m->backend == G_MAP_PERSISTENT)
+		g = prbtree_build_sorted(&m->data.persistent, pairs, n);
+	else
+		g = rbtree_build_sorted(&m->data.map, pairs, n);
 
-	free(pair);
+	free(pairs);
 	return g;
 }
 
@@ -118,15 +321,32 @@ gerror_t map_remove (struct map_t* m, void* key, void* elem)
 	if(!m) return GERROR_NULL_STRUCTURE;
 	if(!key) return GERROR_NULL_KEY;
 
+	if(m->backend == G_MAP_BTREE)
+		return btree_remove(&m->data.btree, key, elem);
+	if(m->backend == G_MAP_HASH)
+		return hashmap_remove(&m->data.hash, key, elem);
+
+	if(m->backend == G_MAP_PERSISTENT){
+		void* pair;
+		gerror_t g = prbtree_find(&m->data.persistent, key, &pair);
+		if(g != GERROR_OK)
+			return g;
+
+		if(elem)
+			memcpy(elem, MAP_ELEM(m, pair), m->member_size);
+
+		return prbtree_remove(&m->data.persistent, key);
+	}
+
 	rbnode_t* node;
-	gerror_t g = rbtree_find_node(&m->map, key, &node);
+	gerror_t g = rbtree_find_node(&m->data.map, key, &node);
 	if(g != GERROR_OK)
 		return g;
 
 	if(elem)
-		memcpy(elem, node->data + m->key_size, m->member_size);
+		memcpy(elem, MAP_ELEM(m, node->data), m->member_size);
 
-	return rbtree_remove_node(&m->map, node);
+	return rbtree_remove_node(&m->data.map, node);
 }
 
 /** Writes the elem mapped by `key` in the memory pointed by `elem`.
@@ -147,19 +367,86 @@ gerror_t map_at (struct map_t* m, void* key, void* elem)
 	if(!m) return GERROR_NULL_STRUCTURE;
 	if(!key) return GERROR_NULL_KEY;
 
+	if(m->backend == G_MAP_BTREE)
+		return btree_find(&m->data.btree, key, elem);
+	if(m->backend == G_MAP_HASH)
+		return hashmap_find(&m->data.hash, key, elem);
+
+	if(m->backend == G_MAP_PERSISTENT){
+		void* pair;
+		gerror_t g = prbtree_find(&m->data.persistent, key, &pair);
+		if(g != GERROR_OK)
+			return g;
+
+		if(elem)
+			memcpy(elem, MAP_ELEM(m, pair), m->member_size);
+
+		return GERROR_OK;
+	}
+
 	rbnode_t* node;
 
-	gerror_t g = rbtree_find_node(&m->map, key, &node);
+	gerror_t g = rbtree_find_node(&m->data.map, key, &node);
 	if(g != GERROR_OK)
 		return g;
 
 	if(elem && node && node->data)
-		memcpy(elem, node->data + m->key_size, m->member_size);
+		memcpy(elem, MAP_ELEM(m, node->data), m->member_size);
 
 	return GERROR_OK;
 }
 
-/** Set the default compare function of `m` keys.
+/** Writes in `elem` a pointer to the element mapped by `key`,
+  * stored in `m`, without copying it: lookups of large elements
+  * can read them in place. The pointer is aligned for the element
+  * type if its alignment is at most that of galign_t (long,
+  * double and void*); a long double may not be.
+  *
+  * The pointer is borrowed from `m`. With the G_MAP_RBTREE backend
+  * it is valid until the pair is removed or `m` is destroyed, since
+  * the nodes are never moved; with G_MAP_BTREE and G_MAP_HASH only
+  * until the next insert or remove in `m`, which may move the pairs.
+  * With G_MAP_PERSISTENT it is valid until the next change of `m`
+  * and the element must not be changed, since it may be shared
+  * with snapshots; use map_emplace to change it in place.
+  *
+  * @param m		pointer to a previous allocated `map_t` structure;
+  * @param key		pointer to the key
+  * @param elem		pointer to write the pointer to the element
+  *
+  * @see map_emplace
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `m` is null
+  * 		GERROR_NULL_KEY in case that `key` is null
+  * 		GERROR_NULL_RETURN_POINTER in case `elem` is null
+  * 		GERROR_ELEMENT_NOT_FOUNDED in case `key` is not in `m`;
+  * 		`*elem` is set to NULL
+  */
+gerror_t map_find_ptr (struct map_t* m, void* key, void** elem)
+{
+	if(!m) return GERROR_NULL_STRUCTURE;
+	if(!key) return GERROR_NULL_KEY;
+	if(!elem) return GERROR_NULL_RETURN_POINTER;
+
+	if(m->backend == G_MAP_BTREE)
+		return btree_find_ptr(&m->data.btree, key, elem);
+	if(m->backend == G_MAP_HASH)
+		return hashmap_find_ptr(&m->data.hash, key, elem);
+
+	void* pair;
+	gerror_t g = m->backend == G_MAP_PERSISTENT
+			? prbtree_find(&m->data.persistent, key, &pair)
+			: rbtree_find_ptr(&m->data.map, key, &pair);
+
+	*elem = g == GERROR_OK ? MAP_ELEM(m, pair) : NULL;
+
+	return g;
+}
+
+/** Set the default compare function of `m` keys. With the
+  * G_MAP_HASH backend only the equality is used and the hash
+  * function must agree with it; see map_set_hash_function.
   * TODO: A more datailed description of map_set_compare_function.
   *
   * @param m			pointer to a previous allocated `map_t` structure;
@@ -177,7 +464,14 @@ gerror_t map_set_compare_function (
 {
 	if(!m) return GERROR_NULL_STRUCTURE;
 
-	return rbtree_set_compare_function(&m->map, compare_function, arg);
+	if(m->backend == G_MAP_BTREE)
+		return btree_set_compare_function(&m->data.btree, compare_function, arg);
+	if(m->backend == G_MAP_HASH)
+		return hashmap_set_compare_function(&m->data.hash, compare_function, arg);
+	if(m->backend == G_MAP_PERSISTENT)
+		return prbtree_set_compare_function(&m->data.persistent, compare_function, arg);
+
+	return rbtree_set_compare_function(&m->data.map, compare_function, arg);
 }
 
 /** Get the pair key:value and write in memory pointed by
@@ -201,9 +495,28 @@ gerror_t map_get_pair (
 	if(!m) return GERROR_NULL_STRUCTURE;
 	if(!key) return GERROR_NULL_KEY;
 
+	if(m->backend == G_MAP_BTREE)
+		return btree_get_pair(&m->data.btree, key, rkey, relem);
+	if(m->backend == G_MAP_HASH)
+		return hashmap_get_pair(&m->data.hash, key, rkey, relem);
+
+	if(m->backend == G_MAP_PERSISTENT){
+		void* pair;
+		gerror_t g = prbtree_find(&m->data.persistent, key, &pair);
+		if(g != GERROR_OK)
+			return g;
+
+		if(rkey)
+			memcpy(rkey, pair, m->key_size);
+		if(relem)
+			memcpy(relem, MAP_ELEM(m, pair), m->member_size);
+
+		return GERROR_OK;
+	}
+
 	rbnode_t* node;
 
-	gerror_t g = rbtree_find_node(&m->map, key, &node);
+	gerror_t g = rbtree_find_node(&m->data.map, key, &node);
 	if(g != GERROR_OK)
 		return g;
 
@@ -211,11 +524,186 @@ gerror_t map_get_pair (
 		memcpy(rkey, node->data, m->key_size);
 
 	if(relem && node && node->data)
-		memcpy(relem, node->data + m->key_size, m->member_size);
+		memcpy(relem, MAP_ELEM(m, node->data), m->member_size);
+
+	return GERROR_OK;
+}
+
+/** Calls `function` for each pair of `m` with key in [`lo`, `hi`),
+  * in key order. The scan is O(log n + k) and does not allocate.
+  * The map must not be modified by `function`.
+  *
+  * @param m		pointer to a previous allocated `map_t` structure;
+  * @param lo		pointer to the smallest key of the range or NULL
+  * 			to start at the first key
+  * @param hi		pointer to the key ending the range (not included)
+  * 			or NULL to go until the last key
+  * @param function	function called for each pair; a non zero
+  * 			return stops the iteration
+  * @param arg		argument passed to `function`
+  *
+  * @see rbtree_lower_bound
+  * @see rbtree_next
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_ELEMENT_POINTER in case that `function` is null
+  * 		GERROR_UNSUPPORTED_OPERATION in case of the G_MAP_HASH backend
+  * 		GERROR_COMPARE_FUNCTION_WRONG_RETURN in case the
+  * 		compare function returns an invalid value
+  */
+gerror_t map_range (
+		struct map_t* m,
+		void* lo,
+		void* hi,
+		map_range_function function,
+		void* arg)
+{
+	if(!m) return GERROR_NULL_STRUCTURE;
+	if(!function) return GERROR_NULL_ELEMENT_POINTER;
+
+	if(m->backend == G_MAP_BTREE)
+		return btree_range(&m->data.btree, lo, hi, function, arg);
+	if(m->backend == G_MAP_HASH)
+		return GERROR_UNSUPPORTED_OPERATION;
+
+	if(m->backend == G_MAP_PERSISTENT){
+		map_range_t range;
+
+		range.function = function;
+		range.arg = arg;
+		range.elem_offset = MAP_ELEM_OFFSET(m);
+
+		return prbtree_range(&m->data.persistent, lo, hi, map_range_pair, &range);
+	}
+
+	rbtree_t* rbt = &m->data.map;
+	rbnode_t* node;
+
+	gerror_t g = lo ? rbtree_lower_bound(rbt, lo, &node) : rbtree_first(rbt, &node);
+	if(g != GERROR_OK)
+		return g == GERROR_EMPTY_STRUCTURE ? GERROR_OK : g;
+
+	while(node != NULL){
+		if(hi){
+			int c = rbt->compare(node->data, hi, rbt->compare_argument);
+			if(c != G_RB_FIRST_IS_SMALLER){
+				if(c != G_RB_EQUAL && c != G_RB_FIRST_IS_GREATER)
+					return GERROR_COMPARE_FUNCTION_WRONG_RETURN;
+				break;
+			}
+		}
+
+		if(function(node->data, MAP_ELEM(m, node->data), arg))
+			break;
+
+		rbtree_next(rbt, node, &node);
+	}
+
+	return GERROR_OK;
+}
+
+/** Calls `function` for each pair of `m`: in key order for the
+  * tree backends, in no particular order for G_MAP_HASH.
+  * The map must not be modified by `function`.
+  *
+  * @param m		pointer to a previous allocated `map_t` structure;
+  * @param function	function called for each pair; a non zero
+  * 			return stops the iteration
+  * @param arg		argument passed to `function`
+  *
+  * @see map_range
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_ELEMENT_POINTER in case that `function` is null
+  */
+gerror_t map_foreach (struct map_t* m, map_range_function function, void* arg)
+{
+	if(!m) return GERROR_NULL_STRUCTURE;
+
+	if(m->backend == G_MAP_HASH)
+		return hashmap_foreach(&m->data.hash, function, arg);
+
+	return map_range(m, NULL, NULL, function, arg);
+}
+
+/** Set the hash function of the keys of a map with the
+  * G_MAP_HASH backend; it must be set before the first insert.
+  * By default the bytes of the key are hashed.
+  *
+  * @param m		pointer to a previous allocated `map_t` structure;
+  * @param hash_function	hash function of the keys
+  * @param arg		argument to use in the hash function
+  *
+  * @see hashmap_set_hash_function
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_UNSUPPORTED_OPERATION in case `m` does not
+  * 		use the G_MAP_HASH backend
+  */
+gerror_t map_set_hash_function (
+		struct map_t* m,
+		hashmap_hash_function hash_function,
+		void* arg)
+{
+	if(!m) return GERROR_NULL_STRUCTURE;
+
+	if(m->backend != G_MAP_HASH)
+		return GERROR_UNSUPPORTED_OPERATION;
+
+	return hashmap_set_hash_function(&m->data.hash, hash_function, arg);
+}
+
+/** Writes in `snapshot` a map with the current pairs of `m`, in
+  * O(1); only for the G_MAP_PERSISTENT backend. The two maps
+  * share their nodes but are independent: both can be changed
+  * and must be destroyed with map_destroy. A snapshot can be read
+  * and destroyed by another thread while `m` is changed, but it
+  * must be taken by the thread that changes `m`.
+  *
+  * @param m		pointer to a previous allocated `map_t` structure;
+  * @param snapshot	pointer to a `map_t` structure, not created
+  *
+  * @see prbtree_snapshot
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_RETURN_POINTER in case that `snapshot` is null
+  * 		GERROR_UNSUPPORTED_OPERATION in case `m` does not
+  * 		use the G_MAP_PERSISTENT backend
+  */
+gerror_t map_snapshot (struct map_t* m, struct map_t* snapshot)
+{
+	if(!m) return GERROR_NULL_STRUCTURE;
+	if(!snapshot) return GERROR_NULL_RETURN_POINTER;
+
+	if(m->backend != G_MAP_PERSISTENT)
+		return GERROR_UNSUPPORTED_OPERATION;
+
+	*snapshot = *m;
+
+	gerror_t g = prbtree_snapshot(&m->data.persistent, &snapshot->data.persistent);
+	if(g != GERROR_OK)
+		return g;
+
+	/*
+	 * the default compare function reads the key size of the map
+	 */
+	if(m->data.persistent.compare_argument == m)
+		snapshot->data.persistent.compare_argument = snapshot;
 
 	return GERROR_OK;
 }
 
+/*
+ * calls the function of a map_range with the key
+ * and the element of a pair
+ */
+static int map_range_pair(void* pair, void* arg)
+{
+	map_range_t* range = (map_range_t*) arg;
+
+	return range->function(pair, (char*) pair + range->elem_offset, range->arg);
+}
+
 /*
  * default compare function of map
  * only work for ints, only look the keys
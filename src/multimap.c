@@ -0,0 +1,272 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ */
+#include "multimap.h"
+
+/*
+ * auxiliar function prototypes
+ */
+static int multimap_destroy_values(void* key, void* elem, void* arg);
+
+/** Creates a multimap of keys with size `key_size` mapped to
+  * elements with size `member_size` and populates the previous
+  * allocated structure `mm`. The keys are kept in a map_t with
+  * the default compare function of map.
+  *
+  * @param mm		pointer to a previous allocated `multimap_t` structure;
+  * @param key_size	size of the keys in bytes
+  * @param member_size	size of the elements in bytes
+  *
+  * @see map_create
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `mm` is null
+  */
+gerror_t multimap_create (struct multimap_t* mm, size_t key_size, size_t member_size)
+{
+	if(!mm) return GERROR_NULL_STRUCTURE;
+
+	mm->size = 0;
+	mm->key_size = key_size;
+	mm->member_size = member_size;
+
+	return map_create(&mm->map, key_size, sizeof(vector_t));
+}
+
+/** Destroys and deallocates the keys and the elements of `mm`.
+  *
+  * @param mm	pointer to a previous allocated `multimap_t` structure;
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `mm` is null
+  */
+gerror_t multimap_destroy (struct multimap_t* mm)
+{
+	if(!mm) return GERROR_NULL_STRUCTURE;
+
+	map_foreach(&mm->map, multimap_destroy_values, NULL);
+	mm->size = 0;
+
+	return map_destroy(&mm->map);
+}
+
+/** Set the compare function of the keys of `mm`; it must be set
+  * while `mm` is empty.
+  *
+  * @param mm			pointer to a previous allocated `multimap_t` structure;
+  * @param compare_function	compare function of the keys
+  * @param arg			argument to use in the compare function
+  *
+  * @see map_set_compare_function
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `mm` is null
+  */
+gerror_t multimap_set_compare_function (
+		struct multimap_t* mm,
+		rbtree_compare_function compare_function,
+		void* arg)
+{
+	if(!mm) return GERROR_NULL_STRUCTURE;
+
+	return map_set_compare_function(&mm->map, compare_function, arg);
+}
+
+/** Adds the element `elem` to the elements of the key `key` in `mm`,
+  * after the ones added before. The key is found or inserted with a
+  * single descent and the element is appended to its vector.
+  *
+  * @param mm	pointer to a previous allocated `multimap_t` structure;
+  * @param key	pointer to the key
+  * @param elem	pointer to the element to be copied or NULL
+  * 		to add an uninitialized element
+  *
+  * @see map_emplace
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `mm` is null
+  * 		GERROR_NULL_KEY in case that `key` is null
+  */
+gerror_t multimap_insert (struct multimap_t* mm, void* key, void* elem)
+{
+	if(!mm) return GERROR_NULL_STRUCTURE;
+	if(!key) return GERROR_NULL_KEY;
+
+	vector_t* values;
+	int inserted;
+	gerror_t g = map_emplace(&mm->map, key, (void**) &values, &inserted);
+
+	if(g != GERROR_OK)
+		return g;
+
+	if(inserted)
+		vector_create(values, 0, mm->member_size);
+
+	g = vector_add(values, elem);
+
+	mm->size++;
+
+	return g;
+}
+
+/** Removes the key `key` and all its elements from `mm`.
+  *
+  * @param mm	pointer to a previous allocated `multimap_t` structure;
+  * @param key	pointer to the key
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `mm` is null
+  * 		GERROR_NULL_KEY in case that `key` is null
+  * 		GERROR_ELEMENT_NOT_FOUNDED in case `key` is not in `mm`
+  */
+gerror_t multimap_remove (struct multimap_t* mm, void* key)
+{
+	if(!mm) return GERROR_NULL_STRUCTURE;
+	if(!key) return GERROR_NULL_KEY;
+
+	vector_t values;
+	gerror_t g = map_remove(&mm->map, key, &values);
+
+	if(g != GERROR_OK)
+		return g;
+
+	mm->size -= values.size;
+	vector_destroy(&values);
+
+	return GERROR_OK;
+}
+
+/** Writes in `count` the number of elements of the key `key`,
+  * zero if `key` is not in `mm`. O(log n).
+  *
+  * @param mm		pointer to a previous allocated `multimap_t` structure;
+  * @param key		pointer to the key
+  * @param count	pointer to write the number of elements
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `mm` is null
+  * 		GERROR_NULL_KEY in case that `key` is null
+  * 		GERROR_NULL_RETURN_POINTER in case `count` is null
+  */
+gerror_t multimap_count (struct multimap_t* mm, void* key, size_t* count)
+{
+	if(!mm) return GERROR_NULL_STRUCTURE;
+	if(!key) return GERROR_NULL_KEY;
+	if(!count) return GERROR_NULL_RETURN_POINTER;
+
+	vector_t* values;
+
+	if(map_find_ptr(&mm->map, key, (void**) &values) == GERROR_OK)
+		*count = values->size;
+	else
+		*count = 0;
+
+	return GERROR_OK;
+}
+
+/** Writes in `elems` a pointer to the elements of the key `key`,
+  * contiguous and in insertion order, and their number in `count`,
+  * so they can be read in place. The pointer is valid until the
+  * next insert or remove at `key`, or until `mm` is destroyed.
+  *
+  * @param mm		pointer to a previous allocated `multimap_t` structure;
+  * @param key		pointer to the key
+  * @param elems	pointer to write the pointer to the first element
+  * @param count	pointer to write the number of elements
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `mm` is null
+  * 		GERROR_NULL_KEY in case that `key` is null
+  * 		GERROR_NULL_RETURN_POINTER in case `elems` or `count` is null
+  * 		GERROR_ELEMENT_NOT_FOUNDED in case `key` is not in `mm`;
+  * 		`*elems` is set to NULL and `*count` to zero
+  */
+gerror_t multimap_values (struct multimap_t* mm, void* key, void** elems, size_t* count)
+{
+	if(!mm) return GERROR_NULL_STRUCTURE;
+	if(!key) return GERROR_NULL_KEY;
+	if(!elems || !count) return GERROR_NULL_RETURN_POINTER;
+
+	vector_t* values;
+	gerror_t g = map_find_ptr(&mm->map, key, (void**) &values);
+
+	if(g != GERROR_OK){
+		*elems = NULL;
+		*count = 0;
+		return g;
+	}
+
+	*elems = values->data;
+	*count = values->size;
+
+	return GERROR_OK;
+}
+
+/** Calls `function` for each element of the key `key`, in insertion
+  * order, with `key`, the element and `arg`.
+  * O(log n + k) for `k` elements, which are contiguous in memory.
+  * The multimap must not be modified by `function`.
+  *
+  * @param mm		pointer to a previous allocated `multimap_t` structure;
+  * @param key		pointer to the key
+  * @param function	function called for each element; a non zero
+  * 			return stops the iteration
+  * @param arg		argument passed to `function`
+  *
+  * @return	GERROR_OK in case of success; also if `key` is not in `mm`
+  * 		GERROR_NULL_STRUCTURE in case `mm` is null
+  * 		GERROR_NULL_KEY in case that `key` is null
+  * 		GERROR_NULL_ELEMENT_POINTER in case that `function` is null
+  */
+gerror_t multimap_equal_range (
+		struct multimap_t* mm,
+		void* key,
+		map_range_function function,
+		void* arg)
+{
+	if(!mm) return GERROR_NULL_STRUCTURE;
+	if(!key) return GERROR_NULL_KEY;
+	if(!function) return GERROR_NULL_ELEMENT_POINTER;
+
+	vector_t* values;
+	size_t i;
+
+	if(map_find_ptr(&mm->map, key, (void**) &values) != GERROR_OK)
+		return GERROR_OK;
+
+	char* elem = (char*) values->data;
+
+	for(i = 0; i < values->size; i++, elem += mm->member_size)
+		if(function(key, elem, arg))
+			break;
+
+	return GERROR_OK;
+}
+
+/*
+ * destroys the vector of a key
+ */
+static int multimap_destroy_values(void* key, void* elem, void* arg)
+{
+	(void) key;
+	(void) arg;
+
+	vector_destroy((vector_t*) elem);
+
+	return 0;
+}
@@ -0,0 +1,782 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ */
+
+#include "persistent_rbtree.h"
+
+#define PRB_NODE_SIZE(t) (RBNODE_OFFSET(sizeof(prbnode_t)) + (t)->member_size)
+
+/*
+ * auxiliar function prototypes
+ */
+static prbnode_t* pbnode_create(prbtree_t* t, void* elem, size_t size);
+static prbnode_t* pbnode_own(prbtree_t* t, prbnode_t* node);
+static void pbnode_release(prbnode_t* node);
+static int pbnode_is_red(prbnode_t* node);
+static prbnode_t* pbnode_rotate_left(prbtree_t* t, prbnode_t* node);
+static prbnode_t* pbnode_rotate_right(prbtree_t* t, prbnode_t* node);
+static void pbnode_flip(prbtree_t* t, prbnode_t* node);
+static prbnode_t* pbnode_balance(prbtree_t* t, prbnode_t* node);
+static prbnode_t* pbnode_move_red_left(prbtree_t* t, prbnode_t* node);
+static prbnode_t* pbnode_move_red_right(prbtree_t* t, prbnode_t* node);
+static prbnode_t* pbnode_insert(	prbtree_t* t,
+					prbnode_t* node,
+					void* elem,
+					size_t size,
+					int* added,
+					void** found);
+static prbnode_t* pbnode_remove_min(prbtree_t* t, prbnode_t* node);
+static prbnode_t* pbnode_remove(prbtree_t* t, prbnode_t* node, void* elem);
+static prbnode_t* pbnode_build(prbtree_t* t, char** elems, size_t n, size_t height);
+static size_t pbnode_build_max(size_t height);
+static int pbnode_range(	prbtree_t* t,
+				prbnode_t* node,
+				void* lo,
+				void* hi,
+				prbtree_range_function function,
+				void* arg);
+
+/** Creates a persistent red-black tree of elements with size
+  * `member_size` and populates the previous allocated structure `t`.
+  * The default compare function only works for char, int and long;
+  * see prbtree_set_compare_function.
+  *
+  * @param t		pointer to a previous allocated `prbtree_t` structure;
+  * @param member_size	size of the elements in bytes
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `t` is null
+  */
+gerror_t prbtree_create (struct prbtree_t* t, size_t member_size)
+{
+	if(!t) return GERROR_NULL_STRUCTURE;
+
+	t->size = 0;
+	t->member_size = member_size;
+	t->compare = prbtree_default_compare_function;
+	t->compare_argument = &(t->member_size);
+	t->root = NULL;
+
+	return GERROR_OK;
+}
+
+/** Destroys the version `t` of the tree; the nodes shared with
+  * other versions are kept until their last version is destroyed.
+  *
+  * @param t	pointer to a previous allocated `prbtree_t` structure;
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `t` is null
+  */
+gerror_t prbtree_destroy (struct prbtree_t* t)
+{
+	if(!t) return GERROR_NULL_STRUCTURE;
+
+	pbnode_release(t->root);
+
+	t->root = NULL;
+	t->size = 0;
+
+	return GERROR_OK;
+}
+
+/** Change the compare function of `t`; same protocol of
+  * rbtree_set_compare_function.
+  *
+  * @param t		pointer to a previous allocated `prbtree_t` structure;
+  * @param function	compare function or NULL for the default one
+  * @param argument	pointer to the argument to the compare function
+  *
+  * @see rbtree_set_compare_function
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `t` is null
+  */
+gerror_t prbtree_set_compare_function(
+		struct prbtree_t* t,
+		rbtree_compare_function function,
+		void* argument)
+{
+	if(!t) return GERROR_NULL_STRUCTURE;
+
+	if(!function){
+		t->compare = prbtree_default_compare_function;
+		t->compare_argument = &(t->member_size);
+		return GERROR_OK;
+	}
+
+	t->compare = function;
+	t->compare_argument = argument;
+
+	return GERROR_OK;
+}
+
+/** Adds a copy of `elem` to `t`, replacing an equal element.
+  * The nodes of the path shared with other versions are copied.
+  *
+  * @param t	pointer to a previous allocated `prbtree_t` structure;
+  * @param elem	pointer to the element
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `t` is null
+  * 		GERROR_NULL_ELEMENT_POINTER in case `elem` is null
+  */
+gerror_t prbtree_add (struct prbtree_t* t, void* elem)
+{
+	if(!t) return GERROR_NULL_STRUCTURE;
+	if(!elem) return GERROR_NULL_ELEMENT_POINTER;
+
+	int added = 0;
+
+	t->root = pbnode_insert(t, t->root, elem, t->member_size, &added, NULL);
+	t->root->color = G_RB_BLACK;
+	t->size += added;
+
+	return GERROR_OK;
+}
+
+/** Builds `t` from the `n` elements of `buffer`, sorted by the
+  * compare function of `t`, in O(n): the nodes are linked as a
+  * left leaning red-black tree directly, without comparisons beyond
+  * the order check and without rotations or copies. Each subtree is
+  * made of black nodes with, where they do not fit, a red left
+  * child, so all paths have the same number of black nodes.
+  * The last of each run of equal elements is kept.
+  * If `t` is not empty, the elements are added one by one.
+  *
+  * @param t		pointer to a previous allocated `prbtree_t` structure;
+  * @param buffer	pointer to `n` elements of `member_size` bytes
+  * @param n		number of elements in `buffer`
+  *
+  * @see rbtree_build_sorted
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `t` is null
+  * 		GERROR_NULL_POINTER_TO_BUFFER in case `buffer` is null
+  * 		GERROR_UNSORTED_ELEMENTS in case `buffer` is not sorted,
+  * 		`t` is not changed
+  * 		GERROR_COMPARE_FUNCTION_WRONG_RETURN in case the
+  * 		compare function returns an invalid value
+  */
+gerror_t prbtree_build_sorted (struct prbtree_t* t, void* buffer, size_t n)
+{
+	if(!t) return GERROR_NULL_STRUCTURE;
+	if(!n) return GERROR_OK;
+	if(!buffer) return GERROR_NULL_POINTER_TO_BUFFER;
+
+	char* elems = (char*) buffer;
+	size_t i, j, count = 1;
+
+	/*
+	 * check the order and count the distinct elements
+	 */
+	for(i = 1; i < n; i++){
+		int c = t->compare(	elems + (i - 1)*t->member_size,
+					elems + i*t->member_size,
+					t->compare_argument);
+
+		if(c == G_RB_FIRST_IS_GREATER)
+			return GERROR_UNSORTED_ELEMENTS;
+		if(c != G_RB_FIRST_IS_SMALLER && c != G_RB_EQUAL)
+			return GERROR_COMPARE_FUNCTION_WRONG_RETURN;
+
+		if(c == G_RB_FIRST_IS_SMALLER)
+			count++;
+	}
+
+	if(t->size){
+		for(i = 0; i < n; i++){
+			gerror_t g = prbtree_add(t, elems + i*t->member_size);
+			if(g != GERROR_OK)
+				return g;
+		}
+		return GERROR_OK;
+	}
+
+	/*
+	 * the last element of each run of equal ones
+	 */
+	char** distinct = (char**) malloc(count*sizeof(char*));
+
+	for(i = 0, j = 0; i < n; i++)
+		if(i + 1 == n || t->compare(	elems + i*t->member_size,
+						elems + (i + 1)*t->member_size,
+						t->compare_argument) != G_RB_EQUAL)
+			distinct[j++] = elems + i*t->member_size;
+
+	/*
+	 * the black height is the largest `h` with
+	 * 2^h - 1 <= count, the size of a tree of 2-nodes
+	 */
+	size_t height = 0;
+	while(height + 1 < sizeof(size_t)*8 && ((size_t) 1 << (height + 1)) - 1 <= count)
+		height++;
+
+	t->root = pbnode_build(t, distinct, count, height);
+	t->size = count;
+
+	free(distinct);
+
+	return GERROR_OK;
+}
+
+/** Finds the element equal to `elem` or, if there is none, adds an
+  * element with the first `size` bytes of `elem` and zeros in the
+  * rest, and writes in `found` a pointer to it. The compare function
+  * must only read the first `size` bytes of its first argument. The
+  * nodes of the path are copied if shared, so the element belongs
+  * only to `t` and can be changed in place, as long as its order is
+  * not changed, until the next add, remove or snapshot of `t`.
+  *
+  * @param t		pointer to a previous allocated `prbtree_t` structure;
+  * @param elem		pointer to the first `size` bytes of an element
+  * @param size		number of bytes of `elem`, at most `member_size`
+  * @param found	pointer to write the pointer to the element
+  * @param inserted	pointer to write 1 if the element was added and
+  * 			0 if it was found, or NULL
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `t` is null
+  * 		GERROR_NULL_ELEMENT_POINTER in case `elem` is null
+  * 		GERROR_NULL_RETURN_POINTER in case `found` is null
+  * 		GERROR_ACCESS_OUT_OF_BOUND in case `size` is greater
+  * 		than `member_size`
+  */
+gerror_t prbtree_emplace (struct prbtree_t* t, void* elem, size_t size, void** found, int* inserted)
+{
+	if(!t) return GERROR_NULL_STRUCTURE;
+	if(!elem) return GERROR_NULL_ELEMENT_POINTER;
+	if(!found) return GERROR_NULL_RETURN_POINTER;
+	if(size > t->member_size) return GERROR_ACCESS_OUT_OF_BOUND;
+
+	int added = 0;
+
+	t->root = pbnode_insert(t, t->root, elem, size, &added, found);
+	t->root->color = G_RB_BLACK;
+	t->size += added;
+
+	if(inserted)
+		*inserted = added;
+
+	return GERROR_OK;
+}
+
+/** Removes the element equal to `elem` from `t`. The nodes of
+  * the path shared with other versions are copied.
+  *
+  * @param t	pointer to a previous allocated `prbtree_t` structure;
+  * @param elem	pointer to the element
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `t` is null
+  * 		GERROR_NULL_ELEMENT_POINTER in case `elem` is null
+  * 		GERROR_REMOVE_ELEMENT_NOT_FOUNDED in case there is
+  * 		no element equal to `elem`
+  */
+gerror_t prbtree_remove (struct prbtree_t* t, void* elem)
+{
+	if(!t) return GERROR_NULL_STRUCTURE;
+	if(!elem) return GERROR_NULL_ELEMENT_POINTER;
+
+	void* found;
+
+	/*
+	 * the removal assumes the element is in the tree
+	 */
+	if(prbtree_find(t, elem, &found) != GERROR_OK)
+		return GERROR_REMOVE_ELEMENT_NOT_FOUNDED;
+
+	t->root = pbnode_own(t, t->root);
+	if(!pbnode_is_red(t->root->left) && !pbnode_is_red(t->root->right))
+		t->root->color = G_RB_RED;
+
+	t->root = pbnode_remove(t, t->root, elem);
+	if(t->root)
+		t->root->color = G_RB_BLACK;
+	t->size--;
+
+	return GERROR_OK;
+}
+
+/** Finds the element equal to `elem` and writes in `found` a
+  * pointer to it. The element may be shared with other versions
+  * and must not be modified; the pointer is valid until the next
+  * add or remove in `t` or until `t` is destroyed.
+  *
+  * @param t		pointer to a previous allocated `prbtree_t` structure;
+  * @param elem		pointer to the element to find
+  * @param found	pointer to write the pointer to the element
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `t` is null
+  * 		GERROR_NULL_ELEMENT_POINTER in case `elem` is null
+  * 		GERROR_NULL_RETURN_POINTER in case `found` is null
+  * 		GERROR_ELEMENT_NOT_FOUNDED in case there is no
+  * 		element equal to `elem`; `*found` is set to NULL
+  */
+gerror_t prbtree_find (struct prbtree_t* t, void* elem, void** found)
+{
+	if(!t) return GERROR_NULL_STRUCTURE;
+	if(!elem) return GERROR_NULL_ELEMENT_POINTER;
+	if(!found) return GERROR_NULL_RETURN_POINTER;
+
+	prbnode_t* node = t->root;
+
+	while(node != NULL){
+		int c = t->compare(elem, PRBNODE_DATA(node), t->compare_argument);
+
+		if(c == G_RB_EQUAL){
+			*found = PRBNODE_DATA(node);
+			return GERROR_OK;
+		}
+
+		node = c == G_RB_FIRST_IS_SMALLER ? node->left : node->right;
+	}
+
+	*found = NULL;
+	return GERROR_ELEMENT_NOT_FOUNDED;
+}
+
+/** Writes in `snapshot` a version of `t` with its current elements,
+  * in O(1). The versions share their nodes and are independent:
+  * both can be changed and must be destroyed with prbtree_destroy.
+  * A snapshot can be read and destroyed by another thread while
+  * `t` is changed, but the snapshot must be taken by the thread
+  * that changes `t`.
+  *
+  * @param t		pointer to a previous allocated `prbtree_t` structure;
+  * @param snapshot	pointer to a `prbtree_t` structure, not created
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `t` is null
+  * 		GERROR_NULL_RETURN_POINTER in case `snapshot` is null
+  */
+gerror_t prbtree_snapshot (struct prbtree_t* t, struct prbtree_t* snapshot)
+{
+	if(!t) return GERROR_NULL_STRUCTURE;
+	if(!snapshot) return GERROR_NULL_RETURN_POINTER;
+
+	*snapshot = *t;
+
+	if(t->compare_argument == &t->member_size)
+		snapshot->compare_argument = &snapshot->member_size;
+
+	if(t->root)
+		__atomic_add_fetch(&t->root->refs, 1, __ATOMIC_RELAXED);
+
+	return GERROR_OK;
+}
+
+/** Calls `function` for each element of `t` in [`lo`, `hi`), in
+  * order, in O(log n + k). `t` must not be changed by `function`.
+  *
+  * @param t		pointer to a previous allocated `prbtree_t` structure;
+  * @param lo		pointer to the smallest element of the range or
+  * 			NULL to start at the first element
+  * @param hi		pointer to the element ending the range (not
+  * 			included) or NULL to go until the last element
+  * @param function	function called for each element; a non zero
+  * 			return stops the iteration
+  * @param arg		argument passed to `function`
+  *
+  * @return	GERROR_OK in case of success
+  * 		GERROR_NULL_STRUCTURE in case `t` is null
+  * 		GERROR_NULL_ELEMENT_POINTER in case `function` is null
+  */
+gerror_t prbtree_range(
+		struct prbtree_t* t,
+		void* lo,
+		void* hi,
+		prbtree_range_function function,
+		void* arg)
+{
+	if(!t) return GERROR_NULL_STRUCTURE;
+	if(!function) return GERROR_NULL_ELEMENT_POINTER;
+
+	pbnode_range(t, t->root, lo, hi, function, arg);
+
+	return GERROR_OK;
+}
+
+/*
+ * allocates a red node with a copy of the first `size`
+ * bytes of `elem` and zeros in the rest
+ */
+static prbnode_t* pbnode_create(prbtree_t* t, void* elem, size_t size)
+{
+	prbnode_t* node = (prbnode_t*) malloc(PRB_NODE_SIZE(t));
+
+	node->refs = 1;
+	node->left = NULL;
+	node->right = NULL;
+	node->color = G_RB_RED;
+	memcpy(PRBNODE_DATA(node), elem, size);
+	memset((char*) PRBNODE_DATA(node) + size, 0, t->member_size - size);
+
+	return node;
+}
+
+/*
+ * links the `n` elements of `elems` as a subtree with `height`
+ * black nodes in each path, which holds between 2^height - 1
+ * elements, all in black 2-nodes, and 3^height - 1, all in
+ * 3-nodes: a black node with a red left child. The root is a
+ * 2-node if the rest fits in two subtrees of `height` - 1,
+ * otherwise a 3-node; the elements are split evenly among the
+ * subtrees, so each is in the range of `height` - 1
+ */
+static prbnode_t* pbnode_build(prbtree_t* t, char** elems, size_t n, size_t height)
+{
+	if(n == 0)
+		return NULL;
+
+	size_t max = pbnode_build_max(height - 1);
+	prbnode_t* node;
+
+	if(n - 1 - (n - 1)/2 <= max){
+		size_t a = (n - 1)/2;
+
+		node = pbnode_create(t, elems[a], t->member_size);
+		node->left = pbnode_build(t, elems, a, height - 1);
+		node->right = pbnode_build(t, elems + a + 1, n - 1 - a, height - 1);
+	}else{
+		size_t a = (n - 2)/3;
+		size_t b = (n - 2 - a)/2;
+		size_t c = n - 2 - a - b;
+
+		prbnode_t* red = pbnode_create(t, elems[a], t->member_size);
+		red->left = pbnode_build(t, elems, a, height - 1);
+		red->right = pbnode_build(t, elems + a + 1, b, height - 1);
+
+		node = pbnode_create(t, elems[a + 1 + b], t->member_size);
+		node->left = red;
+		node->right = pbnode_build(t, elems + a + b + 2, c, height - 1);
+	}
+
+	node->color = G_RB_BLACK;
+
+	return node;
+}
+
+/*
+ * the largest number of elements of a subtree with `height`
+ * black nodes in each path, 3^height - 1, or SIZE_MAX if it
+ * does not fit
+ */
+static size_t pbnode_build_max(size_t height)
+{
+	size_t max = 1;
+
+	while(height--){
+		if(max > ((size_t) -1)/3)
+			return (size_t) -1;
+		max *= 3;
+	}
+
+	return max - 1;
+}
+
+/*
+ * returns a node that can be changed in place: `node` itself
+ * when it has a single reference, otherwise a copy of it,
+ * which takes the reference of the caller to `node`
+ */
+static prbnode_t* pbnode_own(prbtree_t* t, prbnode_t* node)
+{
+	if(__atomic_load_n(&node->refs, __ATOMIC_ACQUIRE) == 1)
+		return node;
+
+	prbnode_t* copy = (prbnode_t*) malloc(PRB_NODE_SIZE(t));
+	memcpy(copy, node, PRB_NODE_SIZE(t));
+	copy->refs = 1;
+
+	if(copy->left)
+		__atomic_add_fetch(&copy->left->refs, 1, __ATOMIC_RELAXED);
+	if(copy->right)
+		__atomic_add_fetch(&copy->right->refs, 1, __ATOMIC_RELAXED);
+
+	pbnode_release(node);
+
+	return copy;
+}
+
+/*
+ * drops a reference to `node`, freeing it and
+ * releasing its children with the last one
+ */
+static void pbnode_release(prbnode_t* node)
+{
+	if(!node || __atomic_sub_fetch(&node->refs, 1, __ATOMIC_ACQ_REL) != 0)
+		return;
+
+	pbnode_release(node->left);
+	pbnode_release(node->right);
+	free(node);
+}
+
+static int pbnode_is_red(prbnode_t* node)
+{
+	return node != NULL && node->color == G_RB_RED;
+}
+
+/*
+ * the rotations and the color flip change the children
+ * of `node`, so they are owned first; `node` is owned
+ * by the caller
+ */
+static prbnode_t* pbnode_rotate_left(prbtree_t* t, prbnode_t* node)
+{
+	prbnode_t* x = pbnode_own(t, node->right);
+
+	node->right = x->left;
+	x->left = node;
+	x->color = node->color;
+	node->color = G_RB_RED;
+
+	return x;
+}
+
+static prbnode_t* pbnode_rotate_right(prbtree_t* t, prbnode_t* node)
+{
+	prbnode_t* x = pbnode_own(t, node->left);
+
+	node->left = x->right;
+	x->right = node;
+	x->color = node->color;
+	node->color = G_RB_RED;
+
+	return x;
+}
+
+static void pbnode_flip(prbtree_t* t, prbnode_t* node)
+{
+	node->left = pbnode_own(t, node->left);
+	node->right = pbnode_own(t, node->right);
+
+	node->color = node->color == G_RB_RED ? G_RB_BLACK : G_RB_RED;
+	node->left->color = node->left->color == G_RB_RED ? G_RB_BLACK : G_RB_RED;
+	node->right->color = node->right->color == G_RB_RED ? G_RB_BLACK : G_RB_RED;
+}
+
+/*
+ * restores the left leaning invariants on the way up
+ */
+static prbnode_t* pbnode_balance(prbtree_t* t, prbnode_t* node)
+{
+	if(pbnode_is_red(node->right) && !pbnode_is_red(node->left))
+		node = pbnode_rotate_left(t, node);
+	if(pbnode_is_red(node->left) && pbnode_is_red(node->left->left))
+		node = pbnode_rotate_right(t, node);
+	if(pbnode_is_red(node->left) && pbnode_is_red(node->right))
+		pbnode_flip(t, node);
+
+	return node;
+}
+
+/*
+ * makes the left child or one of its children red
+ */
+static prbnode_t* pbnode_move_red_left(prbtree_t* t, prbnode_t* node)
+{
+	pbnode_flip(t, node);
+
+	if(pbnode_is_red(node->right->left)){
+		node->right = pbnode_rotate_right(t, node->right);
+		node = pbnode_rotate_left(t, node);
+		pbnode_flip(t, node);
+	}
+
+	return node;
+}
+
+/*
+ * makes the right child or one of its children red
+ */
+static prbnode_t* pbnode_move_red_right(prbtree_t* t, prbnode_t* node)
+{
+	pbnode_flip(t, node);
+
+	if(pbnode_is_red(node->left->left)){
+		node = pbnode_rotate_right(t, node);
+		pbnode_flip(t, node);
+	}
+
+	return node;
+}
+
+/*
+ * inserts `elem` in the subtree of `node` and returns its
+ * new root; `added` is set when no element was replaced.
+ * With `found` an equal element is not replaced and `found`
+ * is set to the owned element, equal or added
+ */
+static prbnode_t* pbnode_insert(	prbtree_t* t,
+					prbnode_t* node,
+					void* elem,
+					size_t size,
+					int* added,
+					void** found)
+{
+	if(!node){
+		*added = 1;
+		node = pbnode_create(t, elem, size);
+		if(found)
+			*found = PRBNODE_DATA(node);
+		return node;
+	}
+
+	node = pbnode_own(t, node);
+
+	int c = t->compare(elem, PRBNODE_DATA(node), t->compare_argument);
+
+	if(c == G_RB_FIRST_IS_SMALLER)
+		node->left = pbnode_insert(t, node->left, elem, size, added, found);
+	else if(c == G_RB_FIRST_IS_GREATER)
+		node->right = pbnode_insert(t, node->right, elem, size, added, found);
+	else if(found)
+		*found = PRBNODE_DATA(node);
+	else
+		memcpy(PRBNODE_DATA(node), elem, t->member_size);
+
+	return pbnode_balance(t, node);
+}
+
+/*
+ * removes the minimum of the subtree of the owned `node`
+ */
+static prbnode_t* pbnode_remove_min(prbtree_t* t, prbnode_t* node)
+{
+	if(!node->left){
+		pbnode_release(node);
+		return NULL;
+	}
+
+	if(!pbnode_is_red(node->left) && !pbnode_is_red(node->left->left))
+		node = pbnode_move_red_left(t, node);
+
+	node->left = pbnode_remove_min(t, pbnode_own(t, node->left));
+
+	return pbnode_balance(t, node);
+}
+
+/*
+ * removes `elem`, which is in the subtree of the owned `node`,
+ * keeping a red node in the path as it goes down
+ */
+static prbnode_t* pbnode_remove(prbtree_t* t, prbnode_t* node, void* elem)
+{
+	if(t->compare(elem, PRBNODE_DATA(node), t->compare_argument) == G_RB_FIRST_IS_SMALLER){
+		if(!pbnode_is_red(node->left) && !pbnode_is_red(node->left->left))
+			node = pbnode_move_red_left(t, node);
+
+		node->left = pbnode_remove(t, pbnode_own(t, node->left), elem);
+		return pbnode_balance(t, node);
+	}
+
+	if(pbnode_is_red(node->left))
+		node = pbnode_rotate_right(t, node);
+
+	if(t->compare(elem, PRBNODE_DATA(node), t->compare_argument) == G_RB_EQUAL && !node->right){
+		pbnode_release(node);
+		return NULL;
+	}
+
+	if(!pbnode_is_red(node->right) && !pbnode_is_red(node->right->left))
+		node = pbnode_move_red_right(t, node);
+
+	if(t->compare(elem, PRBNODE_DATA(node), t->compare_argument) == G_RB_EQUAL){
+		/*
+		 * replaces the element by its successor,
+		 * which is removed from the right subtree
+		 */
+		prbnode_t* min = node->right;
+		while(min->left)
+			min = min->left;
+
+		memcpy(PRBNODE_DATA(node), PRBNODE_DATA(min), t->member_size);
+		node->right = pbnode_remove_min(t, pbnode_own(t, node->right));
+	}else{
+		node->right = pbnode_remove(t, pbnode_own(t, node->right), elem);
+	}
+
+	return pbnode_balance(t, node);
+}
+
+/*
+ * in order walk of the elements in [lo, hi), skipping
+ * the subtrees out of the range
+ */
+static int pbnode_range(	prbtree_t* t,
+				prbnode_t* node,
+				void* lo,
+				void* hi,
+				prbtree_range_function function,
+				void* arg)
+{
+	while(node != NULL){
+		void* data = PRBNODE_DATA(node);
+
+		if(lo && t->compare(data, lo, t->compare_argument) == G_RB_FIRST_IS_SMALLER){
+			node = node->right;
+			continue;
+		}
+
+		if(hi && t->compare(data, hi, t->compare_argument) != G_RB_FIRST_IS_SMALLER){
+			node = node->left;
+			continue;
+		}
+
+		if(pbnode_range(t, node->left, lo, NULL, function, arg))
+			return 1;
+		if(function(data, arg))
+			return 1;
+
+		lo = NULL;
+		node = node->right;
+	}
+
+	return 0;
+}
+
+/*
+ * the default comparison function. Just compare
+ * like to long
+ */
+int prbtree_default_compare_function(void* a, void* b, void* arg)
+{
+	size_t size = *(size_t*)arg;
+
+	long la = 0;
+	long lb = 0;
+
+	switch(size){
+	case sizeof(int):
+		la = *(int*)a;
+		lb = *(int*)b;
+		break;
+	case sizeof(char):
+		la = *(char*)a;
+		lb = *(char*)b;
+		break;
+	case sizeof(long):
+		la = *(long*)a;
+		lb = *(long*)b;
+		break;
+	}
+	return (la > lb) - (la < lb);
+}
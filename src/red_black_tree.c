@@ -17,6 +17,7 @@
  * For more information, please refer to <http://unlicense.org/>
  */
 
+#include <pthread.h>
 #include "red_black_tree.h"
 
 typedef enum{
@@ -24,17 +25,102 @@ typedef enum{
 	RB_RIGHT
 } rbc_t ;
 
+/*
+ * a detached subtree with a black root and its black height,
+ * which is kept along join and split so that they do not
+ * need to walk the subtree to find it
+ */
+typedef struct rbsub_t {
+	rbnode_t* root;
+	size_t height;
+} rbsub_t;
+
+/*
+ * a branch of a set operation run by another thread
+ */
+typedef struct rbset_task_t {
+	rbtree_t* rbt;
+	rbsub_t a;
+	rbsub_t b;
+	rbset_op_t op;
+	size_t nthreads;
+	size_t freed;
+	rbsub_t result;
+} rbset_task_t;
+
 rbnode_t* rbnode_destroy(rbnode_t* node);
 
 /*
  * auxiliar function prototypes to insert
  */
 static void rbtree_insert_fixup(rbtree_t* rbt, rbnode_t* node);
+static void rbtree_insert_rebalance(rbtree_t* rbt, rbnode_t* node);
 static void fix_insert_case(rbtree_t* rbt, rbnode_t** node, rbnode_t* uncle, int c, int l);
 static rbnode_t* create_node(rbtree_t* rbt, void* elem);
+static void rbtree_link(rbtree_t* rbt, rbnode_t* parent, int right, rbnode_t* node);
+static void rbnode_free(rbnode_t* node);
 static void left_rotate(rbtree_t* rbt, rbnode_t* node);
 static void right_rotate(rbtree_t* rbt, rbnode_t* node);
 
+/*
+ * auxiliar function prototypes to keep the subtree counts
+ */
+static size_t rbnode_count(rbnode_t* node);
+static void rbnode_count_path(rbnode_t* node, int delta);
+static size_t rbnode_recount(rbnode_t* node);
+
+/*
+ * auxiliar function prototypes to keep the augmented data
+ */
+static void rbnode_augment(rbtree_t* rbt, rbnode_t* node);
+static void rbnode_augment_path(rbtree_t* rbt, rbnode_t* node);
+static void rbnode_augment_all(rbtree_t* rbt, rbnode_t* node);
+
+/*
+ * auxiliar function prototypes to build from sorted elements
+ */
+static rbnode_t* rbtree_build_range(	char* base,
+					size_t stride,
+					size_t lo,
+					size_t hi,
+					size_t depth,
+					size_t red_depth,
+					rbnode_t* parent);
+
+/*
+ * auxiliar function prototypes to join and split
+ */
+static void rbnode_update(rbtree_t* rbt, rbnode_t* node);
+static size_t rbnode_black_height(rbnode_t* node);
+static rbnode_t* rbnode_successor(rbnode_t* node);
+static size_t rbnode_free_all(rbnode_t* node);
+static rbsub_t rbsub_create(rbnode_t* root);
+static void rbsub_expose(rbsub_t t, rbsub_t* left, rbnode_t** node, rbsub_t* right);
+static rbsub_t rbsub_join(rbtree_t* rbt, rbsub_t left, rbnode_t* node, rbsub_t right);
+static rbsub_t rbsub_join2(rbtree_t* rbt, rbsub_t left, rbsub_t right);
+static rbsub_t rbsub_split_min(rbtree_t* rbt, rbsub_t t, rbnode_t** min);
+static void rbsub_split(	rbtree_t* rbt,
+				rbsub_t t,
+				void* key,
+				rbsub_t* left,
+				rbnode_t** node,
+				rbsub_t* right);
+static void rbsub_split_below(	rbtree_t* rbt,
+				rbsub_t t,
+				void* key,
+				rbsub_t* left,
+				rbsub_t* right);
+static rbsub_t rbsub_set_operation(	rbtree_t* rbt,
+					rbsub_t a,
+					rbsub_t b,
+					rbset_op_t op,
+					size_t nthreads,
+					size_t* freed);
+static void* rbsub_set_operation_thread(void* arg);
+static void rbtree_share_blocks(rbtree_t* from, rbtree_t* to);
+static void rbtree_move_blocks(rbtree_t* from, rbtree_t* to);
+static void rbtree_split_sizes(rbtree_t* left, rbtree_t* right, size_t size);
+
 /*
  * auxiliar function prototypes to delete
  */
@@ -43,6 +129,11 @@ void rbtree_delete_fixup(rbtree_t* rbt, rbnode_t* node);
 int rbtree_identify_case(rbnode_t* node, rbc_t* side);
 rbnode_t* rbtree_create_double_black();
 rbnode_t* rbtree_find_minimal_node(rbnode_t* node);
+
+/*
+ * auxiliar function prototypes to search
+ */
+static gerror_t rbtree_bound(rbtree_t* rbt, void* elem, rbnode_t** node, int inclusive);
 void rbtree_remove_double_black(rbtree_t* rbt, rbnode_t* db);
 int rbnode_is_red(rbnode_t* node);
 int rbnode_is_black(rbnode_t* node);
@@ -74,6 +165,9 @@ gerror_t rbtree_create(rbtree_t* rbt, size_t member_size)
 	rbt->compare = rbtree_default_compare_function;
 	rbt->compare_argument = &(rbt->member_size);
 	rbt->root = NULL;
+	rbt->blocks = NULL;
+	rbt->augment = NULL;
+	rbt->augment_argument = NULL;
 
 	rbt->flags = G_RB_LEFT_LEANING;
 
@@ -98,6 +192,17 @@ gerror_t rbtree_destroy (rbtree_t* rbt)
 	rbt->size = 0;
 	rbt->root = rbnode_destroy(rbt->root);
 
+	/*
+	 * a block may still hold nodes of other trees
+	 */
+	while(rbt->blocks){
+		rbblock_t* next = rbt->blocks->next;
+		if(__atomic_sub_fetch(rbt->blocks->memory, 1, __ATOMIC_ACQ_REL) == 0)
+			free(rbt->blocks->memory);
+		free(rbt->blocks);
+		rbt->blocks = next;
+	}
+
 	return GERROR_OK;
 }
 
@@ -133,6 +238,39 @@ gerror_t rbtree_set_compare_function(
 	return GERROR_OK;
 }
 
+/** Set the augment function of `rbt`, which keeps data derived
+  * from a subtree, like the maximum of a field, in the element of
+  * the subtree root. The tree calls `function` bottom up for every
+  * node whose subtree changes in add, remove and rotations, so the
+  * augmented data is always valid; the cost is O(log n) calls per
+  * add or remove. Setting it on a non empty tree updates all nodes.
+  *
+  * The augmented data must not be used by the compare function.
+  *
+  * @param rbt		pointer to a previous allocated `rbtree_t` structure
+  * @param function	augment function or NULL to disable it
+  * @param argument	pointer to the argument to the augment function
+  *
+  * @see rbtree_augment_function
+  *
+  * @return	GERROR_OK in case of success operation;
+  * 		GERROR_NULL_STRUCURE in case `rbt` is a NULL
+  */
+gerror_t rbtree_set_augment_function(
+		rbtree_t* rbt,
+		rbtree_augment_function function,
+		void* argument)
+{
+	if(!rbt) return GERROR_NULL_STRUCTURE;
+
+	rbt->augment = function;
+	rbt->augment_argument = argument;
+
+	rbnode_augment_all(rbt, rbt->root);
+
+	return GERROR_OK;
+}
+
 /** Add an element pointed by `elem` with size `rbt->member_size`
   * in the rbtree.
   *
@@ -171,6 +309,7 @@ gerror_t rbtree_add(rbtree_t* rbt, void* elem)
 			if(rbt->flags & G_RB_EQUAL_OVERRIDE){
 				if(elem)
 					memcpy(node->data, elem, rbt->member_size);
+				rbnode_augment_path(rbt, node);
 				return GERROR_OK;
 			}else if(rbt->flags & G_RB_LEFT_LEANING){
 				node = node->left;
@@ -189,23 +328,242 @@ gerror_t rbtree_add(rbtree_t* rbt, void* elem)
 	/*
 	 * insert the node
 	 */
-	node = create_node(rbt, elem);
+	return rbtree_link_node(rbt, parent_node, c == RB_RIGHT, elem, NULL);
+}
 
-	if(parent_node == NULL)
-		rbt->root = node;
-	else if(c == RB_LEFT)
-		parent_node->left = node;
-	else
-		parent_node->right = node;
+/** Inserts a copy of `elem` as a new leaf of `rbt`, at the left
+  * (`right` is 0) or right child of `parent`, and rebalances the
+  * tree. The position must be the one found by a descent from the
+  * root as in rbtree_add; it is not checked. This is the insertion
+  * step of rbtree_add, used by the type specialized trees of
+  * rbtree_typed.h, which descend with an inlined comparison.
+  *
+  * @param rbt		previous allocated rbtree_t struct
+  * @param parent	parent of the new node or NULL if `rbt` is empty
+  * @param right	whether the new node is the right child of `parent`
+  * @param elem		pointer to the element or NULL for zeros
+  * @param node		pointer to write the new node or NULL
+  *
+  * @return	GERROR_OK in case of success operation;
+  * 		GERROR_NULL_STRUCURE in case `rbt` is a NULL
+  */
+gerror_t rbtree_link_node (rbtree_t* rbt, rbnode_t* parent, int right, void* elem, rbnode_t** node)
+{
+	if(!rbt) return GERROR_NULL_STRUCTURE;
+
+	rbnode_t* n = create_node(rbt, elem);
+
+	rbtree_link(rbt, parent, right, n);
+
+	if(node)
+		*node = n;
+
+	return GERROR_OK;
+}
+
+/** Finds the node with an element equal to `elem` or, if there is
+  * none, inserts a new node whose element starts with the first
+  * `size` bytes of `elem` and has zeros in the rest; in both cases
+  * `*node` is the node, found in a single descent. The compare
+  * function of `rbt` must only read the first `size` bytes of its
+  * first argument, as the key of a map_t pair. This is the insert
+  * or get of map_emplace: the caller can fill or update the element
+  * of `*node` in place, as long as its order is not changed.
+  *
+  * @param rbt		previous allocated rbtree_t struct
+  * @param elem		pointer to the first `size` bytes of an element
+  * @param size		number of bytes of `elem`, at most `member_size`
+  * @param node		pointer to write the found or inserted node
+  * @param inserted	pointer to write 1 if the node was inserted and
+  * 			0 if it was found, or NULL
+  *
+  * @return	GERROR_OK in case of success operation;
+  * 		GERROR_NULL_STRUCURE in case `rbt` is a NULL;
+  * 		GERROR_NULL_ELEMENT_POINTER in case `elem` is NULL;
+  * 		GERROR_NULL_RETURN_POINTER in case `node` is NULL;
+  * 		GERROR_ACCESS_OUT_OF_BOUND in case `size` is greater
+  * 		than `member_size`
+  */
+gerror_t rbtree_emplace (rbtree_t* rbt, void* elem, size_t size, rbnode_t** node, int* inserted)
+{
+	if(!rbt)	return GERROR_NULL_STRUCTURE;
+	if(!elem)	return GERROR_NULL_ELEMENT_POINTER;
+	if(!node)	return GERROR_NULL_RETURN_POINTER;
+	if(size > rbt->member_size)	return GERROR_ACCESS_OUT_OF_BOUND;
+
+	rbnode_t* parent = NULL;
+	rbnode_t* n = rbt->root;
+	int right = 0;
+
+	while( n != NULL ){
+		switch(rbt->compare(elem, n->data, rbt->compare_argument)){
+		case G_RB_FIRST_IS_GREATER:
+			right = 1;
+			break;
+		case G_RB_FIRST_IS_SMALLER:
+			right = 0;
+			break;
+		case G_RB_EQUAL:
+			*node = n;
+			if(inserted)
+				*inserted = 0;
+			return GERROR_OK;
+		default:
+			return GERROR_COMPARE_FUNCTION_WRONG_RETURN;
+		}
 
-	node->parent = parent_node;
+		parent = n;
+		n = right ? n->right : n->left;
+	}
 
 	/*
-	 * fixup
+	 * the key is written before linking, so the
+	 * augment function sees it
 	 */
-	rbtree_insert_fixup(rbt, node);
+	n = create_node(rbt, NULL);
+	if(size)
+		memcpy(n->data, elem, size);
 
-	rbt->size++;
+	rbtree_link(rbt, parent, right, n);
+
+	*node = n;
+	if(inserted)
+		*inserted = 1;
+
+	return GERROR_OK;
+}
+
+/** Updates the augmented data of `node` and its ancestors after
+  * the element of `node` was changed in place, without changing
+  * its order in `rbt`.
+  *
+  * @param rbt		previous allocated rbtree_t struct
+  * @param node		node of `rbt`
+  *
+  * @return	GERROR_OK in case of success operation;
+  * 		GERROR_NULL_STRUCURE in case `rbt` is a NULL;
+  * 		GERROR_NULL_NODE in case `node` is NULL
+  */
+gerror_t rbtree_update_node (rbtree_t* rbt, rbnode_t* node)
+{
+	if(!rbt)	return GERROR_NULL_STRUCTURE;
+	if(!node)	return GERROR_NULL_NODE;
+
+	rbnode_augment_path(rbt, node);
+
+	return GERROR_OK;
+}
+
+/** Builds `rbt` from the `n` elements of `buffer`, sorted by the
+  * compare function of `rbt`, in O(n): the balanced tree is linked
+  * directly, without comparisons beyond the order check and without
+  * rotations, and the nodes are carved from a single allocation that
+  * is released by rbtree_destroy.
+  *
+  * Equal elements are kept, unless G_RB_EQUAL_OVERRIDE is set, in
+  * which case the last one of each run of equal elements is kept.
+  * If `rbt` is not empty, the elements are added one by one.
+  *
+  * @param rbt		previous allocated rbtree_t structure
+  * @param buffer	pointer to `n` elements of `member_size` bytes
+  * @param n		number of elements in `buffer`
+  *
+  * @return	GERROR_OK in case of sucess operation;
+  * 		GERROR_NULL_STRUCTURE in case `rbt` is null
+  * 		GERROR_NULL_POINTER_TO_BUFFER in case `buffer` is null
+  * 		GERROR_UNSORTED_ELEMENTS in case `buffer` is not sorted,
+  * 		`rbt` is not changed
+  * 		GERROR_COMPARE_FUNCTION_WRONG_RETURN in case the
+  * 		compare function returns an invalid value
+  */
+gerror_t rbtree_build_sorted(rbtree_t* rbt, void* buffer, size_t n)
+{
+	if(!rbt)	return GERROR_NULL_STRUCTURE;
+	if(!n)		return GERROR_OK;
+	if(!buffer)	return GERROR_NULL_POINTER_TO_BUFFER;
+
+	char* elems = (char*) buffer;
+	size_t member_size = rbt->member_size;
+	int override = (rbt->flags & G_RB_EQUAL_OVERRIDE) != 0;
+	size_t i, j, count = 1;
+
+	/*
+	 * check the order and count the nodes
+	 */
+	for(i = 1; i < n; i++){
+		int c = rbt->compare(	elems + (i - 1)*member_size,
+					elems + i*member_size,
+					rbt->compare_argument);
+
+		if(c == G_RB_FIRST_IS_GREATER)
+			return GERROR_UNSORTED_ELEMENTS;
+		if(c != G_RB_FIRST_IS_SMALLER && c != G_RB_EQUAL)
+			return GERROR_COMPARE_FUNCTION_WRONG_RETURN;
+
+		if(c == G_RB_FIRST_IS_SMALLER || !override)
+			count++;
+	}
+
+	if(rbt->size){
+		for(i = 0; i < n; i++){
+			gerror_t g = rbtree_add(rbt, elems + i*member_size);
+			if(g != GERROR_OK)
+				return g;
+		}
+		return GERROR_OK;
+	}
+
+	/*
+	 * each node is stored as in create_node: the element
+	 * followed by the node
+	 */
+	size_t offset = member_size ? RBNODE_OFFSET(member_size) : 0;
+	size_t stride = offset + RBNODE_OFFSET(sizeof(rbnode_t));
+	size_t header = RBNODE_OFFSET(sizeof(size_t));
+
+	rbblock_t* block = (rbblock_t*) malloc(sizeof(rbblock_t));
+	block->memory = (size_t*) malloc(header + count*stride);
+	*block->memory = 1;
+	char* base = (char*) block->memory + header;
+
+	for(i = 0, j = 0; i < n; i++){
+		/*
+		 * in override mode only the last of equal elements
+		 */
+		if(override && i + 1 < n
+		&& rbt->compare(elems + i*member_size,
+				elems + (i + 1)*member_size,
+				rbt->compare_argument) == G_RB_EQUAL)
+			continue;
+
+		rbnode_t* node = (rbnode_t*) (base + j*stride + offset);
+
+		node->flags = G_RBNODE_POOLED;
+		node->data = NULL;
+
+		if(member_size){
+			node->data = base + j*stride;
+			memcpy(node->data, elems + i*member_size, member_size);
+		}
+		j++;
+	}
+
+	/*
+	 * the tree is complete except for the last level; every
+	 * path has the same number of black nodes if only the
+	 * nodes of the incomplete last level are red
+	 */
+	size_t red_depth = 0;
+	while( ((size_t)2 << red_depth) <= count + 1 )
+		red_depth++;
+
+	block->next = rbt->blocks;
+	rbt->blocks = block;
+
+	rbt->root = rbtree_build_range(base + offset, stride, 0, count, 0, red_depth, NULL);
+	rbt->size = count;
+
+	rbnode_augment_all(rbt, rbt->root);
 
 	return GERROR_OK;
 }
@@ -257,7 +615,16 @@ gerror_t rbtree_remove_node (rbtree_t* rbt, rbnode_t* node)
 
 	rbnode_t*	to_delete	= node;
 	rbnode_t*	to_fix		= NULL;
-	rbcolor_t	original_color	= node->color;
+	unsigned char	original_color	= node->color;
+	int		order_statistic	= rbt->flags & G_RB_ORDER_STATISTIC;
+
+	/*
+	 * the subtree counts are decreased on the path from the
+	 * node taken out of its position to the root; the double
+	 * black nodes count as empty subtrees
+	 */
+	if(order_statistic && (node->left == NULL || node->right == NULL))
+		rbnode_count_path(node->parent, -1);
 
 	/*
 	 * if the node has no children
@@ -291,6 +658,9 @@ gerror_t rbtree_remove_node (rbtree_t* rbt, rbnode_t* node)
 		to_delete = rbtree_find_minimal_node(node->right);
 		original_color = to_delete->color;
 
+		if(order_statistic)
+			rbnode_count_path(to_delete->parent, -1);
+
 		/*
 		 * create double black node if
 		 * the minimal node has no children
@@ -324,10 +694,16 @@ gerror_t rbtree_remove_node (rbtree_t* rbt, rbnode_t* node)
 		to_delete->left = node->left;
 		to_delete->left->parent = to_delete;
 		to_delete->color = node->color;
+		to_delete->count = node->count;
 
 
 	}
 
+	/*
+	 * the subtrees changed from the parent of `to_fix` up
+	 */
+	rbnode_augment_path(rbt, to_fix->parent);
+
 	if(original_color == G_RB_BLACK)
 		rbtree_delete_fixup(rbt, to_fix);
 
@@ -337,8 +713,7 @@ gerror_t rbtree_remove_node (rbtree_t* rbt, rbnode_t* node)
 	if(to_fix != NULL && to_fix->color == G_RB_DOUBLE_BLACK)
 		rbtree_remove_double_black(rbt, to_fix);
 
-	free(node->data);
-	free(node);
+	rbnode_free(node);
 
 	rbt->size--;
 
@@ -360,6 +735,12 @@ gerror_t rbtree_set_flags (redblacktree_t* rbt, long flags)
 {
 	if(!rbt) return GERROR_NULL_STRUCTURE;
 
+	/*
+	 * the counts are not kept without the flag
+	 */
+	if((flags & G_RB_ORDER_STATISTIC) && !(rbt->flags & G_RB_ORDER_STATISTIC))
+		rbnode_recount(rbt->root);
+
 	rbt->flags = flags;
 
 	return GERROR_OK;
@@ -410,6 +791,35 @@ gerror_t rbtree_find_node (rbtree_t* rbt, void* elem, rbnode_t** node)
 	return GERROR_ELEMENT_NOT_FOUNDED;
 }
 
+/** Finds the element equal to `elem` and writes in `found` a pointer
+  * to it, stored with its node, without copying it. The nodes are
+  * never moved, so the pointer is valid until its element is removed
+  * or `rbt` is destroyed; the element can be changed in place as long
+  * as its order is not changed, see rbtree_update_node.
+  *
+  * @param rbt		previous allocated rbtree_t struct
+  * @param elem		pointer to the element to find
+  * @param found	pointer to write the pointer to the element
+  *
+  * @return	GERROR_OK in case of success operation;
+  * 		GERROR_NULL_STRUCURE in case `rbt` is a NULL;
+  * 		GERROR_NULL_ELEMENT_POINTER in case `elem` is null;
+  * 		GERROR_NULL_RETURN_POINTER in case `found` is null;
+  * 		GERROR_ELEMENT_NOT_FOUNDED in case there is no element
+  * 		equal to `elem`; `*found` is set to NULL
+  */
+gerror_t rbtree_find_ptr (rbtree_t* rbt, void* elem, void** found)
+{
+	if(!found)	return GERROR_NULL_RETURN_POINTER;
+
+	rbnode_t* node = NULL;
+	gerror_t g = rbtree_find_node(rbt, elem, &node);
+
+	*found = node ? node->data : NULL;
+
+	return g;
+}
+
 /** Find the minimal value in rbt and write the pointer to
   * `node`.
   *
@@ -476,92 +886,582 @@ gerror_t rbtree_max_node (rbtree_t* rbt, rbnode_t** node)
 	return GERROR_OK;
 }
 
-/*
- * destroy a node and it's children's
- * recursively
- */
-rbnode_t* rbnode_destroy(rbnode_t* node)
+/** Find the first node of `rbt` in order and write the
+  * pointer to `node`. Together with rbtree_next it walks
+  * the tree in order without allocating:
+  *
+  * 	for(rbtree_first(rbt, &n); n; rbtree_next(rbt, n, &n))
+  *
+  * @param rbt		previous allocated rbtree_t struct
+  * @param node		pointer to the return node pointer;
+  *
+  * @return	GERROR_OK in case of success operation;
+  * 		GERROR_EMPTY_STRUCTURE in case the
+  * 		`rbt` structure is empty, `*node` is set to NULL
+  * 		GERROR_NULL_STRUCURE in case `rbt` is a NULL;
+  * 		GERROR_NULL_RETURN_POINTER in case that `node`
+  * 		is NULL
+  */
+gerror_t rbtree_first (rbtree_t* rbt, rbnode_t** node)
 {
-	if(node){
-		rbnode_destroy(node->left);
-		rbnode_destroy(node->right);
-		free(node->data);
-		free(node);
-	}
-	return NULL;
+	if(!rbt)	return GERROR_NULL_STRUCTURE;
+	if(!node)	return GERROR_NULL_RETURN_POINTER;
+
+	*node = rbt->root ? rbtree_find_minimal_node(rbt->root) : NULL;
+
+	return *node ? GERROR_OK : GERROR_EMPTY_STRUCTURE;
 }
 
-/** Find the minimal value in rbt and write the value to
-  * `elem`.
+/** Find the last node of `rbt` in order and write the
+  * pointer to `node`.
   *
   * @param rbt		previous allocated rbtree_t struct
-  * @param elem		pointer to a local in memory to write
-  * 			the minimal value
+  * @param node		pointer to the return node pointer;
   *
   * @return	GERROR_OK in case of success operation;
   * 		GERROR_EMPTY_STRUCTURE in case the
-  * 		`rbt` structure is empty
+  * 		`rbt` structure is empty, `*node` is set to NULL
   * 		GERROR_NULL_STRUCURE in case `rbt` is a NULL;
   * 		GERROR_NULL_RETURN_POINTER in case that `node`
-  * 		By the end of the function, the `*node` will point
-  * 		to the found element or NULL otherwise
+  * 		is NULL
   */
-gerror_t rbtree_min_value (rbtree_t* rbt, void* elem)
+gerror_t rbtree_last (rbtree_t* rbt, rbnode_t** node)
 {
-	if(!elem) return GERROR_NULL_RETURN_POINTER;
+	if(!rbt)	return GERROR_NULL_STRUCTURE;
+	if(!node)	return GERROR_NULL_RETURN_POINTER;
 
-	rbnode_t* node;
-	gerror_t result = rbtree_min_node(rbt, &node);
+	rbnode_t* n = rbt->root;
+	*node = NULL;
 
-	if( result != GERROR_OK )
-		return result;
+	while(n != NULL){
+		*node = n;
+		n = n->right;
+	}
 
-	memcpy(elem, node->data, rbt->member_size);
+	return *node ? GERROR_OK : GERROR_EMPTY_STRUCTURE;
+}
+
+/** Write in `next` the in order successor of `node`, using
+  * the parent links; amortized O(1) per call.
+  * The walk is invalidated by any add or remove on `rbt`.
+  *
+  * @param rbt		previous allocated rbtree_t struct
+  * @param node		node of `rbt`
+  * @param next		pointer to the return node pointer;
+  * 			`*next` is set to NULL when `node` is the
+  * 			last node
+  *
+  * @return	GERROR_OK in case of success operation;
+  * 		GERROR_NULL_STRUCURE in case `rbt` is a NULL;
+  * 		GERROR_NULL_ELEMENT_POINTER in case `node` is NULL;
+  * 		GERROR_NULL_RETURN_POINTER in case that `next`
+  * 		is NULL
+  */
+gerror_t rbtree_next (rbtree_t* rbt, rbnode_t* node, rbnode_t** next)
+{
+	if(!rbt)	return GERROR_NULL_STRUCTURE;
+	if(!node)	return GERROR_NULL_ELEMENT_POINTER;
+	if(!next)	return GERROR_NULL_RETURN_POINTER;
+
+	*next = rbnode_successor(node);
 
 	return GERROR_OK;
 }
 
-/** Find the maximal value in rbt and write the value to
-  * `elem`.
+/** Write in `prev` the in order predecessor of `node`, using
+  * the parent links; amortized O(1) per call.
+  * The walk is invalidated by any add or remove on `rbt`.
   *
   * @param rbt		previous allocated rbtree_t struct
-  * @param elem		pointer to a local in memory to write
-  * 			the maximal value
+  * @param node		node of `rbt`
+  * @param prev		pointer to the return node pointer;
+  * 			`*prev` is set to NULL when `node` is the
+  * 			first node
   *
   * @return	GERROR_OK in case of success operation;
-  * 		GERROR_EMPTY_STRUCTURE in case the
-  * 		`rbt` structure is empty
   * 		GERROR_NULL_STRUCURE in case `rbt` is a NULL;
-  * 		GERROR_NULL_RETURN_POINTER in case that `node`
-  * 		By the end of the function, the `*node` will point
-  * 		to the found element or NULL otherwise
+  * 		GERROR_NULL_ELEMENT_POINTER in case `node` is NULL;
+  * 		GERROR_NULL_RETURN_POINTER in case that `prev`
+  * 		is NULL
   */
-gerror_t rbtree_max_value (rbtree_t* rbt, void* elem)
+gerror_t rbtree_prev (rbtree_t* rbt, rbnode_t* node, rbnode_t** prev)
 {
-	if(!elem) return GERROR_NULL_RETURN_POINTER;
+	if(!rbt)	return GERROR_NULL_STRUCTURE;
+	if(!node)	return GERROR_NULL_ELEMENT_POINTER;
+	if(!prev)	return GERROR_NULL_RETURN_POINTER;
 
-	rbnode_t* node;
-	gerror_t result = rbtree_max_node(rbt, &node);
+	if(node->left){
+		node = node->left;
+		while(node->right)
+			node = node->right;
+		*prev = node;
+		return GERROR_OK;
+	}
 
-	if( result != GERROR_OK )
-		return result;
+	while(node->parent && node->parent->left == node)
+		node = node->parent;
 
-	memcpy(elem, node->data, rbt->member_size);
+	*prev = node->parent;
 
 	return GERROR_OK;
 }
 
 /*
- * Classic red n black insert fixup function
+ * auxiliar function;
+ * find the first node which compares greater than `elem`
+ * or, if `inclusive`, greater or equal to `elem`
  */
-static void rbtree_insert_fixup(rbtree_t* rbt, rbnode_t* node)
+static gerror_t rbtree_bound(rbtree_t* rbt, void* elem, rbnode_t** node, int inclusive)
 {
-	while( node->parent != NULL && node->parent->color == G_RB_RED ){
+	rbnode_t* n = rbt->root;
+	*node = NULL;
 
-		/*
-		 * the parent of the node is the left child
-		 */
-		if( node->parent == node->parent->parent->left ){
+	while(n != NULL){
+		rbcomp_t result = rbt->compare(elem, n->data, rbt->compare_argument);
+
+		switch(result){
+		case G_RB_FIRST_IS_SMALLER:
+			*node = n;
+			n = n->left;
+			break;
+		case G_RB_EQUAL:
+			if(inclusive){
+				*node = n;
+				n = n->left;
+			}else{
+				n = n->right;
+			}
+			break;
+		case G_RB_FIRST_IS_GREATER:
+			n = n->right;
+			break;
+		default:
+			*node = NULL;
+			return GERROR_COMPARE_FUNCTION_WRONG_RETURN;
+		}
+	}
+
+	return GERROR_OK;
+}
+
+/** Find the first node in order which is not smaller
+  * than `elem` and write the pointer to `node`.
+  *
+  * @param rbt		previous allocated rbtree_t struct
+  * @param elem		pointer to the element to be compared
+  * @param node		pointer to the return node pointer;
+  * 			`*node` is set to NULL when every node
+  * 			is smaller than `elem`
+  *
+  * @return	GERROR_OK in case of success operation;
+  * 		GERROR_NULL_STRUCURE in case `rbt` is a NULL;
+  * 		GERROR_NULL_ELEMENT_POINTER in case `elem` is NULL;
+  * 		GERROR_NULL_RETURN_POINTER in case that `node`
+  * 		is NULL
+  * 		GERROR_COMPARE_FUNCTION_WRONG_RETURN in case
+  * 		the compare function returns an invalid value
+  */
+gerror_t rbtree_lower_bound (rbtree_t* rbt, void* elem, rbnode_t** node)
+{
+	if(!rbt)	return GERROR_NULL_STRUCTURE;
+	if(!elem)	return GERROR_NULL_ELEMENT_POINTER;
+	if(!node)	return GERROR_NULL_RETURN_POINTER;
+
+	return rbtree_bound(rbt, elem, node, 1);
+}
+
+/** Find the first node in order which is greater
+  * than `elem` and write the pointer to `node`.
+  *
+  * @param rbt		previous allocated rbtree_t struct
+  * @param elem		pointer to the element to be compared
+  * @param node		pointer to the return node pointer;
+  * 			`*node` is set to NULL when no node
+  * 			is greater than `elem`
+  *
+  * @return	GERROR_OK in case of success operation;
+  * 		GERROR_NULL_STRUCURE in case `rbt` is a NULL;
+  * 		GERROR_NULL_ELEMENT_POINTER in case `elem` is NULL;
+  * 		GERROR_NULL_RETURN_POINTER in case that `node`
+  * 		is NULL
+  * 		GERROR_COMPARE_FUNCTION_WRONG_RETURN in case
+  * 		the compare function returns an invalid value
+  */
+gerror_t rbtree_upper_bound (rbtree_t* rbt, void* elem, rbnode_t** node)
+{
+	if(!rbt)	return GERROR_NULL_STRUCTURE;
+	if(!elem)	return GERROR_NULL_ELEMENT_POINTER;
+	if(!node)	return GERROR_NULL_RETURN_POINTER;
+
+	return rbtree_bound(rbt, elem, node, 0);
+}
+
+/** Find the node with `k` nodes before it in order, that is,
+  * the (k+1)-th smallest element, and write the pointer to `node`.
+  * The tree must have the G_RB_ORDER_STATISTIC flag; O(log n).
+  *
+  * @param rbt		previous allocated rbtree_t struct
+  * @param k		number of nodes before the wanted node
+  * @param node		pointer to the return node pointer;
+  *
+  * @return	GERROR_OK in case of success operation;
+  * 		GERROR_NULL_STRUCURE in case `rbt` is a NULL;
+  * 		GERROR_NULL_RETURN_POINTER in case that `node`
+  * 		is NULL
+  * 		GERROR_UNSUPPORTED_OPERATION in case `rbt` does not
+  * 		have the G_RB_ORDER_STATISTIC flag
+  * 		GERROR_ACCESS_OUT_OF_BOUND in case `k` is not
+  * 		smaller than the size of `rbt`
+  */
+gerror_t rbtree_select (rbtree_t* rbt, size_t k, rbnode_t** node)
+{
+	if(!rbt)	return GERROR_NULL_STRUCTURE;
+	if(!node)	return GERROR_NULL_RETURN_POINTER;
+	if(!(rbt->flags & G_RB_ORDER_STATISTIC))
+		return GERROR_UNSUPPORTED_OPERATION;
+	if(k >= rbt->size)
+		return GERROR_ACCESS_OUT_OF_BOUND;
+
+	rbnode_t* n = rbt->root;
+
+	for(;;){
+		size_t left = rbnode_count(n->left);
+
+		if(k < left){
+			n = n->left;
+		}else if(k > left){
+			k -= left + 1;
+			n = n->right;
+		}else{
+			*node = n;
+			return GERROR_OK;
+		}
+	}
+}
+
+/** Write in `rank` the number of elements of `rbt` smaller than
+  * `elem`, which is the position of `elem` in order if it is in
+  * the tree. The tree must have the G_RB_ORDER_STATISTIC flag;
+  * O(log n).
+  *
+  * @param rbt		previous allocated rbtree_t struct
+  * @param elem		pointer to the element to be compared
+  * @param rank		pointer to the return rank
+  *
+  * @return	GERROR_OK in case of success operation;
+  * 		GERROR_NULL_STRUCURE in case `rbt` is a NULL;
+  * 		GERROR_NULL_ELEMENT_POINTER in case `elem` is NULL;
+  * 		GERROR_NULL_RETURN_POINTER in case that `rank`
+  * 		is NULL
+  * 		GERROR_UNSUPPORTED_OPERATION in case `rbt` does not
+  * 		have the G_RB_ORDER_STATISTIC flag
+  * 		GERROR_COMPARE_FUNCTION_WRONG_RETURN in case
+  * 		the compare function returns an invalid value
+  */
+gerror_t rbtree_rank (rbtree_t* rbt, void* elem, size_t* rank)
+{
+	if(!rbt)	return GERROR_NULL_STRUCTURE;
+	if(!elem)	return GERROR_NULL_ELEMENT_POINTER;
+	if(!rank)	return GERROR_NULL_RETURN_POINTER;
+	if(!(rbt->flags & G_RB_ORDER_STATISTIC))
+		return GERROR_UNSUPPORTED_OPERATION;
+
+	rbnode_t* n = rbt->root;
+	size_t r = 0;
+
+	while(n != NULL){
+		rbcomp_t result = rbt->compare(elem, n->data, rbt->compare_argument);
+
+		switch(result){
+		case G_RB_FIRST_IS_SMALLER:
+		case G_RB_EQUAL:
+			n = n->left;
+			break;
+		case G_RB_FIRST_IS_GREATER:
+			r += rbnode_count(n->left) + 1;
+			n = n->right;
+			break;
+		default:
+			return GERROR_COMPARE_FUNCTION_WRONG_RETURN;
+		}
+	}
+
+	*rank = r;
+
+	return GERROR_OK;
+}
+
+/** Moves all elements of `b` to `a`; every element of `a` must
+  * be smaller than or equal to every element of `b`. Both trees
+  * are linked by their black heights, so the operation takes
+  * O(log n) and no element is copied. By the end `b` is empty,
+  * but it must still be destroyed.
+  *
+  * @param a	previous allocated rbtree_t struct
+  * @param b	previous allocated rbtree_t struct, with the
+  * 		same member size and order of `a`
+  *
+  * @return	GERROR_OK in case of success operation;
+  * 		GERROR_NULL_STRUCURE in case `a` or `b` is a NULL;
+  * 		GERROR_UNSUPPORTED_OPERATION in case `a` and `b`
+  * 		are the same tree or have different member sizes;
+  * 		GERROR_UNSORTED_ELEMENTS in case the maximum of `a`
+  * 		is greater than the minimum of `b`
+  */
+gerror_t rbtree_join (rbtree_t* a, rbtree_t* b)
+{
+	if(!a || !b)	return GERROR_NULL_STRUCTURE;
+	if(a == b || a->member_size != b->member_size)
+		return GERROR_UNSUPPORTED_OPERATION;
+
+	if(a->root && b->root){
+		rbnode_t* max = a->root;
+		while(max->right)
+			max = max->right;
+
+		int c = a->compare(	max->data,
+					rbtree_find_minimal_node(b->root)->data,
+					a->compare_argument);
+
+		if(c == G_RB_FIRST_IS_GREATER
+		|| (c == G_RB_EQUAL && (a->flags & G_RB_EQUAL_OVERRIDE)))
+			return GERROR_UNSORTED_ELEMENTS;
+	}
+
+	rbsub_t t = rbsub_join2(a, rbsub_create(a->root), rbsub_create(b->root));
+
+	a->root = t.root;
+	a->size += b->size;
+	b->root = NULL;
+	b->size = 0;
+	rbtree_move_blocks(b, a);
+
+	return GERROR_OK;
+}
+
+/** Splits `rbt` in two trees: `left` with the elements smaller
+  * than `key` and `right` with the others. `left` and `right`
+  * are created with the member size, flags and functions of
+  * `rbt`, and `rbt` is left empty. The nodes are moved, so the
+  * split takes O(log n) plus O(min(|left|, |right|)) to count
+  * the sizes, or O(log n) with G_RB_ORDER_STATISTIC.
+  *
+  * @param rbt		previous allocated rbtree_t struct
+  * @param key		pointer to the element to split at
+  * @param left		rbtree_t struct, not created, that
+  * 			receives the smaller elements
+  * @param right	rbtree_t struct, not created, that
+  * 			receives the other elements
+  *
+  * @return	GERROR_OK in case of success operation;
+  * 		GERROR_NULL_STRUCURE in case `rbt` is a NULL;
+  * 		GERROR_NULL_ELEMENT_POINTER in case `key` is NULL;
+  * 		GERROR_NULL_RETURN_POINTER in case `left` or
+  * 		`right` is NULL;
+  * 		GERROR_UNSUPPORTED_OPERATION in case `rbt`, `left`
+  * 		and `right` are not different structures
+  */
+gerror_t rbtree_split (rbtree_t* rbt, void* key, rbtree_t* left, rbtree_t* right)
+{
+	if(!rbt)		return GERROR_NULL_STRUCTURE;
+	if(!key)		return GERROR_NULL_ELEMENT_POINTER;
+	if(!left || !right)	return GERROR_NULL_RETURN_POINTER;
+	if(left == right || left == rbt || right == rbt)
+		return GERROR_UNSUPPORTED_OPERATION;
+
+	rbsub_t l;
+	rbsub_t r;
+	rbsub_split_below(rbt, rbsub_create(rbt->root), key, &l, &r);
+
+	*left = *rbt;
+	*right = *rbt;
+	left->root = l.root;
+	right->root = r.root;
+	left->blocks = NULL;
+	right->blocks = NULL;
+
+	if(rbt->compare_argument == &rbt->member_size){
+		left->compare_argument = &left->member_size;
+		right->compare_argument = &right->member_size;
+	}
+
+	rbtree_split_sizes(left, right, rbt->size);
+
+	rbtree_share_blocks(rbt, right);
+	rbtree_move_blocks(rbt, left);
+	rbt->root = NULL;
+	rbt->size = 0;
+
+	return GERROR_OK;
+}
+
+/** Union of `a` and `b`, written in `a`.
+  * @see rbtree_set_operation
+  */
+gerror_t rbtree_union (rbtree_t* a, rbtree_t* b)
+{
+	return rbtree_set_operation(a, b, G_RB_UNION, 1);
+}
+
+/** Intersection of `a` and `b`, written in `a`.
+  * @see rbtree_set_operation
+  */
+gerror_t rbtree_intersection (rbtree_t* a, rbtree_t* b)
+{
+	return rbtree_set_operation(a, b, G_RB_INTERSECTION, 1);
+}
+
+/** Difference of `a` and `b`, written in `a`.
+  * @see rbtree_set_operation
+  */
+gerror_t rbtree_difference (rbtree_t* a, rbtree_t* b)
+{
+	return rbtree_set_operation(a, b, G_RB_DIFFERENCE, 1);
+}
+
+/** Computes the set operation `op` of `a` and `b` and writes the
+  * result in `a`; the trees are taken as sets, so each element
+  * should be unique in its tree. The trees are split and joined
+  * recursively by the elements of one of them, which takes
+  * O(m log(n/m + 1)) for trees of m <= n elements, instead of
+  * O(m log n) of adding or removing one by one. The nodes are
+  * moved between the trees and the discarded ones are freed;
+  * by the end `b` is empty, but it must still be destroyed.
+  *
+  * The two halves of the top levels of the recursion are
+  * processed by up to `nthreads` threads; the compare and
+  * augment functions must be thread safe in that case.
+  *
+  * @param a		previous allocated rbtree_t struct
+  * @param b		previous allocated rbtree_t struct, with the
+  * 			same member size and order of `a`
+  * @param op		one of the rbset_op_t operations
+  * @param nthreads	maximum number of threads, 0 or 1 to
+  * 			run in the caller thread only
+  *
+  * @return	GERROR_OK in case of success operation;
+  * 		GERROR_NULL_STRUCURE in case `a` or `b` is a NULL;
+  * 		GERROR_UNSUPPORTED_OPERATION in case `a` and `b`
+  * 		are the same tree or have different member sizes
+  */
+gerror_t rbtree_set_operation (rbtree_t* a, rbtree_t* b, rbset_op_t op, size_t nthreads)
+{
+	if(!a || !b)	return GERROR_NULL_STRUCTURE;
+	if(a == b || a->member_size != b->member_size)
+		return GERROR_UNSUPPORTED_OPERATION;
+
+	size_t freed = 0;
+	rbsub_t t = rbsub_set_operation(a,
+					rbsub_create(a->root),
+					rbsub_create(b->root),
+					op,
+					nthreads ? nthreads : 1,
+					&freed);
+
+	a->root = t.root;
+	a->size = a->size + b->size - freed;
+	b->root = NULL;
+	b->size = 0;
+	rbtree_move_blocks(b, a);
+
+	return GERROR_OK;
+}
+
+/*
+ * destroy a node and it's children's
+ * recursively
+ */
+rbnode_t* rbnode_destroy(rbnode_t* node)
+{
+	if(node){
+		rbnode_destroy(node->left);
+		rbnode_destroy(node->right);
+		rbnode_free(node);
+	}
+	return NULL;
+}
+
+/** Find the minimal value in rbt and write the value to
+  * `elem`.
+  *
+  * @param rbt		previous allocated rbtree_t struct
+  * @param elem		pointer to a local in memory to write
+  * 			the minimal value
+  *
+  * @return	GERROR_OK in case of success operation;
+  * 		GERROR_EMPTY_STRUCTURE in case the
+  * 		`rbt` structure is empty
+  * 		GERROR_NULL_STRUCURE in case `rbt` is a NULL;
+  * 		GERROR_NULL_RETURN_POINTER in case that `node`
+  * 		By the end of the function, the `*node` will point
+  * 		to the found element or NULL otherwise
+  */
+gerror_t rbtree_min_value (rbtree_t* rbt, void* elem)
+{
+	if(!elem) return GERROR_NULL_RETURN_POINTER;
+
+	rbnode_t* node;
+	gerror_t result = rbtree_min_node(rbt, &node);
+
+	if( result != GERROR_OK )
+		return result;
+
+	memcpy(elem, node->data, rbt->member_size);
+
+	return GERROR_OK;
+}
+
+/** Find the maximal value in rbt and write the value to
+  * `elem`.
+  *
+  * @param rbt		previous allocated rbtree_t struct
+  * @param elem		pointer to a local in memory to write
+  * 			the maximal value
+  *
+  * @return	GERROR_OK in case of success operation;
+  * 		GERROR_EMPTY_STRUCTURE in case the
+  * 		`rbt` structure is empty
+  * 		GERROR_NULL_STRUCURE in case `rbt` is a NULL;
+  * 		GERROR_NULL_RETURN_POINTER in case that `node`
+  * 		By the end of the function, the `*node` will point
+  * 		to the found element or NULL otherwise
+  */
+gerror_t rbtree_max_value (rbtree_t* rbt, void* elem)
+{
+	if(!elem) return GERROR_NULL_RETURN_POINTER;
+
+	rbnode_t* node;
+	gerror_t result = rbtree_max_node(rbt, &node);
+
+	if( result != GERROR_OK )
+		return result;
+
+	memcpy(elem, node->data, rbt->member_size);
+
+	return GERROR_OK;
+}
+
+/*
+ * Classic red n black insert fixup function
+ */
+static void rbtree_insert_fixup(rbtree_t* rbt, rbnode_t* node)
+{
+	rbtree_insert_rebalance(rbt, node);
+
+	rbt->root->color = G_RB_BLACK;
+}
+
+/*
+ * the loop of the insert fixup; the root may be left red
+ */
+static void rbtree_insert_rebalance(rbtree_t* rbt, rbnode_t* node)
+{
+	while( node->parent != NULL && node->parent->color == G_RB_RED ){
+
+		/*
+		 * the parent of the node is the left child
+		 */
+		if( node->parent == node->parent->parent->left ){
 
 			/*
 			 * so the uncle is the right child
@@ -587,8 +1487,6 @@ static void rbtree_insert_fixup(rbtree_t* rbt, rbnode_t* node)
 				fix_insert_case(rbt, &node, uncle, 2, 0);
 		}
 	}
-
-	rbt->root->color = G_RB_BLACK;
 }
 
 /*
@@ -642,27 +1540,102 @@ static void fix_insert_case(rbtree_t* rbt, rbnode_t** node, rbnode_t* uncle, int
 }
 
 /*
- * allocates and create a node
+ * links the new `node` as the left (`right` is 0) or right
+ * child of `parent` and rebalances `rbt`
  */
-static rbnode_t* create_node(rbtree_t* rbt, void* elem)
+static void rbtree_link(rbtree_t* rbt, rbnode_t* parent, int right, rbnode_t* node)
 {
-	rbnode_t* node = (rbnode_t*) malloc( sizeof(rbnode_t) );
+	if(parent == NULL)
+		rbt->root = node;
+	else if(!right)
+		parent->left = node;
+	else
+		parent->right = node;
 
-	node->left	= NULL;
-	node->right	= NULL;
-	node->parent	= NULL;
+	node->parent = parent;
+
+	if(rbt->flags & G_RB_ORDER_STATISTIC)
+		rbnode_count_path(parent, 1);
+
+	rbnode_augment_path(rbt, node);
+
+	/*
+	 * fixup
+	 */
+	rbtree_insert_fixup(rbt, node);
+
+	rbt->size++;
+}
+
+/*
+ * allocates and create a node; the element is stored
+ * in the same block, right before the node
+ */
+static rbnode_t* create_node(rbtree_t* rbt, void* elem)
+{
+	size_t offset = rbt->member_size ? RBNODE_OFFSET(rbt->member_size) : 0;
+	char* block = (char*) malloc( offset + sizeof(rbnode_t) );
+	rbnode_t* node = (rbnode_t*) (block + offset);
+
+	node->left	= NULL;
+	node->right	= NULL;
+	node->parent	= NULL;
 	node->color	= G_RB_RED;
+	node->flags	= 0;
+	node->count	= 1;
 	node->data	= NULL;
 
-	if( rbt->member_size && elem ){
-		node->data = (void*) malloc(rbt->member_size);
-		memcpy(node->data, elem, rbt->member_size);
+	if( rbt->member_size ){
+		node->data = block;
+
+		if( elem )
+			memcpy(node->data, elem, rbt->member_size);
+		else
+			memset(node->data, 0, rbt->member_size);
 	}
 
+	return node;
+}
+
+/*
+ * links the nodes [lo, hi) of a block as a balanced subtree
+ * and returns its root; nodes at `red_depth` are red
+ */
+static rbnode_t* rbtree_build_range(	char* base,
+					size_t stride,
+					size_t lo,
+					size_t hi,
+					size_t depth,
+					size_t red_depth,
+					rbnode_t* parent)
+{
+	if(lo >= hi)
+		return NULL;
+
+	size_t mid = lo + (hi - lo)/2;
+	rbnode_t* node = (rbnode_t*) (base + mid*stride);
+
+	node->parent	= parent;
+	node->count	= hi - lo;
+	node->color	= depth == red_depth ? G_RB_RED : G_RB_BLACK;
+	node->left	= rbtree_build_range(base, stride, lo, mid, depth + 1, red_depth, node);
+	node->right	= rbtree_build_range(base, stride, mid + 1, hi, depth + 1, red_depth, node);
 
 	return node;
 }
 
+/*
+ * deallocates the block of a node created by create_node;
+ * when the node holds an element the block starts at it
+ */
+static void rbnode_free(rbnode_t* node)
+{
+	if(node->flags & G_RBNODE_POOLED)
+		return;
+
+	free(node->data ? node->data : (void*) node);
+}
+
 /*
  * performs the left rotation. This is the classical binary
  * search tree left rotation function.
@@ -692,6 +1665,16 @@ static void left_rotate(rbtree_t* rbt, rbnode_t* node)
 
 	temp_node->left = node;
 	node->parent = temp_node;
+
+	if(rbt->flags & G_RB_ORDER_STATISTIC){
+		temp_node->count = node->count;
+		node->count = rbnode_count(node->left) + rbnode_count(node->right) + 1;
+	}
+
+	if(rbt->augment){
+		rbnode_augment(rbt, node);
+		rbnode_augment(rbt, temp_node);
+	}
 }
 
 /*
@@ -723,6 +1706,583 @@ static void right_rotate(rbtree_t* rbt, rbnode_t* node)
 
 	temp_node->right = node;
 	node->parent = temp_node;
+
+	if(rbt->flags & G_RB_ORDER_STATISTIC){
+		temp_node->count = node->count;
+		node->count = rbnode_count(node->left) + rbnode_count(node->right) + 1;
+	}
+
+	if(rbt->augment){
+		rbnode_augment(rbt, node);
+		rbnode_augment(rbt, temp_node);
+	}
+}
+
+/*
+ * returns the number of nodes of the subtree of `node`
+ */
+static size_t rbnode_count(rbnode_t* node)
+{
+	return node ? node->count : 0;
+}
+
+/*
+ * adds `delta` to the count of `node` and its ancestors
+ */
+static void rbnode_count_path(rbnode_t* node, int delta)
+{
+	while(node != NULL){
+		node->count += delta;
+		node = node->parent;
+	}
+}
+
+/*
+ * recomputes the counts of the subtree of `node`
+ * and returns the count of `node`
+ */
+static size_t rbnode_recount(rbnode_t* node)
+{
+	if(!node)
+		return 0;
+
+	node->count = rbnode_recount(node->left) + rbnode_recount(node->right) + 1;
+
+	return node->count;
+}
+
+/*
+ * returns the element of a child for the augment
+ * function; NULL for empty and double black nodes
+ */
+static void* rbnode_augment_data(rbnode_t* node)
+{
+	if(!node || node->color == G_RB_DOUBLE_BLACK)
+		return NULL;
+
+	return node->data;
+}
+
+/*
+ * calls the augment function of `rbt` in `node`
+ */
+static void rbnode_augment(rbtree_t* rbt, rbnode_t* node)
+{
+	if(!node->data || node->color == G_RB_DOUBLE_BLACK)
+		return;
+
+	rbt->augment(	node->data,
+			rbnode_augment_data(node->left),
+			rbnode_augment_data(node->right),
+			rbt->augment_argument);
+}
+
+/*
+ * calls the augment function in `node` and its ancestors
+ */
+static void rbnode_augment_path(rbtree_t* rbt, rbnode_t* node)
+{
+	if(!rbt->augment)
+		return;
+
+	while(node != NULL){
+		rbnode_augment(rbt, node);
+		node = node->parent;
+	}
+}
+
+/*
+ * calls the augment function in all nodes of the
+ * subtree of `node`, children first
+ */
+static void rbnode_augment_all(rbtree_t* rbt, rbnode_t* node)
+{
+	if(!rbt->augment || !node)
+		return;
+
+	rbnode_augment_all(rbt, node->left);
+	rbnode_augment_all(rbt, node->right);
+	rbnode_augment(rbt, node);
+}
+
+/*
+ * recomputes the count and the augmented data of `node`
+ * from its children
+ */
+static void rbnode_update(rbtree_t* rbt, rbnode_t* node)
+{
+	if(rbt->flags & G_RB_ORDER_STATISTIC)
+		node->count = rbnode_count(node->left) + rbnode_count(node->right) + 1;
+
+	if(rbt->augment)
+		rbnode_augment(rbt, node);
+}
+
+/*
+ * returns the number of black nodes in a path from `node`
+ * to a leaf, `node` included
+ */
+static size_t rbnode_black_height(rbnode_t* node)
+{
+	size_t height = 0;
+
+	for(; node != NULL; node = node->left)
+		if(node->color != G_RB_RED)
+			height++;
+
+	return height;
+}
+
+/*
+ * returns the in order successor of `node` or NULL
+ */
+static rbnode_t* rbnode_successor(rbnode_t* node)
+{
+	if(node->right)
+		return rbtree_find_minimal_node(node->right);
+
+	while(node->parent && node->parent->right == node)
+		node = node->parent;
+
+	return node->parent;
+}
+
+/*
+ * frees the subtree of `node` and returns its number of nodes
+ */
+static size_t rbnode_free_all(rbnode_t* node)
+{
+	if(!node)
+		return 0;
+
+	size_t n = rbnode_free_all(node->left) + rbnode_free_all(node->right) + 1;
+	rbnode_free(node);
+
+	return n;
+}
+
+/*
+ * the subtree of the root of a tree
+ */
+static rbsub_t rbsub_create(rbnode_t* root)
+{
+	rbsub_t t;
+
+	t.root = root;
+	t.height = rbnode_black_height(root);
+
+	return t;
+}
+
+/*
+ * detaches the root of `t` from its children; a red child
+ * becomes black, so that it is the root of a valid tree
+ */
+static void rbsub_expose(rbsub_t t, rbsub_t* left, rbnode_t** node, rbsub_t* right)
+{
+	size_t height = t.height - (t.root->color == G_RB_RED ? 0 : 1);
+
+	*node = t.root;
+	left->root = t.root->left;
+	left->height = height;
+	right->root = t.root->right;
+	right->height = height;
+
+	if(left->root){
+		left->root->parent = NULL;
+		if(left->root->color == G_RB_RED){
+			left->root->color = G_RB_BLACK;
+			left->height++;
+		}
+	}
+
+	if(right->root){
+		right->root->parent = NULL;
+		if(right->root->color == G_RB_RED){
+			right->root->color = G_RB_BLACK;
+			right->height++;
+		}
+	}
+}
+
+/*
+ * joins `left`, `node` and `right`, where all the elements of
+ * `left` are smaller than `node` and the ones of `right` are
+ * greater. `node` is linked as a red node in the spine of the
+ * higher tree where the black height equals the one of the
+ * lower tree, and fixed as an inserted node; the cost is the
+ * difference of the heights.
+ */
+static rbsub_t rbsub_join(rbtree_t* rbt, rbsub_t left, rbnode_t* node, rbsub_t right)
+{
+	rbtree_t tree = *rbt;
+	rbsub_t t;
+	rbnode_t* parent = NULL;
+	rbnode_t* c;
+	size_t height;
+
+	node->parent = NULL;
+
+	if(left.height == right.height){
+		node->left = left.root;
+		node->right = right.root;
+		node->color = G_RB_BLACK;
+
+		if(left.root)	left.root->parent = node;
+		if(right.root)	right.root->parent = node;
+
+		rbnode_update(rbt, node);
+
+		t.root = node;
+		t.height = left.height + 1;
+		return t;
+	}
+
+	if(left.height > right.height){
+		/*
+		 * walks the right spine of `left`
+		 */
+		c = left.root;
+		height = left.height;
+		while(!(height == right.height && rbnode_is_black(c))){
+			if(rbnode_is_black(c))
+				height--;
+			parent = c;
+			c = c->right;
+		}
+
+		node->left = c;
+		node->right = right.root;
+		parent->right = node;
+		tree.root = left.root;
+		t.height = left.height;
+	}else{
+		/*
+		 * walks the left spine of `right`
+		 */
+		c = right.root;
+		height = right.height;
+		while(!(height == left.height && rbnode_is_black(c))){
+			if(rbnode_is_black(c))
+				height--;
+			parent = c;
+			c = c->left;
+		}
+
+		node->left = left.root;
+		node->right = c;
+		parent->left = node;
+		tree.root = right.root;
+		t.height = right.height;
+	}
+
+	node->parent = parent;
+	node->color = G_RB_RED;
+
+	if(node->left)	node->left->parent = node;
+	if(node->right)	node->right->parent = node;
+
+	for(c = node; c != NULL; c = c->parent)
+		rbnode_update(rbt, c);
+
+	rbtree_insert_rebalance(&tree, node);
+
+	if(tree.root->color == G_RB_RED){
+		tree.root->color = G_RB_BLACK;
+		t.height++;
+	}
+
+	t.root = tree.root;
+	return t;
+}
+
+/*
+ * joins `left` and `right`, where all the elements of `left`
+ * are smaller than the ones of `right`
+ */
+static rbsub_t rbsub_join2(rbtree_t* rbt, rbsub_t left, rbsub_t right)
+{
+	rbnode_t* min;
+
+	if(!left.root)	return right;
+	if(!right.root)	return left;
+
+	right = rbsub_split_min(rbt, right, &min);
+
+	return rbsub_join(rbt, left, min, right);
+}
+
+/*
+ * removes the minimum of the non empty `t`, writes it
+ * in `min` and returns the remaining subtree
+ */
+static rbsub_t rbsub_split_min(rbtree_t* rbt, rbsub_t t, rbnode_t** min)
+{
+	rbsub_t left;
+	rbsub_t right;
+	rbnode_t* node;
+
+	rbsub_expose(t, &left, &node, &right);
+
+	if(!left.root){
+		*min = node;
+		return right;
+	}
+
+	left = rbsub_split_min(rbt, left, min);
+
+	return rbsub_join(rbt, left, node, right);
+}
+
+/*
+ * splits `t` in the elements smaller than `key`, `left`, and
+ * the greater ones, `right`; a node equal to `key` is written
+ * in `node`, which is NULL otherwise
+ */
+static void rbsub_split(	rbtree_t* rbt,
+				rbsub_t t,
+				void* key,
+				rbsub_t* left,
+				rbnode_t** node,
+				rbsub_t* right)
+{
+	rbsub_t l;
+	rbsub_t r;
+	rbsub_t x;
+	rbnode_t* k;
+
+	if(!t.root){
+		left->root = right->root = NULL;
+		left->height = right->height = 0;
+		*node = NULL;
+		return;
+	}
+
+	rbsub_expose(t, &l, &k, &r);
+
+	int c = rbt->compare(key, k->data, rbt->compare_argument);
+
+	if(c == G_RB_EQUAL){
+		*left = l;
+		*node = k;
+		*right = r;
+	}else if(c == G_RB_FIRST_IS_SMALLER){
+		rbsub_split(rbt, l, key, left, node, &x);
+		*right = rbsub_join(rbt, x, k, r);
+	}else{
+		rbsub_split(rbt, r, key, &x, node, right);
+		*left = rbsub_join(rbt, l, k, x);
+	}
+}
+
+/*
+ * splits `t` in the elements smaller than `key`, `left`, and
+ * the greater or equal ones, `right`
+ */
+static void rbsub_split_below(	rbtree_t* rbt,
+				rbsub_t t,
+				void* key,
+				rbsub_t* left,
+				rbsub_t* right)
+{
+	rbsub_t l;
+	rbsub_t r;
+	rbsub_t x;
+	rbnode_t* k;
+
+	if(!t.root){
+		left->root = right->root = NULL;
+		left->height = right->height = 0;
+		return;
+	}
+
+	rbsub_expose(t, &l, &k, &r);
+
+	if(rbt->compare(k->data, key, rbt->compare_argument) == G_RB_FIRST_IS_SMALLER){
+		rbsub_split_below(rbt, r, key, &x, right);
+		*left = rbsub_join(rbt, l, k, x);
+	}else{
+		rbsub_split_below(rbt, l, key, left, &x);
+		*right = rbsub_join(rbt, x, k, r);
+	}
+}
+
+/*
+ * the set operation `op` of the subtrees `a` and `b`; the
+ * number of freed nodes is added to `freed`. The root of one
+ * tree splits the other, the halves are combined recursively
+ * and joined back; with more than one thread the smaller
+ * halves are combined by a new thread.
+ */
+static rbsub_t rbsub_set_operation(	rbtree_t* rbt,
+					rbsub_t a,
+					rbsub_t b,
+					rbset_op_t op,
+					size_t nthreads,
+					size_t* freed)
+{
+	rbsub_t al, ar, bl, br, l, r;
+	rbnode_t* node;
+	rbnode_t* match;
+	pthread_t thread;
+	rbset_task_t task;
+
+	if(!a.root || !b.root){
+		if(op == G_RB_UNION)
+			return a.root ? a : b;
+		if(op == G_RB_DIFFERENCE && a.root)
+			return a;
+
+		*freed += rbnode_free_all(a.root) + rbnode_free_all(b.root);
+		a.root = NULL;
+		a.height = 0;
+		return a;
+	}
+
+	/*
+	 * the intersection keeps the nodes of `a`, so
+	 * it splits `b`; the others split `a`
+	 */
+	if(op == G_RB_INTERSECTION){
+		rbsub_expose(a, &al, &node, &ar);
+		rbsub_split(rbt, b, node->data, &bl, &match, &br);
+	}else{
+		rbsub_expose(b, &bl, &node, &br);
+		rbsub_split(rbt, a, node->data, &al, &match, &ar);
+	}
+
+	task.rbt = rbt;
+	task.a = al;
+	task.b = bl;
+	task.op = op;
+	task.nthreads = nthreads/2;
+	task.freed = 0;
+
+	if(nthreads > 1
+	&& pthread_create(&thread, NULL, rbsub_set_operation_thread, &task) == 0){
+		r = rbsub_set_operation(rbt, ar, br, op, nthreads - nthreads/2, freed);
+		pthread_join(thread, NULL);
+	}else{
+		rbsub_set_operation_thread(&task);
+		r = rbsub_set_operation(rbt, ar, br, op, 1, freed);
+	}
+
+	l = task.result;
+	*freed += task.freed;
+
+	switch(op){
+	case G_RB_UNION:
+		if(match){
+			rbnode_free(match);
+			(*freed)++;
+		}
+		return rbsub_join(rbt, l, node, r);
+
+	case G_RB_INTERSECTION:
+		if(match){
+			rbnode_free(match);
+			(*freed)++;
+			return rbsub_join(rbt, l, node, r);
+		}
+		break;
+
+	case G_RB_DIFFERENCE:
+		if(match){
+			rbnode_free(match);
+			(*freed)++;
+		}
+		break;
+	}
+
+	rbnode_free(node);
+	(*freed)++;
+
+	return rbsub_join2(rbt, l, r);
+}
+
+/*
+ * runs the set operation of a rbset_task_t
+ */
+static void* rbsub_set_operation_thread(void* arg)
+{
+	rbset_task_t* task = (rbset_task_t*) arg;
+
+	task->result = rbsub_set_operation(	task->rbt,
+						task->a,
+						task->b,
+						task->op,
+						task->nthreads,
+						&task->freed);
+
+	return NULL;
+}
+
+/*
+ * adds to `to` a reference to each block of `from`
+ */
+static void rbtree_share_blocks(rbtree_t* from, rbtree_t* to)
+{
+	rbblock_t* block;
+
+	for(block = from->blocks; block != NULL; block = block->next){
+		rbblock_t* shared = (rbblock_t*) malloc(sizeof(rbblock_t));
+
+		shared->memory = block->memory;
+		__atomic_add_fetch(shared->memory, 1, __ATOMIC_RELAXED);
+
+		shared->next = to->blocks;
+		to->blocks = shared;
+	}
+}
+
+/*
+ * moves the block references of `from` to `to`
+ */
+static void rbtree_move_blocks(rbtree_t* from, rbtree_t* to)
+{
+	rbblock_t* last = from->blocks;
+
+	if(!last)
+		return;
+
+	while(last->next)
+		last = last->next;
+
+	last->next = to->blocks;
+	to->blocks = from->blocks;
+	from->blocks = NULL;
+}
+
+/*
+ * sets the sizes of the trees split from a tree of `size`
+ * elements; without the subtree counts the trees are
+ * walked together until the smaller one ends
+ */
+static void rbtree_split_sizes(rbtree_t* left, rbtree_t* right, size_t size)
+{
+	if(left->flags & G_RB_ORDER_STATISTIC){
+		left->size = rbnode_count(left->root);
+		right->size = size - left->size;
+		return;
+	}
+
+	rbnode_t* l = rbtree_find_minimal_node(left->root);
+	rbnode_t* r = rbtree_find_minimal_node(right->root);
+	size_t n = 0;
+
+	while(l && r){
+		l = rbnode_successor(l);
+		r = rbnode_successor(r);
+		n++;
+	}
+
+	if(!l){
+		left->size = n;
+		right->size = size - n;
+	}else{
+		right->size = n;
+		left->size = size - n;
+	}
 }
 
 /*
@@ -924,6 +2484,8 @@ rbnode_t* rbtree_create_double_black()
 	db->left	= NULL;
 	db->data	= NULL;
 	db->color	= G_RB_DOUBLE_BLACK;
+	db->flags	= 0;
+	db->count	= 0;
 
 	return db;
 }
@@ -16,8 +16,122 @@
  *
  * For more information, please refer to <http://unlicense.org/>
  */
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <pthread.h>
+
 #include "trie.h"
 
+/*
+ * on-disk format written by `trie_save`;
+ * every field is in the native byte order and every
+ * record starts at an offset multiple of 8, so the file
+ * can be used in place once mapped.
+ *
+ * the nodes are written in post-order and the children
+ * are referenced by their offset from the beginning of
+ * the file, so the format does not depend on the address
+ * where it is mapped.
+ */
+#define TRIE_FILE_MAGIC		"GTRIEMAP"
+#define TRIE_FILE_VERSION	1
+#define TRIE_FILE_BYTE_ORDER	0x01020304
+#define TRIE_FILE_ALIGN(X)	(((X) + 7) & ~((uint64_t)7))
+
+typedef struct trie_file_header_t {
+	char magic[8];
+	uint32_t version;
+	uint32_t byte_order;
+	uint64_t member_size;
+	uint64_t size;
+	uint64_t node_count;
+	uint64_t root;
+	uint64_t length;
+} trie_file_header_t;
+
+/*
+ * the node record is followed by the value (if any),
+ * the sorted labels of the children and the offsets of
+ * the children, each part padded to 8 bytes
+ */
+typedef struct trie_file_node_t {
+	uint32_t nchildren;
+	uint32_t has_value;
+} trie_file_node_t;
+
+/*
+ * the nodes and values are published with release stores
+ * and read with acquire loads by the concurrent readers, so
+ * a reader never sees a partially initialized node or value
+ */
+#define TRIE_PUBLISH(PTR, VALUE)	__atomic_store_n(&(PTR), (VALUE), __ATOMIC_RELEASE)
+#define TRIE_LOAD(PTR)			__atomic_load_n(&(PTR), __ATOMIC_ACQUIRE)
+
+/*
+ * auxiliar function;
+ * serializes the writers of a trie in concurrent mode
+ */
+static void trie_write_lock (struct trie_t* t)
+{
+	if(t->sync)
+		pthread_mutex_lock(&t->sync->writer);
+}
+
+static void trie_write_unlock (struct trie_t* t)
+{
+	if(t->sync)
+		pthread_mutex_unlock(&t->sync->writer);
+}
+
+/*
+ * auxiliar function;
+ * frees a value already unlinked from the trie; in concurrent
+ * mode the value is retired until no reader can see it
+ */
+static void trie_release_value (struct trie_t* t, void* value, int pooled)
+{
+	if(!value || pooled)
+		return;
+
+	if(t->sync)
+		epoch_retire(&t->sync->epoch, value);
+	else
+		free(value);
+}
+
+/*
+ * auxiliar function;
+ * replaces the value of `node` by a copy of `elem`;
+ * in concurrent mode the copy is made in a new buffer
+ * published atomically, otherwise the value is overwritten
+ */
+static void trie_write_value (struct trie_t* t, struct tnode_t* node, void* elem)
+{
+	if(t->sync || node->value == NULL){
+		void* value = malloc(t->member_size);
+		void* old = node->value;
+		int pooled = node->flags & G_TNODE_POOLED_VALUE;
+
+		if(t->member_size && elem)
+			memcpy(value, elem, t->member_size);
+
+		node->flags &= ~G_TNODE_POOLED_VALUE;
+		TRIE_PUBLISH(node->value, value);
+
+		if(old)
+			trie_release_value(t, old, pooled);
+		else
+			t->size++;
+	}else if(t->member_size && elem){
+		memcpy(node->value, elem, t->member_size);
+	}
+}
+
 /*
  * Auxiliar function;
  * find the node mapped by `string`, if necessary, allocates
@@ -35,15 +149,17 @@ tnode_t* trie_get_node_or_allocate (
 	char *ptr = string;
 
 	for(i=0; i<size; i++){
-		int byte = (int)ptr[i];
+		unsigned char byte = (unsigned char)ptr[i];
 		if ( node->children[byte] == NULL ){
-			node->children[byte] = (tnode_t*)malloc(sizeof(tnode_t));
-			node->children[byte]->value = NULL;
+			tnode_t* child = (tnode_t*)malloc(sizeof(tnode_t));
+			child->value = NULL;
+			child->flags = 0;
 
 			int j;
 			for(j=0; j<NBYTE; j++)
-				node->children[byte]->children[i] = NULL;
+				child->children[j] = NULL;
 
+			TRIE_PUBLISH(node->children[byte], child);
 		}
 
 		node = node->children[byte];
@@ -89,7 +205,10 @@ gerror_t trie_create (struct trie_t* t, size_t member_size)
 
 	t->size = 0;
 	t->member_size = member_size;
+	t->blocks = NULL;
+	t->sync = NULL;
 	t->root.value = NULL;
+	t->root.flags = 0;
 	
 	int i;
 	for(i=0; i<NBYTE; i++)
@@ -109,10 +228,11 @@ void trie_destroy_tnode (struct tnode_t* node)
 		for(i=0; i<NBYTE; i++)
 			trie_destroy_tnode(node->children[i]);
 
-		if( node->value )
+		if( node->value && !(node->flags & G_TNODE_POOLED_VALUE) )
 			free(node->value);
 
-		free(node);
+		if( !(node->flags & G_TNODE_POOLED_NODE) )
+			free(node);
 	}
 }
 
@@ -128,13 +248,29 @@ gerror_t trie_destroy (struct trie_t* t)
 
 	int i;
 	
-	if(t->root.value)
+	if(t->root.value && !(t->root.flags & G_TNODE_POOLED_VALUE))
 		free(t->root.value);
+	t->root.value = NULL;
+	t->root.flags = 0;
 	
 	for(i=0; i<NBYTE; i++){
 		trie_destroy_tnode(t->root.children[i]);
 		t->root.children[i] = NULL;
 	}
+
+	while(t->blocks){
+		struct tblock_t* next = t->blocks->next;
+		free(t->blocks->memory);
+		free(t->blocks);
+		t->blocks = next;
+	}
+
+	if(t->sync){
+		epoch_destroy(&t->sync->epoch);
+		pthread_mutex_destroy(&t->sync->writer);
+		free(t->sync);
+		t->sync = NULL;
+	}
 	t->size = 0;
 	t->member_size = 0;
 
@@ -143,6 +279,8 @@ gerror_t trie_destroy (struct trie_t* t)
 
 /** Adds the `elem` and maps it with the `string` with size `size`.
   * This function overwrite any data left in the trie mapped with string.
+  * In concurrent mode the writers are serialized and the readers are
+  * never blocked.
   *
   * @param t		pointer to the trie structure;
   * @param string	pointer to the string of bytes to map elem;
@@ -152,14 +290,14 @@ gerror_t trie_destroy (struct trie_t* t)
 gerror_t trie_add_element (struct trie_t* t, void* string, size_t size, void* elem)
 {
 	if(!t) return GERROR_NULL_STRUCTURE;
-	struct tnode_t* node = trie_get_node_or_allocate(t, string, size);
 
-	if(node->value == NULL)
-		node->value = malloc(t->member_size);
+	trie_write_lock(t);
 
-	if(t->member_size && string)
-		memcpy(node->value, elem, t->member_size);
-	t->size++;
+	struct tnode_t* node = trie_get_node_or_allocate(t, string, size);
+	if(node)
+		trie_write_value(t, node, string ? elem : NULL);
+
+	trie_write_unlock(t);
 
 	return GERROR_OK;
 }
@@ -179,17 +317,24 @@ gerror_t trie_remove_element (struct trie_t* t, void* string, size_t size)
 {
 	if(!t) return GERROR_NULL_STRUCTURE;
 
+	trie_write_lock(t);
+
 	struct tnode_t* node = node_at(t, string, size);
-	if(!node) return GERROR_ACCESS_OUT_OF_BOUND;
+	if(!node || !node->value){
+		trie_write_unlock(t);
+		return GERROR_ACCESS_OUT_OF_BOUND;
+	}
 
 	void* removed_value = node->value;
+	int pooled = node->flags & G_TNODE_POOLED_VALUE;
 
-	node->value = NULL;
+	TRIE_PUBLISH(node->value, NULL);
+	node->flags &= ~G_TNODE_POOLED_VALUE;
 
 	t->size--;
-	void* ptr = removed_value;
-	if(ptr)
-		free(ptr);
+	trie_release_value(t, removed_value, pooled);
+
+	trie_write_unlock(t);
 	return GERROR_OK;
 }
 
@@ -211,7 +356,7 @@ gerror_t trie_get_element (struct trie_t* t, void* string, size_t size, void* el
 
 	struct tnode_t* node = node_at(t, string, size);
 
-	if(node == NULL)
+	if(node == NULL || node->value == NULL)
 		return GERROR_ACCESS_OUT_OF_BOUND;
 
 	if(t->member_size)
@@ -232,13 +377,865 @@ gerror_t trie_set_element (struct trie_t* t, void* string, size_t size, void* el
 {
 
 	if(!t) return GERROR_NULL_STRUCTURE;
-		
+
+	trie_write_lock(t);
+
 	struct tnode_t* node = node_at(t, string, size);
-	if(node){
-		if(t->member_size)
-			memcpy(node->value, elem, t->member_size);
+	if(node && node->value)
+		trie_write_value(t, node, elem);
+
+	trie_write_unlock(t);
+
+	return GERROR_OK;
+}
+
+/*
+ * auxiliar function;
+ * allocates a block of `size` zeroed bytes owned by the list `blocks`
+ */
+static void* trie_block_alloc (struct tblock_t** blocks, size_t size)
+{
+	struct tblock_t* block = (struct tblock_t*) malloc(sizeof(struct tblock_t));
+
+	block->memory = calloc(size ? size : 1, 1);
+	block->size = size ? size : 1;
+	block->next = *blocks;
+	*blocks = block;
+
+	return block->memory;
+}
+
+/*
+ * auxiliar function;
+ * loads the keys in [begin, end) under `root`. The path of the previous
+ * key is kept, so only the bytes after the common prefix are walked,
+ * and the new nodes and values are taken from two blocks added to `blocks`.
+ * The number of new keys is written in `added`. In concurrent mode
+ * `epoch` is not NULL and the values already present are replaced by
+ * new ones instead of overwritten.
+ */
+static void trie_bulk_load_range (
+		struct tnode_t* root,
+		size_t member_size,
+		void** keys,
+		size_t* lens,
+		void* values,
+		size_t begin,
+		size_t end,
+		struct tblock_t** blocks,
+		struct epoch_t* epoch,
+		size_t* added)
+{
+	size_t value_size = member_size ? member_size : 1;
+	size_t max_len = 0;
+	size_t nnodes = 0;
+	size_t i;
+
+	/*
+	 * upper bound of the new nodes: the bytes after
+	 * the common prefix with the previous key
+	 */
+	for(i=begin; i<end; i++){
+		const unsigned char* key = keys[i];
+		size_t lcp = 0;
+
+		if(i > begin){
+			const unsigned char* prev = keys[i-1];
+			while(lcp < lens[i-1] && lcp < lens[i] && prev[lcp] == key[lcp])
+				lcp++;
+		}
+
+		nnodes += lens[i] - lcp;
+		if(lens[i] > max_len)
+			max_len = lens[i];
+	}
+
+	struct tnode_t* node_block = (struct tnode_t*)
+		trie_block_alloc(blocks, nnodes*sizeof(struct tnode_t));
+	char* value_block = (char*)
+		trie_block_alloc(blocks, (end - begin)*value_size);
+	struct tnode_t** path = (struct tnode_t**)
+		malloc(sizeof(struct tnode_t*)*(max_len + 1));
+
+	size_t used_nodes = 0;
+	size_t used_values = 0;
+
+	path[0] = root;
+	*added = 0;
+
+	for(i=begin; i<end; i++){
+		const unsigned char* key = keys[i];
+		size_t lcp = 0;
+		size_t d;
+
+		if(i > begin){
+			const unsigned char* prev = keys[i-1];
+			while(lcp < lens[i-1] && lcp < lens[i] && prev[lcp] == key[lcp])
+				lcp++;
+		}
+
+		struct tnode_t* node = path[lcp];
+		for(d=lcp; d<lens[i]; d++){
+			struct tnode_t* child = node->children[key[d]];
+
+			if(child == NULL){
+				child = &node_block[used_nodes++];
+				child->flags = G_TNODE_POOLED_NODE;
+				TRIE_PUBLISH(node->children[key[d]], child);
+			}
+
+			path[d+1] = child;
+			node = child;
+		}
+
+		void* elem = (char*)values + i*member_size;
+
+		if(node->value == NULL || epoch){
+			void* value = value_block + (used_values++)*value_size;
+			void* old = node->value;
+			int pooled = node->flags & G_TNODE_POOLED_VALUE;
+
+			if(member_size)
+				memcpy(value, elem, member_size);
+
+			node->flags |= G_TNODE_POOLED_VALUE;
+			TRIE_PUBLISH(node->value, value);
+
+			if(old == NULL)
+				(*added)++;
+			else if(!pooled)
+				epoch_retire(epoch, old);
+		}else if(member_size){
+			memcpy(node->value, elem, member_size);
+		}
+	}
+
+	free(path);
+}
+
+/** Adds the `n` keys of `keys`, with the sizes in `lens`, mapped to
+  * the `n` elements of the array `values`.
+  * The walk from the root is shared with the previous key and the new
+  * nodes are allocated in a single block, so the function is much faster
+  * than `trie_add_element` when the keys are sorted. Unsorted keys are
+  * also accepted, but only the prefix shared with the previous key is
+  * reused.
+  *
+  * @param t		pointer to the trie structure;
+  * @param keys		array with `n` pointers to the keys;
+  * @param lens		array with the size of every key;
+  * @param values	array with `n` elements of size `t->member_size`;
+  * @param n		number of keys.
+  *
+  * @return	GERROR_OK in case of success operation;
+  * 		GERROR_NULL_STRUCURE in case `t` is a NULL;
+  * 		GERROR_NULL_POINTER_TO_BUFFER in case `keys`, `lens`
+  * 		or `values` is NULL
+  */
+gerror_t trie_bulk_load (
+		struct trie_t* t,
+		void** keys,
+		size_t* lens,
+		void* values,
+		size_t n)
+{
+	if(!t) return GERROR_NULL_STRUCTURE;
+	if(!n) return GERROR_OK;
+	if(!keys || !lens || (!values && t->member_size))
+		return GERROR_NULL_POINTER_TO_BUFFER;
+
+	size_t added;
+
+	trie_write_lock(t);
+
+	trie_bulk_load_range(
+			&t->root,
+			t->member_size,
+			keys,
+			lens,
+			values,
+			0,
+			n,
+			&t->blocks,
+			t->sync ? &t->sync->epoch : NULL,
+			&added);
+
+	t->size += added;
+
+	trie_write_unlock(t);
+
+	return GERROR_OK;
+}
+
+/*
+ * work of a thread of `trie_bulk_load_parallel`
+ */
+typedef struct trie_bulk_load_job_t {
+	struct trie_t* t;
+	void** keys;
+	size_t* lens;
+	void* values;
+	size_t begin;
+	size_t end;
+	struct tblock_t* blocks;
+	size_t added;
+	int running;
+} trie_bulk_load_job_t;
+
+static void* trie_bulk_load_thread (void* arg)
+{
+	struct trie_bulk_load_job_t* job = arg;
+
+	trie_bulk_load_range(
+			&job->t->root,
+			job->t->member_size,
+			job->keys,
+			job->lens,
+			job->values,
+			job->begin,
+			job->end,
+			&job->blocks,
+			job->t->sync ? &job->t->sync->epoch : NULL,
+			&job->added);
+
+	return NULL;
+}
+
+/** Same as `trie_bulk_load`, but the keys are split by the first byte
+  * and the subtrees are loaded by up to `nthreads` threads.
+  * The keys must be sorted at least by the first byte; otherwise
+  * the load is done by `trie_bulk_load` in the calling thread.
+  *
+  * @param t		pointer to the trie structure;
+  * @param keys		array with `n` pointers to the keys;
+  * @param lens		array with the size of every key;
+  * @param values	array with `n` elements of size `t->member_size`;
+  * @param n		number of keys;
+  * @param nthreads	maximum number of threads.
+  *
+  * @see trie_bulk_load
+  *
+  * @return	GERROR_OK in case of success operation;
+  * 		GERROR_NULL_STRUCURE in case `t` is a NULL;
+  * 		GERROR_NULL_POINTER_TO_BUFFER in case `keys`, `lens`
+  * 		or `values` is NULL
+  */
+gerror_t trie_bulk_load_parallel (
+		struct trie_t* t,
+		void** keys,
+		size_t* lens,
+		void* values,
+		size_t n,
+		size_t nthreads)
+{
+	if(!t) return GERROR_NULL_STRUCTURE;
+	if(!n) return GERROR_OK;
+	if(!keys || !lens || (!values && t->member_size))
+		return GERROR_NULL_POINTER_TO_BUFFER;
+
+	/*
+	 * the empty keys come first and the others have to be
+	 * grouped by the first byte, so the threads never touch
+	 * the same child of the root
+	 */
+	size_t first = 0;
+	size_t i;
+
+	while(first < n && lens[first] == 0)
+		first++;
+
+	for(i=first+1; i<n; i++){
+		if(lens[i] == 0 ||
+		   ((unsigned char*)keys[i])[0] < ((unsigned char*)keys[i-1])[0])
+			break;
+	}
+
+	if(nthreads < 2 || i < n)
+		return trie_bulk_load(t, keys, lens, values, n);
+
+	if(first)
+		trie_bulk_load(t, keys, lens, values, first);
+
+	trie_write_lock(t);
+
+	/*
+	 * every job takes about (n - first)/nthreads keys, but
+	 * only ends at the end of a group of keys with the
+	 * same first byte
+	 */
+	struct trie_bulk_load_job_t* jobs = (struct trie_bulk_load_job_t*)
+		malloc(sizeof(struct trie_bulk_load_job_t)*nthreads);
+	pthread_t* threads = (pthread_t*) malloc(sizeof(pthread_t)*nthreads);
+	size_t share = (n - first + nthreads - 1)/nthreads;
+	size_t njobs = 0;
+	size_t begin = first;
+
+	while(begin < n){
+		size_t end = begin + share < n ? begin + share : n;
+		unsigned char byte = ((unsigned char*)keys[end-1])[0];
+
+		while(end < n && ((unsigned char*)keys[end])[0] == byte)
+			end++;
+
+		jobs[njobs].t = t;
+		jobs[njobs].keys = keys;
+		jobs[njobs].lens = lens;
+		jobs[njobs].values = values;
+		jobs[njobs].begin = begin;
+		jobs[njobs].end = end;
+		jobs[njobs].blocks = NULL;
+		jobs[njobs].added = 0;
+		jobs[njobs].running = 0;
+		njobs++;
+
+		begin = end;
+	}
+
+	/*
+	 * the first job, and any job whose thread could not
+	 * be created, runs in the calling thread
+	 */
+	for(i=1; i<njobs; i++)
+		jobs[i].running = pthread_create(
+				&threads[i],
+				NULL,
+				trie_bulk_load_thread,
+				&jobs[i]) == 0;
+
+	for(i=0; i<njobs; i++)
+		if(!jobs[i].running)
+			trie_bulk_load_thread(&jobs[i]);
+
+	for(i=0; i<njobs; i++){
+		if(jobs[i].running)
+			pthread_join(threads[i], NULL);
+
+		while(jobs[i].blocks){
+			struct tblock_t* next = jobs[i].blocks->next;
+			jobs[i].blocks->next = t->blocks;
+			t->blocks = jobs[i].blocks;
+			jobs[i].blocks = next;
+		}
+
+		t->size += jobs[i].added;
+	}
+
+	trie_write_unlock(t);
+
+	free(threads);
+	free(jobs);
+
+	return GERROR_OK;
+}
+
+/** Turns on the concurrent mode of `t`: up to `max_readers` registered
+  * threads can call `trie_concurrent_get_element` without locks while
+  * other threads add, set or remove elements.
+  * The writers are serialized by a mutex, the new nodes and values are
+  * published atomically and the replaced values are freed by epoch based
+  * reclamation when no reader can see them anymore.
+  * This function has to be called before the trie is shared.
+  *
+  * @param t		pointer to the trie structure;
+  * @param max_readers	maximum number of registered readers.
+  *
+  * @see epoch_t
+  *
+  * @return	GERROR_OK in case of success operation;
+  * 		GERROR_NULL_STRUCURE in case `t` is a NULL
+  */
+gerror_t trie_enable_concurrency (struct trie_t* t, size_t max_readers)
+{
+	if(!t) return GERROR_NULL_STRUCTURE;
+	if(t->sync) return GERROR_OK;
+
+	t->sync = (struct trie_sync_t*) malloc(sizeof(struct trie_sync_t));
+	epoch_create(&t->sync->epoch, max_readers);
+	pthread_mutex_init(&t->sync->writer, NULL);
+
+	return GERROR_OK;
+}
+
+/** Registers the calling thread as a reader of `t`.
+  *
+  * @param t		pointer to the trie structure in concurrent mode;
+  * @param reader	pointer to the returned reader id.
+  *
+  * @return	GERROR_OK in case of success operation;
+  * 		GERROR_NULL_STRUCURE in case `t` is a NULL or it is
+  * 		not in concurrent mode;
+  * 		GERROR_FULL_STRUCTURE in case there are `max_readers`
+  * 		readers registered
+  */
+gerror_t trie_register_reader (struct trie_t* t, size_t* reader)
+{
+	if(!t || !t->sync) return GERROR_NULL_STRUCTURE;
 
+	return epoch_register(&t->sync->epoch, reader);
+}
+
+/** Unregisters the reader `reader` of `t`.
+  *
+  * @param t		pointer to the trie structure in concurrent mode;
+  * @param reader	reader id returned by `trie_register_reader`.
+  *
+  * @return	GERROR_OK in case of success operation;
+  * 		GERROR_NULL_STRUCURE in case `t` is a NULL or it is
+  * 		not in concurrent mode
+  */
+gerror_t trie_unregister_reader (struct trie_t* t, size_t reader)
+{
+	if(!t || !t->sync) return GERROR_NULL_STRUCTURE;
+
+	return epoch_unregister(&t->sync->epoch, reader);
+}
+
+/** Same as `trie_get_element`, but safe to be called while other
+  * threads modify `t`. The reader never blocks.
+  * If `t` is not in concurrent mode, `reader` is ignored.
+  *
+  * @param t		pointer to the trie structure;
+  * @param reader	reader id returned by `trie_register_reader`;
+  * @param string	pointer to the string of bytes to map elem;
+  * @param size		size of the string of bytes.
+  * @param elem		pointer to the memory allocated that
+  * 			will be write with the elem mapped by `string`
+  *
+  * @return	GERROR_OK in case of success operation;
+  * 		GERROR_NULL_STRUCURE in case `t` is a NULL;
+  * 		GERROR_ACCESS_OUT_OF_BOUND in case there is no
+  * 		element mapped by `string` or `reader` is invalid
+  */
+gerror_t trie_concurrent_get_element (
+		struct trie_t* t,
+		size_t reader,
+		void* string,
+		size_t size,
+		void* elem)
+{
+	if(!t) return GERROR_NULL_STRUCTURE;
+	if(!t->sync) return trie_get_element(t, string, size, elem);
+	if(reader >= t->sync->epoch.nslots) return GERROR_ACCESS_OUT_OF_BOUND;
+	if(!string && size) return GERROR_ACCESS_OUT_OF_BOUND;
+
+	const unsigned char* ptr = string;
+	struct tnode_t* node = &t->root;
+	void* value = NULL;
+	size_t i;
+
+	epoch_enter(&t->sync->epoch, reader);
+
+	for(i=0; node && i<size; i++)
+		node = TRIE_LOAD(node->children[ptr[i]]);
+
+	if(node)
+		value = TRIE_LOAD(node->value);
+
+	if(value && elem && t->member_size)
+		memcpy(elem, value, t->member_size);
+
+	epoch_leave(&t->sync->epoch, reader);
+
+	return value ? GERROR_OK : GERROR_ACCESS_OUT_OF_BOUND;
+}
+
+/*
+ * auxiliar function;
+ * adds `node` and its children to `stats`; `chain` is the length
+ * of the chain of nodes with a single child and no value right
+ * above `node`
+ */
+static void trie_stats_tnode (
+		struct trie_t* t,
+		struct tnode_t* node,
+		size_t depth,
+		size_t chain,
+		struct trie_stats_t* stats)
+{
+	size_t nchildren = 0;
+	int i;
+
+	for(i=0; i<NBYTE; i++)
+		if(node->children[i])
+			nchildren++;
+
+	stats->node_count++;
+	stats->fanout_histogram[nchildren]++;
+	stats->depth_histogram[depth < TRIE_STATS_BUCKETS ? depth : TRIE_STATS_BUCKETS - 1]++;
+	if(depth > stats->max_depth)
+		stats->max_depth = depth;
+
+	if(node != &t->root && !(node->flags & G_TNODE_POOLED_NODE))
+		stats->bytes_allocated += sizeof(struct tnode_t);
+
+	if(node->value){
+		stats->value_count++;
+		stats->value_bytes += t->member_size;
+		if(!(node->flags & G_TNODE_POOLED_VALUE))
+			stats->bytes_allocated += t->member_size;
+	}
+
+	if(nchildren == 1 && !node->value){
+		chain++;
+	}else if(chain){
+		stats->chain_count++;
+		stats->chain_histogram[chain < TRIE_STATS_BUCKETS ? chain : TRIE_STATS_BUCKETS - 1]++;
+		if(chain > stats->longest_chain)
+			stats->longest_chain = chain;
+		chain = 0;
+	}
+
+	for(i=0; i<NBYTE; i++)
+		if(node->children[i])
+			trie_stats_tnode(t, node->children[i], depth + 1, chain, stats);
+}
+
+/** Computes the memory used by `t` and the shape of the trie in a single
+  * traversal and writes them in `stats`.
+  *
+  * @param t		pointer to the trie structure;
+  * @param stats	pointer to the structure to be written.
+  *
+  * @see trie_stats_t
+  *
+  * @return	GERROR_OK in case of success operation;
+  * 		GERROR_NULL_STRUCURE in case `t` is a NULL;
+  * 		GERROR_NULL_RETURN_POINTER in case `stats` is NULL
+  */
+gerror_t trie_stats (struct trie_t* t, struct trie_stats_t* stats)
+{
+	if(!t) return GERROR_NULL_STRUCTURE;
+	if(!stats) return GERROR_NULL_RETURN_POINTER;
+
+	memset(stats, 0, sizeof(struct trie_stats_t));
+
+	trie_write_lock(t);
+
+	struct tblock_t* block;
+	for(block=t->blocks; block!=NULL; block=block->next)
+		stats->bytes_allocated += sizeof(struct tblock_t) + block->size;
+
+	if(t->sync)
+		stats->bytes_allocated += sizeof(struct trie_sync_t)
+			+ t->sync->epoch.nslots*sizeof(struct epoch_slot_t);
+
+	trie_stats_tnode(t, &t->root, 0, 0, stats);
+
+	trie_write_unlock(t);
+
+	return GERROR_OK;
+}
+
+/*
+ * auxiliar function;
+ * writes `node` and its children in post-order at `*offset`
+ * and returns the offset of the record of `node` in `*written`
+ */
+static gerror_t trie_save_tnode (
+		FILE* f,
+		struct tnode_t* node,
+		size_t member_size,
+		uint64_t* offset,
+		uint64_t* written,
+		uint64_t* count)
+{
+	static const char padding[8] = { 0 };
+	unsigned char labels[NBYTE];
+	uint64_t* children;
+	trie_file_node_t record;
+	uint32_t n = 0;
+	int i;
+
+	for(i=0; i<NBYTE; i++)
+		if(node->children[i])
+			labels[n++] = (unsigned char)i;
+
+	children = (uint64_t*) malloc(sizeof(uint64_t)*(n ? n : 1));
+
+	for(i=0; i<(int)n; i++){
+		gerror_t g = trie_save_tnode(
+				f,
+				node->children[labels[i]],
+				member_size,
+				offset,
+				&children[i],
+				count);
+		if(g != GERROR_OK){
+			free(children);
+			return g;
+		}
+	}
+
+	record.nchildren = n;
+	record.has_value = node->value != NULL;
+
+	uint64_t value_space = record.has_value ? TRIE_FILE_ALIGN(member_size) : 0;
+	uint64_t label_space = TRIE_FILE_ALIGN(n);
+
+	int ok = fwrite(&record, sizeof(record), 1, f) == 1;
+
+	if(ok && record.has_value && member_size)
+		ok = fwrite(node->value, member_size, 1, f) == 1;
+	if(ok && value_space > member_size)
+		ok = fwrite(padding, value_space - member_size, 1, f) == 1;
+
+	if(ok && n)
+		ok = fwrite(labels, n, 1, f) == 1;
+	if(ok && label_space > n)
+		ok = fwrite(padding, label_space - n, 1, f) == 1;
+
+	if(ok && n)
+		ok = fwrite(children, sizeof(uint64_t), n, f) == n;
+
+	free(children);
+
+	if(!ok)
+		return GERROR_FILE_IO;
+
+	*written = *offset;
+	*offset += sizeof(record) + value_space + label_space + n*sizeof(uint64_t);
+	(*count)++;
+
+	return GERROR_OK;
+}
+
+/** Saves the trie `t` in the file `path`, so it can be used later
+  * with `trie_open_mmap` without rebuilding it.
+  * The file is written in the native byte order of the machine.
+  *
+  * @param t		pointer to the structure;
+  * @param path		path of the file to be (over)written.
+  *
+  * @return	GERROR_OK in case of success operation;
+  * 		GERROR_NULL_STRUCURE in case `t` is a NULL;
+  * 		GERROR_FILE_IO in case the file could not be written
+  */
+gerror_t trie_save (struct trie_t* t, const char* path)
+{
+	if(!t) return GERROR_NULL_STRUCTURE;
+	if(!path) return GERROR_NULL_POINTER_TO_BUFFER;
+
+	FILE* f = fopen(path, "wb");
+	if(!f) return GERROR_FILE_IO;
+
+	trie_write_lock(t);
+
+	trie_file_header_t header;
+	memset(&header, 0, sizeof(header));
+
+	/*
+	 * the header is written twice: first to reserve
+	 * its space and then with the final offsets
+	 */
+	gerror_t g = GERROR_FILE_IO;
+	if(fwrite(&header, sizeof(header), 1, f) == 1){
+		uint64_t offset = sizeof(header);
+		g = trie_save_tnode(
+				f,
+				&t->root,
+				t->member_size,
+				&offset,
+				&header.root,
+				&header.node_count);
+
+		memcpy(header.magic, TRIE_FILE_MAGIC, sizeof(header.magic));
+		header.version = TRIE_FILE_VERSION;
+		header.byte_order = TRIE_FILE_BYTE_ORDER;
+		header.member_size = t->member_size;
+		header.size = t->size;
+		header.length = offset;
+
+		if(g == GERROR_OK &&
+		   (fseek(f, 0, SEEK_SET) != 0 ||
+		    fwrite(&header, sizeof(header), 1, f) != 1))
+			g = GERROR_FILE_IO;
+	}
+
+	trie_write_unlock(t);
+
+	if(fclose(f) != 0 && g == GERROR_OK)
+		g = GERROR_FILE_IO;
+
+	return g;
+}
+
+/** Maps the file `path` written by `trie_save` and populates `tm`.
+  * The file is mapped read-only and shared, so the pages are shared
+  * by every process that opens the same file.
+  *
+  * @param tm		pointer to the structure;
+  * @param path		path of the file.
+  *
+  * @return	GERROR_OK in case of success operation;
+  * 		GERROR_NULL_STRUCURE in case `tm` is a NULL;
+  * 		GERROR_FILE_IO in case the file could not be mapped;
+  * 		GERROR_INVALID_FILE_FORMAT in case the file was not
+  * 		written by `trie_save`, by another version or in a
+  * 		machine with another byte order
+  */
+gerror_t trie_open_mmap (struct trie_mmap_t* tm, const char* path)
+{
+	if(!tm) return GERROR_NULL_STRUCTURE;
+	if(!path) return GERROR_NULL_POINTER_TO_BUFFER;
+
+	tm->base = NULL;
+	tm->length = 0;
+
+	int fd = open(path, O_RDONLY);
+	if(fd < 0) return GERROR_FILE_IO;
+
+	struct stat st;
+	if(fstat(fd, &st) != 0){
+		close(fd);
+		return GERROR_FILE_IO;
+	}
+
+	if((size_t)st.st_size < sizeof(trie_file_header_t)){
+		close(fd);
+		return GERROR_INVALID_FILE_FORMAT;
+	}
+
+	void* base = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if(base == MAP_FAILED)
+		return GERROR_FILE_IO;
+
+	const trie_file_header_t* header = base;
+
+	if(	memcmp(header->magic, TRIE_FILE_MAGIC, sizeof(header->magic)) ||
+		header->version != TRIE_FILE_VERSION ||
+		header->byte_order != TRIE_FILE_BYTE_ORDER ||
+		header->length != (uint64_t)st.st_size ||
+		header->member_size > header->length ||
+		header->root < sizeof(trie_file_header_t) ||
+		header->root % 8 != 0 ||
+		header->root > header->length ||
+		header->length - header->root < sizeof(trie_file_node_t)){
+		munmap(base, st.st_size);
+		return GERROR_INVALID_FILE_FORMAT;
 	}
 
+	tm->base = base;
+	tm->length = st.st_size;
+	tm->root = header->root;
+	tm->size = header->size;
+	tm->member_size = header->member_size;
+
+	return GERROR_OK;
+}
+
+/** Unmaps the trie pointed by `tm`.
+  *
+  * @param tm	pointer to the structure.
+  *
+  * @return	GERROR_OK in case of success operation;
+  * 		GERROR_NULL_STRUCURE in case `tm` is a NULL
+  */
+gerror_t trie_close_mmap (struct trie_mmap_t* tm)
+{
+	if(!tm) return GERROR_NULL_STRUCTURE;
+
+	if(tm->base)
+		munmap((void*)tm->base, tm->length);
+
+	tm->base = NULL;
+	tm->length = 0;
+	tm->size = 0;
+	tm->member_size = 0;
+
+	return GERROR_OK;
+}
+
+/*
+ * auxiliar function;
+ * returns the record of the node at `offset` or NULL
+ * if the record is not aligned or does not fit in the file;
+ * the checks are written so they can not wrap around, and
+ * the member size was bounded by the file length on open
+ */
+static const trie_file_node_t* trie_mmap_node_at (
+		struct trie_mmap_t* tm,
+		uint64_t offset)
+{
+	if(	offset % 8 != 0 ||
+		offset > tm->length ||
+		tm->length - offset < sizeof(trie_file_node_t))
+		return NULL;
+
+	const trie_file_node_t* node =
+		(const trie_file_node_t*)(tm->base + offset);
+
+	uint64_t record_size = sizeof(trie_file_node_t)
+		+ (node->has_value ? TRIE_FILE_ALIGN(tm->member_size) : 0)
+		+ TRIE_FILE_ALIGN(node->nchildren)
+		+ node->nchildren*sizeof(uint64_t);
+
+	if(tm->length - offset < record_size)
+		return NULL;
+
+	return node;
+}
+
+/** Same as `trie_get_element`, but on a trie opened by `trie_open_mmap`.
+  *
+  * @param tm		pointer to the structure;
+  * @param string	pointer to the string of bytes to map elem;
+  * @param size		size of the string of bytes.
+  * @param elem		pointer to the memory allocated that
+  * 			will be write with the elem mapped by `string`
+  *
+  * @return	GERROR_OK in case of success operation;
+  * 		GERROR_NULL_STRUCURE in case `tm` is a NULL;
+  * 		GERROR_ACCESS_OUT_OF_BOUND in case there is no
+  * 		element mapped by `string`
+  */
+gerror_t trie_mmap_get_element (
+		struct trie_mmap_t* tm,
+		void* string,
+		size_t size,
+		void* elem)
+{
+	if(!tm || !tm->base) return GERROR_NULL_STRUCTURE;
+	if(!string && size) return GERROR_ACCESS_OUT_OF_BOUND;
+
+	const unsigned char* ptr = string;
+	const trie_file_node_t* node = trie_mmap_node_at(tm, tm->root);
+	size_t i;
+
+	for(i=0; node && i<size; i++){
+		const unsigned char* value = (const unsigned char*)(node + 1);
+		const unsigned char* labels = value +
+			(node->has_value ? TRIE_FILE_ALIGN(tm->member_size) : 0);
+		const uint64_t* children = (const uint64_t*)
+			(labels + TRIE_FILE_ALIGN(node->nchildren));
+
+		/*
+		 * the labels are sorted, so a binary search is used
+		 */
+		size_t lo = 0, hi = node->nchildren;
+		while(lo < hi){
+			size_t mid = lo + (hi - lo)/2;
+			if(labels[mid] < ptr[i])
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+
+		if(lo == node->nchildren || labels[lo] != ptr[i])
+			return GERROR_ACCESS_OUT_OF_BOUND;
+
+		node = trie_mmap_node_at(tm, children[lo]);
+	}
+
+	if(!node)
+		return GERROR_INVALID_FILE_FORMAT;
+
+	if(!node->has_value)
+		return GERROR_ACCESS_OUT_OF_BOUND;
+
+	if(elem && tm->member_size)
+		memcpy(elem, node + 1, tm->member_size);
+
 	return GERROR_OK;
 }